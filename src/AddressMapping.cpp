@@ -0,0 +1,232 @@
+#include "AddressMapping.h"
+
+#include <cassert>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <set>
+#include <sstream>
+
+namespace ramulator
+{
+
+static void mapping_error(const std::string& msg) {
+  printf("ERROR: Address mapping: %s\n", msg.c_str());
+  assert(false && "ERROR: Invalid address mapping.");
+  exit(1);
+}
+
+// parses "lo" or "lo:hi"
+static void parse_range(const std::string& s, int& lo, int& hi) {
+  size_t colon = s.find(':');
+  try {
+    lo = std::stoi(s.substr(0, colon));
+    hi = (colon == std::string::npos) ? lo : std::stoi(s.substr(colon + 1));
+  } catch (const std::exception&) {
+    mapping_error("invalid bit range " + s);
+  }
+  if (lo < 0 || hi < lo) {
+    mapping_error("invalid bit range " + s);
+  }
+}
+
+static int run_width(long mask) {
+  return __builtin_popcountl(mask);
+}
+
+AddressMapping::AddressMapping(const std::vector<std::string>& level_names,
+    const std::vector<int>& level_bits):
+    level_names(level_names), level_bits(level_bits) {
+  assert(level_names.size() == level_bits.size());
+}
+
+int AddressMapping::level_index(const std::string& name) const {
+  for (unsigned int i = 0; i < level_names.size(); i++) {
+    if (level_names[i] == name) {
+      return i;
+    }
+  }
+  mapping_error("unknown level " + name);
+  return -1;
+}
+
+void AddressMapping::add_run(int level, int level_bit, int addr_bit, int width,
+    bool hash) {
+  if (width == 0) {
+    return;
+  }
+  // extend the previous run if the bits continue it
+  if (!runs.empty()) {
+    Run& prev = runs.back();
+    int prev_width = run_width(prev.mask);
+    if (prev.level == level && prev.hash == hash &&
+        prev.level_bit + prev_width == level_bit &&
+        prev.addr_bit + prev_width == addr_bit) {
+      prev.mask = (1l << (prev_width + width)) - 1;
+      return;
+    }
+  }
+  runs.push_back({level, level_bit, addr_bit, (1l << width) - 1, hash});
+}
+
+void AddressMapping::set_order(const std::string& order) {
+  if (order.size() % 2 != 0) {
+    mapping_error("invalid bit order " + order);
+  }
+  runs.clear();
+  int addr_bit = 0;
+  for (int i = order.size() - 2; i >= 0; i -= 2) {
+    int level = level_index(order.substr(i, 2));
+    add_run(level, 0, addr_bit, level_bits[level], false);
+    addr_bit += level_bits[level];
+  }
+  for (unsigned int i = 0; i < level_names.size(); i++) {
+    if (order.find(level_names[i]) == std::string::npos) {
+      mapping_error("level " + level_names[i] + " is missing in " + order);
+    }
+  }
+  check();
+}
+
+void AddressMapping::load_file(const std::string& fname) {
+  std::ifstream file(fname);
+  if (!file.good()) {
+    mapping_error("cannot open " + fname);
+  }
+  runs.clear();
+  std::string line;
+  while (getline(file, line)) {
+    std::stringstream ss(line);
+    std::string name, bits, eq, addr;
+    if (!(ss >> name) || name[0] == '#') {
+      continue;
+    }
+    if (!(ss >> bits >> eq >> addr) || eq != "=") {
+      mapping_error("invalid line \"" + line + "\"");
+    }
+    int level = level_index(name);
+    int lo, hi, addr_lo, addr_hi;
+    parse_range(bits, lo, hi);
+    parse_range(addr, addr_lo, addr_hi);
+    if (addr_hi - addr_lo != hi - lo) {
+      mapping_error("widths do not match in \"" + line + "\"");
+    }
+    add_run(level, lo, addr_lo, hi - lo + 1, false);
+
+    std::string op;
+    while (ss >> op >> addr) {
+      if (op != "^") {
+        mapping_error("invalid line \"" + line + "\"");
+      }
+      parse_range(addr, addr_lo, addr_hi);
+      if (addr_hi - addr_lo != hi - lo) {
+        mapping_error("widths do not match in \"" + line + "\"");
+      }
+      add_run(level, lo, addr_lo, hi - lo + 1, true);
+    }
+  }
+  check();
+}
+
+void AddressMapping::add_xor(const std::string& levels, int hash_level) {
+  // the address bit of each bit of the hash level
+  std::vector<int> hash_bits(level_bits[hash_level]);
+  for (const Run& run : runs) {
+    if (run.level == hash_level && !run.hash) {
+      for (int i = 0; i < run_width(run.mask); i++) {
+        hash_bits[run.level_bit + i] = run.addr_bit + i;
+      }
+    }
+  }
+
+  unsigned int next = 0;
+  std::stringstream ss(levels);
+  std::string name;
+  while (getline(ss, name, ',')) {
+    int level = level_index(name);
+    if (level == hash_level) {
+      mapping_error("cannot hash " + name + " with itself");
+    }
+    for (int i = 0; i < level_bits[level]; i++, next++) {
+      if (next == hash_bits.size()) {
+        mapping_error("not enough " + level_names[hash_level] + " bits to hash " + levels);
+      }
+      add_run(level, i, hash_bits[next], 1, true);
+    }
+  }
+}
+
+void AddressMapping::check() const {
+  std::vector<std::vector<int>> mapped(level_bits.size());
+  for (unsigned int i = 0; i < level_bits.size(); i++) {
+    mapped[i].assign(level_bits[i], 0);
+  }
+  std::set<int> addr_bits;
+  for (const Run& run : runs) {
+    for (int i = 0; i < run_width(run.mask); i++) {
+      if (run.level_bit + i >= level_bits[run.level]) {
+        mapping_error("level " + level_names[run.level] + " has only " +
+            std::to_string(level_bits[run.level]) + " bits");
+      }
+      if (run.hash) {
+        continue;
+      }
+      mapped[run.level][run.level_bit + i]++;
+      if (!addr_bits.insert(run.addr_bit + i).second) {
+        mapping_error("address bit " + std::to_string(run.addr_bit + i) +
+            " is mapped more than once");
+      }
+    }
+  }
+  for (unsigned int level = 0; level < mapped.size(); level++) {
+    for (unsigned int bit = 0; bit < mapped[level].size(); bit++) {
+      if (mapped[level][bit] != 1) {
+        mapping_error("bit " + std::to_string(bit) + " of level " +
+            level_names[level] + " is not mapped exactly once");
+      }
+    }
+  }
+}
+
+bool AddressMapping::field_range(const std::vector<int>& levels, int& lo,
+    int& hi) const {
+  int total = 0;
+  for (int level : levels) {
+    total += level_bits[level];
+  }
+  lo = -1;
+  hi = -1;
+  for (const Run& run : runs) {
+    bool in_field = false;
+    for (int level : levels) {
+      in_field |= (run.level == level);
+    }
+    if (!in_field) {
+      continue;
+    }
+    if (run.hash) {
+      return false;
+    }
+    if (lo == -1 || run.addr_bit < lo) {
+      lo = run.addr_bit;
+    }
+    if (run.addr_bit + run_width(run.mask) > hi) {
+      hi = run.addr_bit + run_width(run.mask);
+    }
+  }
+  // the address bits of different runs do not overlap
+  return total > 0 && hi - lo == total;
+}
+
+int AddressMapping::top_level() const {
+  int top = -1, top_bit = -1;
+  for (const Run& run : runs) {
+    if (!run.hash && run.addr_bit > top_bit) {
+      top = run.level;
+      top_bit = run.addr_bit;
+    }
+  }
+  return top;
+}
+
+} // namespace ramulator
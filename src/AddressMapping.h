@@ -0,0 +1,75 @@
+#ifndef __ADDRESS_MAPPING_H
+#define __ADDRESS_MAPPING_H
+
+#include <string>
+#include <vector>
+
+namespace ramulator
+{
+
+// Maps a physical address to the index of each DRAM level. The address
+// is given without the transaction offset bits (bit 0 is the lowest bit
+// above the offset).
+//
+// The mapping comes from a bit order string or from a mapping file and
+// is compiled into a list of runs, each of which extracts a contiguous
+// group of address bits into a level. XOR hashing of a level with other
+// address bits is just one more run on the same level, so decoding an
+// address is a single loop without branches.
+class AddressMapping {
+public:
+  // level_names[i] is the short name of the level i (e.g., "Ch" for the
+  // channel) and level_bits[i] is its number of index bits
+  AddressMapping(const std::vector<std::string>& level_names,
+      const std::vector<int>& level_bits);
+
+  // The fields from the most to the least significant bits, e.g.,
+  // "RoSaBaBgRaCoCh". Every level has to appear exactly once.
+  void set_order(const std::string& order);
+
+  // Each line of the file maps bits of a level to address bits:
+  //   <level> <bit>[:<bit>] = <addr bit>[:<addr bit>] [^ <addr bit>[:<addr bit>]]...
+  // e.g., "Ba 0:1 = 13:14 ^ 20:21". Ranges are inclusive and listed from
+  // the low to the high bit. Every bit of every level has to be mapped
+  // exactly once. Lines starting with # are comments.
+  void load_file(const std::string& fname);
+
+  // XOR the bits of each listed level (e.g., "Ba,Bg") with the lowest
+  // bits of hash_level (usually the row), in the listed order
+  void add_xor(const std::string& levels, int hash_level);
+
+  // The address bits [lo, hi) that hold exactly the levels, if these
+  // levels form one contiguous field that is not hashed
+  bool field_range(const std::vector<int>& levels, int& lo, int& hi) const;
+
+  // The level that holds the most significant address bit
+  int top_level() const;
+
+  void decode(long addr, std::vector<int>& addr_vec) const {
+    addr_vec.assign(level_bits.size(), 0);
+    for (const Run& run : runs) {
+      addr_vec[run.level] ^= int((addr >> run.addr_bit) & run.mask) << run.level_bit;
+    }
+  }
+
+private:
+  struct Run {
+    int level;
+    int level_bit; // the lowest bit of the level this run sets
+    int addr_bit; // the lowest address bit of the run
+    long mask;
+    bool hash; // XOR with bits that also map to another level
+  };
+
+  std::vector<std::string> level_names;
+  std::vector<int> level_bits;
+  std::vector<Run> runs;
+
+  int level_index(const std::string& name) const;
+  void add_run(int level, int level_bit, int addr_bit, int width, bool hash);
+  void check() const;
+};
+
+} // namespace ramulator
+
+#endif /* __ADDRESS_MAPPING_H */
@@ -0,0 +1,157 @@
+#ifndef BLOCKHAMMER_H
+#define BLOCKHAMMER_H
+
+#include "Config.h"
+#include "BloomFilter.h"
+
+#include <cmath>
+#include <memory>
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace ramulator
+{
+  template <typename T>
+  class Controller;
+
+  template <class T>
+  class BlockHammer
+  {
+  public:
+    BlockHammer(const Config& configs, Controller<T>* ctrl);
+    ~BlockHammer() = default;
+    void tick();
+    /**
+     * @brief: Returns true if an ACT to addr_vec has to wait since its row is blacklisted and
+     * was activated less than t_delay cycles ago
+     */
+    bool is_throttled(const std::vector<int>& addr_vec, long ctrl_clk);
+    /**
+     * @brief: Records an ACT to addr_vec. Returns true if the ACT was delayed by the throttling
+     */
+    bool update(typename T::Command cmd, const std::vector<int>& addr_vec, long ctrl_clk);
+
+    std::string to_string()
+    {
+    return "Throttling-based RowHammer Defense\n"
+                        "  └  "
+                        "BlockHammer\n";
+    }
+
+  private:
+    Controller<T>* ctrl;
+    long clk = 0;
+    int no_ranks;
+    int no_banks_per_rank;
+    int blacklist_threshold; // N_BL
+    int rowhammer_threshold; // N_RH
+    long cbf_lifetime_clk; // t_CBF in clock cycles
+    long epoch_clk; // the filters are swapped every epoch so that each filter lives for t_CBF
+    long t_delay; // minimum number of cycles between two ACTs to a blacklisted row
+
+    // per rank dual counting bloom filters. Allocated only if BlockHammer is enabled
+    std::vector<std::unique_ptr<DualCountingBloomFilter>> filters;
+    // per rank last ACT clk of the blacklisted rows
+    std::vector<std::unordered_map<uint32_t, long>> history;
+    // per rank rows that had an ACT delayed since their last ACT
+    std::vector<std::unordered_set<uint32_t>> delayed_rows;
+
+    uint32_t get_row_key(const std::vector<int>& addr_vec) const;
+  };
+
+  template <class T>
+  BlockHammer<T>::BlockHammer(const Config& configs, Controller<T>* ctrl) : ctrl(ctrl)
+  {
+    no_ranks = ctrl->channel->spec->org_entry.count[int(T::Level::Rank)];
+    no_banks_per_rank = ctrl->channel->spec->get_num_banks_per_rank();
+
+    blacklist_threshold = configs.get_uint("blockhammer_blacklist_threshold");
+    rowhammer_threshold = configs.get_uint("blockhammer_rowhammer_threshold");
+    cbf_lifetime_clk = (long) (configs.get_ulong("blockhammer_cbf_lifetime") / ((float) ctrl->channel->spec->speed_entry.tCK));
+    epoch_clk = cbf_lifetime_clk / 2;
+
+    if (!configs.get_bool("enable_blockhammer"))
+      return;
+
+    long nRC = ctrl->channel->spec->speed_entry.nRC;
+    assert(rowhammer_threshold > blacklist_threshold && "BlockHammer: blockhammer_rowhammer_threshold should be larger than blockhammer_blacklist_threshold.");
+    assert(cbf_lifetime_clk > blacklist_threshold * nRC && "BlockHammer: blockhammer_cbf_lifetime is too short for blockhammer_blacklist_threshold.");
+
+    // a blacklisted row cannot receive more than rowhammer_threshold ACTs within a CBF lifetime
+    t_delay = (long) std::ceil((cbf_lifetime_clk - blacklist_threshold * nRC) / (float) (rowhammer_threshold - blacklist_threshold));
+
+    for (int rank_id = 0; rank_id < no_ranks; rank_id++)
+      filters.emplace_back(new DualCountingBloomFilter(configs.get_uint("blockhammer_bloom_filter_size"), configs.get_uint("blockhammer_bloom_filter_hashes"),
+                                                       blacklist_threshold, false, rank_id, 0));
+
+    history.resize(no_ranks);
+    delayed_rows.resize(no_ranks);
+  }
+
+  template <class T>
+  uint32_t BlockHammer<T>::get_row_key(const std::vector<int>& addr_vec) const
+  {
+    return ctrl->channel->spec->calc_row_id_in_bank(addr_vec) * no_banks_per_rank + ctrl->channel->spec->calc_global_bank_id(addr_vec);
+  }
+
+  template <class T>
+  void BlockHammer<T>::tick()
+  {
+    clk++;
+
+    if (clk % epoch_clk != 0)
+      return;
+
+    for (int rank_id = 0; rank_id < no_ranks; rank_id++)
+    {
+      filters[rank_id]->swap_filters();
+
+      // the rows activated more than t_delay cycles ago cannot be throttled anymore
+      for (auto it = history[rank_id].begin(); it != history[rank_id].end();)
+      {
+        if (clk - it->second >= t_delay)
+          it = history[rank_id].erase(it);
+        else
+          it++;
+      }
+    }
+  }
+
+  template <class T>
+  bool BlockHammer<T>::is_throttled(const std::vector<int>& addr_vec, long ctrl_clk)
+  {
+    int rank_id = addr_vec[int(T::Level::Rank)];
+    uint32_t key = get_row_key(addr_vec);
+
+    auto it = history[rank_id].find(key);
+    if (it == history[rank_id].end() || (ctrl_clk - it->second) >= t_delay)
+      return false;
+
+    if (!filters[rank_id]->test(key))
+      return false;
+
+    delayed_rows[rank_id].insert(key);
+    return true;
+  }
+
+  template <class T>
+  bool BlockHammer<T>::update(typename T::Command cmd, const std::vector<int>& addr_vec, long ctrl_clk)
+  {
+    if (cmd != T::Command::ACT)
+      return false;
+
+    int rank_id = addr_vec[int(T::Level::Rank)];
+    uint32_t key = get_row_key(addr_vec);
+
+    filters[rank_id]->insert(key);
+
+    if (filters[rank_id]->test(key))
+      history[rank_id][key] = ctrl_clk;
+
+    return delayed_rows[rank_id].erase(key) > 0;
+  }
+
+} // namespace ramulator
+
+#endif // BLOCKHAMMER_H
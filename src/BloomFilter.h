@@ -268,6 +268,74 @@ private:
 };
 
 
+// A count-min sketch that uses the same H3 class hash functions. Each hash function indexes its own row of saturating counters
+class CountMinSketch : public BloomFilter {
+
+public:
+
+    CountMinSketch(const uint32_t size, const uint32_t num_hash_funcs, const uint32_t saturation_point, const uint32_t rank_id, const uint32_t chip_id, const uint32_t bf_id = 0) :
+        BloomFilter(size, num_hash_funcs, rank_id, chip_id, bf_id) {
+
+        max_counter_value = saturation_point;
+
+        init_bf_storage(size, num_hash_funcs);
+    }
+
+    void init_bf_storage(const uint32_t size, const uint32_t num_hash_funcs) {
+        // one row of counters per hash function
+        row_size = size;
+        entries.resize(size*num_hash_funcs);
+        clear();
+    }
+
+    void clear() {
+        std::fill(entries.begin(), entries.end(), 0);
+        this->shadow.clear();
+    }
+
+    void insert(const uint32_t key) {
+
+        for (uint32_t i = 0; i < Q.size(); i++) {
+            uint32_t& entry = entries[i*row_size + hash(key, i)];
+            entry = std::min(max_counter_value, entry + 1);
+        }
+
+        shadow.insert(key);
+    }
+
+    // the estimate is never smaller than the actual number of insertions (up to the saturation point)
+    uint32_t estimate(const uint32_t key) const {
+        uint32_t min_count = max_counter_value;
+
+        for (uint32_t i = 0; i < Q.size(); i++)
+            min_count = std::min(min_count, entries[i*row_size + hash(key, i)]);
+
+        return min_count;
+    }
+
+    bool test(const uint32_t key) {
+
+        if (estimate(key) != max_counter_value) {
+            bf_negatives++;
+            return false;
+        }
+
+        bf_positives++;
+
+        if (test_shadow(key) != true)
+            bf_false_positives++;
+
+        return true;
+    }
+
+private:
+    std::vector<uint32_t> entries;
+    uint32_t row_size = 0;
+    uint32_t max_counter_value = 0;
+
+};
+
+
 class DualCountingBloomFilter : public BloomFilter {
     public:
 
@@ -97,7 +97,7 @@ namespace ramulator {
                 next_copy_row_id[i] = 0;
             }
 
-            is_DDR4 = spec->standard_name == "DDR4";
+            is_DDR4 = spec->standard_name == "DDR4" || spec->standard_name == "DDR5" || spec->standard_name == "HBM"; // DDR5 and HBM have the same bank/subarray organization
             is_LPDDR4 = spec->standard_name == "LPDDR4";
 
             if(is_DDR4 || is_LPDDR4)
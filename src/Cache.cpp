@@ -13,9 +13,12 @@
 namespace ramulator
 {
 
+constexpr long Cache::invalid_tag;
+
 Cache::Cache(int size, int assoc, int block_size,
     int mshr_entry_num, Level level,
-    std::shared_ptr<CacheSystem> cachesys):
+    std::shared_ptr<CacheSystem> cachesys,
+    const std::string& replacement):
     level(level), cachesys(cachesys), higher_cache(0),
     lower_cache(nullptr), size(size), assoc(assoc),
     block_size(block_size), mshr_entry_num(mshr_entry_num) {
@@ -34,6 +37,14 @@ Cache::Cache(int size, int assoc, int block_size,
   is_first_level = (level == cachesys->first_level);
   is_last_level = (level == cachesys->last_level);
 
+  for (int i = 0; i < int(Level::MAX); i++) {
+    latency_each[i] = cachesys->latency_each[i];
+    latency[i] = latency_each[i] + ((i > 0) ? latency[i - 1] : 0);
+  }
+  if (is_last_level) {
+    inclusion = cachesys->llc_inclusion;
+  }
+
   // Check size, block size and assoc are 2^N
   assert((size & (size - 1)) == 0);
   assert((block_size & (block_size - 1)) == 0);
@@ -46,7 +57,11 @@ Cache::Cache(int size, int assoc, int block_size,
   index_offset = calc_log2(block_size);
   tag_offset = calc_log2(block_num) + index_offset;
 
-  prefetcher = nullptr;
+  tags.assign(block_num * assoc, invalid_tag);
+  lines.resize(block_num * assoc);
+  set_sizes.assign(block_num, 0);
+  this->replacement.reset(
+      ReplacementPolicy::create(replacement, block_num, assoc));
 
   debug("index_offset %d", index_offset);
   debug("index_mask 0x%x", index_mask);
@@ -114,6 +129,46 @@ Cache::Cache(int size, int assoc, int block_size,
                          .desc("cache set not available")
                          .precision(0)
                          ;
+  cache_demand_miss_issued.name(level_string + string("_cache_demand_miss_issued"))
+                          .desc("demand misses sent to the lower level")
+                          .precision(0)
+                          ;
+  cache_prefetch_issued.name(level_string + string("_cache_prefetch_issued"))
+                       .desc("prefetches sent to the lower level")
+                       .precision(0)
+                       ;
+  cache_prefetch_useful.name(level_string + string("_cache_prefetch_useful"))
+                       .desc("prefetched lines that were hit by a demand access")
+                       .precision(0)
+                       ;
+  cache_prefetch_late.name(level_string + string("_cache_prefetch_late"))
+                     .desc("demand misses that merged into an in-flight prefetch")
+                     .precision(0)
+                     ;
+  cache_prefetch_unused.name(level_string + string("_cache_prefetch_unused"))
+                       .desc("prefetched lines that were evicted before a demand access")
+                       .precision(0)
+                       ;
+  cache_prefetch_accuracy.name(level_string + string("_cache_prefetch_accuracy"))
+                         .desc("(useful + late) prefetches / issued prefetches")
+                         .precision(6)
+                         ;
+  cache_prefetch_coverage.name(level_string + string("_cache_prefetch_coverage"))
+                         .desc("(useful + late) prefetches / (useful + late prefetches + issued demand misses)")
+                         .precision(6)
+                         ;
+}
+
+void Cache::finish() {
+  double covered = cache_prefetch_useful.value() + cache_prefetch_late.value();
+  if (cache_prefetch_issued.value() > 0) {
+    cache_prefetch_accuracy = covered / cache_prefetch_issued.value();
+  }
+  // the demand misses that would have been issued without prefetching
+  double demand_misses = covered + cache_demand_miss_issued.value();
+  if (demand_misses > 0) {
+    cache_prefetch_coverage = covered / demand_misses;
+  }
 }
 
 bool Cache::send(Request req) {
@@ -141,28 +196,33 @@ bool Cache::send(Request req) {
   // END - debug
 
 
-  // If there isn't a set, create it.
-  auto& lines = get_lines(req.addr);
-  std::list<Line>::iterator line;
+  int set = get_index(req.addr);
+  int line;
 
-  if (is_hit(lines, req.addr, &line)) {
+  if (is_hit(set, req.addr, &line)) {
       if(req.type == Request::Type::PREFETCH) {
           cache_prefetch_hit++;
           return true;;
       }
 
-    lines.push_back(Line(req.addr, get_tag(req.addr), false,
-        line->dirty || (req.type == Request::Type::WRITE)));
-    lines.erase(line);
-    cachesys->hit_list.push_back(
-        make_pair(cachesys->clk + latency[int(level)], req));
+    bool prefetched = lines[line].is_prefetch;
+    if (prefetched) {
+      cache_prefetch_useful++;
+    }
+    lines[line] = Line(req.addr, false,
+        lines[line].dirty || (req.type == Request::Type::WRITE));
+    replacement->hit(set, line);
+    if (inclusion == Inclusion::Exclusive) {
+      move_up(set, line);
+    }
+    cachesys->add_to_hit_list(cachesys->clk + latency[int(level)], req);
 
     debug("hit, update timestamp %ld", cachesys->clk);
     debug("hit finish time %ld",
         cachesys->clk + latency[int(level)]);
 
     if(prefetcher)
-        prefetcher->hit(req.addr, cachesys->clk);
+        prefetcher->hit(req.addr, cachesys->clk, prefetched);
 
     return true;
 
@@ -192,24 +252,37 @@ bool Cache::send(Request req) {
     if (mshr != mshr_entries.end()) {
       debug("hit mshr");
       cache_mshr_hit++;
-      mshr->second->dirty = dirty || mshr->second->dirty;
-      // FIXME: Shall we train the prefetcher on MSHR hit???
-      // if(prefetcher)
-      //    prefetcher->miss(req.addr, cachesys->clk);
-      
+      lines[mshr->second].dirty = dirty || lines[mshr->second].dirty;
+      if (level == Level::L3 && req.type == Request::Type::READ) {
+        cachesys->merged_requests.emplace(align(req.addr), req.coreid);
+      }
+
       // upgrade the previous prefetch request to demand request so the
       // processor will be informed on completion of the request
-      if (prefetcher && (req.type == Request::Type::READ) && mshr->second->is_prefetch){
+      if (prefetcher && (req.type == Request::Type::READ) && lines[mshr->second].is_prefetch){
+        cache_prefetch_late++;
         bool is_upgraded = cachesys->upgrade_prefetch_req(align(req.addr));
         if(!is_upgraded)
             printf("Address of the request failed to upgrade: %ld\n", align(req.addr));
         assert(is_upgraded && "ERROR: Failed to upgrade a PREFETCH request to READ!");
-        mshr->second->is_prefetch = false;
+        lines[mshr->second].is_prefetch = false;
+        // the demand access still follows the pattern the prefetcher predicted
+        prefetcher->late(req.addr, cachesys->clk);
       }
 
       return true;
     }
 
+    if (inclusion == Inclusion::Exclusive && req.type == Request::Type::READ) {
+      // Demand misses are filled only into the higher levels
+      cachesys->add_to_wait_list(cachesys->clk + latency[int(level)], req);
+      cache_demand_miss_issued++;
+      if (prefetcher) {
+        prefetcher->miss(req.addr, cachesys->clk);
+      }
+      return true;
+    }
+
     // All requests come to this stage will be READ, so they
     // should be recorded in MSHR entries.
     if (mshr_entries.size() == mshr_entry_num) {
@@ -221,27 +294,38 @@ bool Cache::send(Request req) {
     }
 
     // Check whether there is a line available
-    if (all_sets_locked(lines)) {
+    if (all_sets_locked(set)) {
       cache_set_unavailable++;
       return false;
     }
 
-    auto newline = allocate_line(lines, req.addr);
-    if (newline == lines.end()) {
+    int newline = allocate_line(set, req.addr);
+    if (newline < 0) {
       return false;
     }
 
-    newline->dirty = dirty;
+    lines[newline].dirty = dirty;
 
     // Add to MSHR entries
-    mshr_entries.push_back(make_pair(req.addr, newline));
+    auto new_mshr = mshr_entries.insert(make_pair(align(req.addr), newline)).first;
 
     // Send the request to next level;
     if (!is_last_level) {
-      lower_cache->send(req);
+      if (!lower_cache->send(req)) {
+        // The lower level cannot take the miss (e.g., its MSHRs are
+        // occupied by prefetches), so the access is retried later
+        mshr_entries.erase(new_mshr);
+        remove_line(set, newline, false);
+        return false;
+      }
     } else {
-      cachesys->wait_list.push_back(
-          make_pair(cachesys->clk + latency[int(level)], req));
+      cachesys->add_to_wait_list(cachesys->clk + latency[int(level)], req);
+    }
+
+    if (req.type == Request::Type::PREFETCH) {
+      cache_prefetch_issued++;
+    } else {
+      cache_demand_miss_issued++;
     }
 
     if (prefetcher) {
@@ -249,7 +333,7 @@ bool Cache::send(Request req) {
             prefetcher->miss(req.addr, cachesys->clk);
         } else {
             assert(req.type == Request::Type::PREFETCH);
-            newline->is_prefetch = true;
+            lines[newline].is_prefetch = true;
         }
     }
 
@@ -259,38 +343,89 @@ bool Cache::send(Request req) {
 
 void Cache::evictline(long addr, bool dirty) {
 
-  auto it = cache_lines.find(get_index(addr));
-  assert(it != cache_lines.end()); // check inclusive cache
-  auto& lines = it->second;
-  auto line = find_if(lines.begin(), lines.end(),
-      [addr, this](Line l){return (l.tag == get_tag(addr));});
+  int set = get_index(addr);
+  int line = find_line(set, get_tag(addr));
+
+  if (line < 0) {
+    // Only an inclusive cache always holds the lines of the higher levels
+    assert(inclusion != Inclusion::Inclusive);
+    if (inclusion == Inclusion::Exclusive) {
+      // The evicted line moves to this level
+      line = allocate_line(set, addr);
+      if (line >= 0) {
+        lines[line] = Line(addr, false, dirty);
+        return;
+      }
+    }
+    if (dirty) {
+      writeback(addr, 0);
+    }
+    return;
+  }
+
+  if (lines[line].lock) {
+    // A prefetch of the line is still in flight
+    assert(inclusion != Inclusion::Inclusive);
+    lines[line].dirty = dirty || lines[line].dirty;
+    return;
+  }
 
-  assert(line != lines.end());
   // Update LRU queue. The dirty bit will be set if the dirty
   // bit inherited from higher level(s) is set.
-  lines.push_back(Line(addr, get_tag(addr), false,
-      dirty || line->dirty));
-  lines.erase(line);
+  lines[line] = Line(addr, false, dirty || lines[line].dirty);
+  replacement->hit(set, line);
+}
+
+void Cache::writeback(long addr, long delay) {
+  assert(is_last_level);
+  Request write_req(addr, Request::Type::WRITE);
+  cachesys->add_to_wait_list(
+      cachesys->clk + delay + latency[int(level)],
+      write_req);
+
+  debug("inject one write request to memory system "
+      "addr %lx, delay %ld, issue time %ld",
+      write_req.addr, delay,
+      cachesys->clk + delay + latency[int(level)]);
+}
+
+void Cache::move_up(int set, int slot) {
+  if (lines[slot].dirty) {
+    bool moved = false;
+    for (auto hc : higher_cache) {
+      auto mshr = hc->hit_mshr(lines[slot].addr);
+      if (mshr != hc->mshr_entries.end()) {
+        hc->lines[mshr->second].dirty = true;
+        moved = true;
+        break;
+      }
+    }
+    if (!moved) {
+      writeback(lines[slot].addr, 0);
+    }
+  }
+  remove_line(set, slot, false);
 }
 
 std::pair<long, bool> Cache::invalidate(long addr) {
   long delay = latency_each[int(level)];
   bool dirty = false;
 
-  auto& lines = get_lines(addr);
-  if (lines.size() == 0) {
+  int set = get_index(addr);
+  if (set_sizes[set] == 0) {
     // The line of this address doesn't exist.
     return make_pair(0, false);
   }
-  auto line = find_if(lines.begin(), lines.end(),
-      [addr, this](Line l){return (l.tag == get_tag(addr));});
+  int line = find_line(set, get_tag(addr));
+  bool line_dirty = false;
 
   // If the line is in this level cache, then erase it from
   // the buffer.
-  if (line != lines.end()) {
-    assert(!line->lock);
+  if (line >= 0) {
+    assert(!lines[line].lock);
     debug("invalidate %lx @ level %d", addr, int(level));
-    lines.erase(line);
+    line_dirty = lines[line].dirty;
+    remove_line(set, line, false);
   } else {
     // If it's not in current level, then no need to go up.
     return make_pair(delay, false);
@@ -305,32 +440,35 @@ std::pair<long, bool> Cache::invalidate(long addr) {
       } else {
         max_delay = max(max_delay, delay + result.first);
       }
-      dirty = dirty || line->dirty || result.second;
+      dirty = dirty || line_dirty || result.second;
     }
     delay = max_delay;
   } else {
-    dirty = line->dirty;
+    dirty = line_dirty;
   }
   return make_pair(delay, dirty);
 }
 
 
-void Cache::evict(std::list<Line>* lines,
-    std::list<Line>::iterator victim) {
-  debug("level %d miss evict victim %lx", int(level), victim->addr);
+void Cache::evict(int set, int victim) {
+  debug("level %d miss evict victim %lx", int(level), lines[victim].addr);
   cache_eviction++;
 
-  long addr = victim->addr;
+  long addr = lines[victim].addr;
   long invalidate_time = 0;
-  bool dirty = victim->dirty;
+  bool dirty = lines[victim].dirty;
+
+  if (lines[victim].is_prefetch) {
+    cache_prefetch_unused++;
+  }
 
   // First invalidate the victim line in higher level.
-  if (higher_cache.size()) {
+  if (higher_cache.size() && inclusion == Inclusion::Inclusive) {
     for (auto hc : higher_cache) {
       auto result = hc->invalidate(addr);
       invalidate_time = max(invalidate_time,
           result.first + (result.second ? latency_each[int(level)] : 0));
-      dirty = dirty || result.second || victim->dirty;
+      dirty = dirty || result.second || lines[victim].dirty;
     }
   }
 
@@ -344,63 +482,51 @@ void Cache::evict(std::list<Line>* lines,
   } else {
     // LLC eviction
     if (dirty) {
-      Request write_req(addr, Request::Type::WRITE);
-      cachesys->wait_list.push_back(make_pair(
-          cachesys->clk + invalidate_time + latency[int(level)],
-          write_req));
-
-      debug("inject one write request to memory system "
-          "addr %lx, invalidate time %ld, issue time %ld",
-          write_req.addr, invalidate_time,
-          cachesys->clk + invalidate_time + latency[int(level)]);
+      writeback(addr, invalidate_time);
     }
   }
 
-  lines->erase(victim);
+  remove_line(set, victim, true);
 }
 
-std::list<Cache::Line>::iterator Cache::allocate_line(
-    std::list<Line>& lines, long addr) {
+int Cache::allocate_line(int set, long addr) {
   // See if an eviction is needed
-  if (need_eviction(lines, addr)) {
-    // Get victim.
-    // The first one might still be locked due to reorder in MC
-    auto victim = find_if(lines.begin(), lines.end(),
-        [this](Line line) {
-          bool check = !line.lock;
-          if (!is_first_level) {
+  if (need_eviction(set, addr)) {
+    // Get victim among the lines that are unlocked.
+    // The line the policy prefers might still be locked due to reorder in MC
+    int victim = replacement->victim(set, [this](int slot) {
+          bool check = !lines[slot].lock;
+          // The higher levels keep their copies unless this cache is inclusive
+          if (!is_first_level && inclusion == Inclusion::Inclusive) {
             for (auto hc : higher_cache) {
               if(!check) {
                 return check;
               }
-              check = check && hc->check_unlock(line.addr);
+              check = check && hc->check_unlock(lines[slot].addr);
             }
           }
           return check;
         });
-    if (victim == lines.end()) {
+    if (victim < 0) {
       return victim;  // doesn't exist a line that's already unlocked in each level
     }
-    assert(victim != lines.end());
-    evict(&lines, victim);
+    evict(set, victim);
   }
 
   // Allocate newline, with lock bit on and dirty bit off
-  lines.push_back(Line(addr, get_tag(addr)));
-  auto last_element = lines.end();
-  --last_element;
-  return last_element;
+  int slot = find_line(set, invalid_tag);
+  assert(slot >= 0);
+  insert_line(set, slot, get_tag(addr), Line(addr));
+  return slot;
 }
 
-bool Cache::is_hit(std::list<Line>& lines, long addr,
-    std::list<Line>::iterator* pos_ptr) {
-  auto pos = find_if(lines.begin(), lines.end(),
-      [addr, this](Line l){return (l.tag == get_tag(addr));});
+bool Cache::is_hit(int set, long addr, int* pos_ptr) {
+  int pos = find_line(set, get_tag(addr));
   *pos_ptr = pos;
-  if (pos == lines.end()) {
+  if (pos < 0) {
     return false;
   }
-  return !pos->lock;
+  return !lines[pos].lock;
 }
 
 void Cache::concatlower(Cache* lower) {
@@ -409,15 +535,12 @@ void Cache::concatlower(Cache* lower) {
   lower->higher_cache.push_back(this);
 };
 
-bool Cache::need_eviction(const std::list<Line>& lines, long addr) {
-  if (find_if(lines.begin(), lines.end(),
-      [addr, this](Line l){
-        return (get_tag(addr) == l.tag);})
-      != lines.end()) {
+bool Cache::need_eviction(int set, long addr) {
+  if (find_line(set, get_tag(addr)) >= 0) {
     // Due to MSHR, the program can't reach here. Just for checking
     assert(false);
   } else {
-    if (lines.size() < assoc) {
+    if (set_sizes[set] < assoc) {
       return false;
     } else {
       return true;
@@ -432,13 +555,17 @@ void Cache::callback(Request& req) {
   //if(is_last_level)
       //printf("LLC: callback req type %d, addr %ld\n", req.type, req.addr);
 
-  auto it = find_if(mshr_entries.begin(), mshr_entries.end(),
-      [&req, this](std::pair<long, std::list<Line>::iterator> mshr_entry) {
-        return (align(mshr_entry.first) == align(req.addr));
-      });
+  auto it = mshr_entries.find(align(req.addr));
 
   if (it != mshr_entries.end()) {
-    it->second->lock = false;
+    lines[it->second].lock = false;
+    if (prefetcher) {
+      prefetcher->fill(req.addr, cachesys->clk, lines[it->second].is_prefetch);
+    }
+    if (inclusion == Inclusion::Exclusive && req.type != Request::Type::PREFETCH) {
+      // A demand miss merged into the prefetch of this line
+      move_up(get_index(req.addr), it->second);
+    }
     mshr_entries.erase(it);
   }
 
@@ -464,22 +591,22 @@ void CacheSystem::tick() {
 
       debug("complete req: addr %lx", (it->second).addr);
 
+      auto pref_it = wait_list_prefetches.find((it->second).addr);
+      if (pref_it != wait_list_prefetches.end() && pref_it->second == it) {
+        wait_list_prefetches.erase(pref_it);
+      }
       it = wait_list.erase(it);
     }
   }
 
   // hit request callback
   it = hit_list.begin();
-  while (it != hit_list.end()) {
-    if (clk >= it->first) {
-      it->second.callback(it->second);
+  while (it != hit_list.end() && clk >= it->first) {
+    it->second.callback(it->second);
 
-      debug("finish hit: addr %lx", (it->second).addr);
+    debug("finish hit: addr %lx", (it->second).addr);
 
-      it = hit_list.erase(it);
-    } else {
-      ++it;
-    }
+    it = hit_list.erase(it);
   }
 }
 
@@ -491,18 +618,14 @@ bool CacheSystem::upgrade_prefetch_req(long addr) {
     //}
     //printf("---\n\n");
 
-    if(wait_list.size() != 0){
-
-        auto pref_req = find_if(wait_list.begin(), wait_list.end(), 
-                                                [addr](pair<long, Request>& preq) {
-                        return (addr == preq.second.addr) && preq.second.type == Request::Type::PREFETCH;});
-
-        if (pref_req != wait_list.end()) {
-            (pref_req->second).type = Request::Type::READ;
-            (pref_req->second).callback = (pref_req->second).proc_callback; // FIXME: proc_callback is an ugly workaround
-            return true;
-        }
-     }
+    auto pref_it = wait_list_prefetches.find(addr);
+    if (pref_it != wait_list_prefetches.end()) {
+        auto pref_req = pref_it->second;
+        (pref_req->second).type = Request::Type::READ;
+        (pref_req->second).callback = (pref_req->second).proc_callback; // FIXME: proc_callback is an ugly workaround
+        wait_list_prefetches.erase(pref_it);
+        return true;
+    }
 
     return upgrade_prefetch_req_in_mem(addr);
 }
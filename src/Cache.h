@@ -2,9 +2,10 @@
 #define __CACHE_H
 
 #include "Config.h"
+#include "Prefetcher.h"
+#include "ReplacementPolicy.h"
 #include "Request.h"
 #include "Statistics.h"
-#include "StridePrefetcher.h"
 #include <algorithm>
 #include <cstdio>
 #include <cassert>
@@ -14,6 +15,8 @@
 #include <memory>
 #include <queue>
 #include <list>
+#include <unordered_map>
+#include <vector>
 
 namespace ramulator
 {
@@ -34,6 +37,17 @@ protected:
   ScalarStat cache_mshr_hit;
   ScalarStat cache_mshr_unavailable;
   ScalarStat cache_set_unavailable;
+  // Prefetch effectiveness. A prefetched line is useful if a demand
+  // access hits it and late if a demand access merges into its MSHR.
+  // The miss counters above include retries, so the ratios are based on
+  // the misses that were actually sent to the lower level.
+  ScalarStat cache_demand_miss_issued;
+  ScalarStat cache_prefetch_issued;
+  ScalarStat cache_prefetch_useful;
+  ScalarStat cache_prefetch_late;
+  ScalarStat cache_prefetch_unused;
+  ScalarStat cache_prefetch_accuracy;
+  ScalarStat cache_prefetch_coverage;
 public:
   enum class Level {
     L1,
@@ -43,32 +57,46 @@ public:
   } level;
   std::string level_string;
 
+  // The tag of a line is stored separately in tags (see below)
   struct Line {
     long addr;
-    long tag;
     bool lock; // When the lock is on, the value is not valid yet.
     bool dirty;
     bool is_prefetch;
-    Line(long addr, long tag):
-        addr(addr), tag(tag), lock(true), dirty(false), is_prefetch(false) {}
-    Line(long addr, long tag, bool lock, bool dirty):
-        addr(addr), tag(tag), lock(lock), dirty(dirty), is_prefetch(false) {}
+    Line():
+        addr(0), lock(false), dirty(false), is_prefetch(false) {}
+    Line(long addr):
+        addr(addr), lock(true), dirty(false), is_prefetch(false) {}
+    Line(long addr, bool lock, bool dirty):
+        addr(addr), lock(lock), dirty(dirty), is_prefetch(false) {}
   };
 
+  // Inclusion of the higher level caches in the last level cache.
+  // Non-inclusive: an LLC eviction does not invalidate the higher
+  // levels. Exclusive: demand misses bypass the LLC, a demand hit moves
+  // the line to the higher level, and the lines evicted from the higher
+  // levels are inserted into the LLC. The other levels are inclusive.
+  enum class Inclusion {
+    Inclusive,
+    NonInclusive,
+    Exclusive,
+    MAX
+  } inclusion = Inclusion::Inclusive;
+
   Cache(int size, int assoc, int block_size, int mshr_entry_num,
-      Level level, std::shared_ptr<CacheSystem> cachesys);
+      Level level, std::shared_ptr<CacheSystem> cachesys,
+      const std::string& replacement = "LRU");
 
   // L1, L2, L3 accumulated latencies
-  int latency[int(Level::MAX)] = {4, 4 + 12, 4 + 12 + 31};
-  int latency_each[int(Level::MAX)] = {4, 12, 31};
+  int latency[int(Level::MAX)];
+  int latency_each[int(Level::MAX)];
 
   std::shared_ptr<CacheSystem> cachesys;
   // LLC has multiple higher caches
   std::vector<Cache*> higher_cache;
   Cache* lower_cache;
 
-  StridePrefetcher* prefetcher; // FIXME: Change the type to a base class for prefetchers
-                                // after implementing multiple types of prefetchers
+  std::unique_ptr<Prefetcher> prefetcher;
 
   bool send(Request req);
 
@@ -76,6 +104,9 @@ public:
 
   void callback(Request& req);
 
+  // Computes the derived statistics at the end of the simulation
+  void finish();
+
 protected:
 
   bool is_first_level;
@@ -88,9 +119,18 @@ protected:
   unsigned int index_offset;
   unsigned int tag_offset;
   unsigned int mshr_entry_num;
-  std::vector<std::pair<long, std::list<Line>::iterator>> mshr_entries;
+  // aligned block address -> slot of the line allocated for the miss
+  std::unordered_map<long, int> mshr_entries;
+
+  // Flat set-associative storage. The lines of set i occupy the slots
+  // [i * assoc, (i + 1) * assoc) of tags and lines. Tags are kept in
+  // their own array so that a tag match scans contiguous memory.
+  static constexpr long invalid_tag = -1;
+  std::vector<long> tags;
+  std::vector<Line> lines;
+  std::vector<unsigned int> set_sizes; // number of valid lines in each set
 
-  std::map<int, std::list<Line> > cache_lines;
+  std::unique_ptr<ReplacementPolicy> replacement;
 
   int calc_log2(int val) {
       int n = 0;
@@ -116,39 +156,70 @@ protected:
   // Pass the dirty bit and update LRU queue.
   void evictline(long addr, bool dirty);
 
+  // Send a write request for the line to memory (LLC only)
+  void writeback(long addr, long delay);
+
+  // Exclusive LLC: remove the line, which moves to the higher level.
+  // Its dirty bit goes to the higher level cache that missed on it.
+  void move_up(int set, int slot);
+
   // Invalidate the line from this level to higher levels
   // The return value is a pair. The first element is invalidation
   // latency, and the second is wether the value has new version
   // in higher level and this level.
   std::pair<long, bool> invalidate(long addr);
 
-  // Evict the victim from current set of lines.
+  // Evict the victim slot from the set.
   // First do invalidation, then call evictline(L1 or L2) or send
   // a write request to memory(L3) when dirty bit is on.
-  void evict(std::list<Line>* lines,
-      std::list<Line>::iterator victim);
+  void evict(int set, int victim);
 
   // First test whether need eviction, if so, do eviction by
   // calling evict function. Then allocate a new line and return
-  // the iterator points to it.
-  std::list<Line>::iterator allocate_line(
-      std::list<Line>& lines, long addr);
+  // its slot, or -1 if no line can be evicted.
+  int allocate_line(int set, long addr);
 
   // Check whether the set to hold addr has space or eviction is
   // needed.
-  bool need_eviction(const std::list<Line>& lines, long addr);
+  bool need_eviction(int set, long addr);
 
   // Check whether this addr is hit and fill in the pos_ptr with
-  // the iterator to the hit line or lines.end()
-  bool is_hit(std::list<Line>& lines, long addr,
-              std::list<Line>::iterator* pos_ptr);
+  // the slot of the hit line or -1
+  bool is_hit(int set, long addr, int* pos_ptr);
+
+  // Returns the slot of the line with the tag in the set, or -1
+  int find_line(int set, long tag) const {
+    const long* set_tags = &tags[set * assoc];
+    int way = -1;
+    // Branch-free so that the compiler can vectorize the tag
+    // comparison. Tags are unique within a set.
+    for (unsigned int w = 0; w < assoc; w++) {
+      way = (set_tags[w] == tag) ? int(w) : way;
+    }
+    return (way < 0) ? -1 : int(set * assoc) + way;
+  }
+
+  // Fill the invalid slot with a new line
+  void insert_line(int set, int slot, long tag, const Line& line) {
+    assert(tags[slot] == invalid_tag);
+    tags[slot] = tag;
+    lines[slot] = line;
+    set_sizes[set]++;
+    replacement->insert(set, slot, line.addr);
+  }
 
-  bool all_sets_locked(const std::list<Line>& lines) {
-    if (lines.size() < assoc) {
+  void remove_line(int set, int slot, bool evicted) {
+    tags[slot] = invalid_tag;
+    set_sizes[set]--;
+    replacement->remove(set, slot, evicted);
+  }
+
+  bool all_sets_locked(int set) {
+    if (set_sizes[set] < assoc) {
       return false;
     }
-    for (const auto& line : lines) {
-      if (!line.lock) {
+    for (unsigned int i = set * assoc; i < (set + 1) * assoc; i++) {
+      if (!lines[i].lock) {
         return false;
       }
     }
@@ -156,38 +227,25 @@ protected:
   }
 
   bool check_unlock(long addr) {
-    auto it = cache_lines.find(get_index(addr));
-    if (it == cache_lines.end()) {
+    int line = find_line(get_index(addr), get_tag(addr));
+    if (line < 0) {
       return true;
     } else {
-      auto& lines = it->second;
-      auto line = find_if(lines.begin(), lines.end(),
-          [addr, this](Line l){return (l.tag == get_tag(addr));});
-      if (line == lines.end()) {
-        return true;
-      } else {
-        bool check = !line->lock;
-        if (!is_first_level) {
-          for (auto hc : higher_cache) {
-            if (!check) {
-              return check;
-            }
-            check = check && hc->check_unlock(line->addr);
+      bool check = !lines[line].lock;
+      if (!is_first_level) {
+        for (auto hc : higher_cache) {
+          if (!check) {
+            return check;
           }
+          check = check && hc->check_unlock(lines[line].addr);
         }
-        return check;
       }
+      return check;
     }
   }
 
-  std::vector<std::pair<long, std::list<Line>::iterator>>::iterator
-  hit_mshr(long addr) {
-    auto mshr_it =
-        find_if(mshr_entries.begin(), mshr_entries.end(),
-            [addr, this](std::pair<long, std::list<Line>::iterator>
-                   mshr_entry) {
-              return (align(mshr_entry.first) == align(addr));
-            });
+  std::unordered_map<long, int>::iterator hit_mshr(long addr) {
+    auto mshr_it = mshr_entries.find(align(addr));
 
     //debug
     //if(mshr_it != mshr_entries.end())
@@ -195,15 +253,6 @@ protected:
     return mshr_it;
   }
 
-  std::list<Line>& get_lines(long addr) {
-    if (cache_lines.find(get_index(addr))
-        == cache_lines.end()) {
-      cache_lines.insert(make_pair(get_index(addr),
-          std::list<Line>()));
-    }
-    return cache_lines[get_index(addr)];
-  }
-
 };
 
 class CacheSystem {
@@ -211,6 +260,24 @@ public:
   CacheSystem(const Config& configs, std::function<bool(Request)> send_memory,
                                      std::function<bool(long)> upgrade_prefetch_req):
     send_memory(send_memory), upgrade_prefetch_req_in_mem(upgrade_prefetch_req) {
+      latency_each[int(Cache::Level::L1)] = configs.get_int("l1_latency");
+      latency_each[int(Cache::Level::L2)] = configs.get_int("l2_latency");
+      latency_each[int(Cache::Level::L3)] = configs.get_int("l3_latency");
+
+      const std::string& inclusion = configs.get_str("llc_inclusion");
+      if (inclusion == "inclusive") {
+        llc_inclusion = Cache::Inclusion::Inclusive;
+      } else if (inclusion == "non_inclusive") {
+        llc_inclusion = Cache::Inclusion::NonInclusive;
+      } else if (inclusion == "exclusive") {
+        llc_inclusion = Cache::Inclusion::Exclusive;
+      } else {
+        assert(false && "ERROR: llc_inclusion must be inclusive, non_inclusive, or exclusive.");
+      }
+      // without private caches, the LLC has no higher level to include
+      assert((llc_inclusion == Cache::Inclusion::Inclusive || configs.has_core_caches()) &&
+          "ERROR: Non-inclusive and exclusive LLCs require private caches (cache = all).");
+
       if (configs.has_core_caches()) {
         first_level = Cache::Level::L1;
       } else if (configs.has_l3_cache()) {
@@ -228,15 +295,40 @@ public:
       }
     }
 
+  // Both lists are keyed by the cycle the request becomes ready.
+  // Requests that become ready in the same cycle keep their
+  // insertion order (multimap inserts at the end of an equal range).
+
   // wait_list contains miss requests with their latencies in
   // cache. When this latency is met, the send_memory function
   // will be called to send the request to the memory system.
-  std::list<std::pair<long, Request> > wait_list;
+  std::multimap<long, Request> wait_list;
 
   // hit_list contains hit requests with their latencies in cache.
   // callback function will be called when this latency is met and
   // set the instruction status to ready in processor's window.
-  std::list<std::pair<long, Request> > hit_list;
+  std::multimap<long, Request> hit_list;
+
+  // PREFETCH requests in wait_list indexed by address, for
+  // upgrade_prefetch_req
+  std::unordered_map<long, std::multimap<long, Request>::iterator> wait_list_prefetches;
+
+  void add_to_wait_list(long ready_clk, const Request& req) {
+    auto it = wait_list.insert(make_pair(ready_clk, req));
+    if (req.type == Request::Type::PREFETCH) {
+      wait_list_prefetches.insert(make_pair(req.addr, it));
+    }
+  }
+
+  void add_to_hit_list(long ready_clk, const Request& req) {
+    hit_list.insert(make_pair(ready_clk, req));
+  }
+
+  // Cores whose demand misses merged into an MSHR of the shared L3, by
+  // aligned address. The response of the MSHR carries the
+  // core id of the request that allocated it, so the processor also
+  // notifies these cores when it arrives.
+  std::unordered_multimap<long, int> merged_requests;
 
   std::function<bool(Request)> send_memory;
   std::function<bool(long)> upgrade_prefetch_req_in_mem;
@@ -247,6 +339,10 @@ public:
 
   Cache::Level first_level;
   Cache::Level last_level;
+
+  // Access latency of each level in CPU cycles
+  int latency_each[int(Cache::Level::MAX)];
+  Cache::Inclusion llc_inclusion;
 };
 
 } // namespace ramulator
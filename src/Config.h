@@ -53,6 +53,14 @@ private:
         {"disable_refresh", "false"},
         {"refresh_mult", "1.0f"},
         {"per_bank_refresh", "false"},
+        {"darp_refresh", "false"}, // out-of-order per-bank refresh (DARP, Chang et al., HPCA 2014). Requires per_bank_refresh
+        {"rfm_raaimt", "0"}, // DDR5 only. 0 disables RFM
+        // The address fields from the most to the least significant bits, using Ch, Ra, Bg, Ba, Sa, Ro, and Co (e.g., RoSaBaBgRaCoCh).
+        // RoSaBaRaCoCh and ChRaBaSaRoCo are also accepted. The _SaInterleaved suffix rotates the subarray index by the bank index
+        // (spreads sequential rows across subarrays, recommended for smd_mode = ALERT)
+        {"address_mapping", "RoSaBaRaCoCh"},
+        {"address_mapping_file", "none"}, // maps each bit of each level to address bits (see AddressMapping.h). Overrides address_mapping
+        {"address_mapping_xor", "none"}, // levels to XOR with the low row bits to spread row conflicts across banks, e.g., "Ba,Bg"
 
         // CPU
         {"cores", "1"},
@@ -62,11 +70,44 @@ private:
         {"expected_limit_insts", "200000000"},
         {"warmup_insts", "100000000"},
         {"translation", "Random"},
+        // Simulate the cores on this many threads (0 ticks the cores in lockstep). The cores run ahead of the
+        // memory system for parallel_quantum CPU cycles at a time, so they see responses up to that many cycles late.
+        // The results differ from lockstep by the perturbation of the DRAM schedule this causes (measured within
+        // +-1.3% on 4 cores with filtered DDR4 traces, without a trend from quantum 1 to 64)
+        {"parallel_threads", "0"},
+        {"parallel_quantum", "64"},
+        {"page_size", "4KB"}, // 4KB or 2MB
+        // Restricts the frames of each core to a partition of the banks,
+        // the subarrays, or both: off, bank, subarray, or bank_subarray.
+        // Requires translation = Random
+        {"page_coloring", "off"},
+        // The colors of each core, e.g., "0-7;8-15". Core i uses entry i
+        // modulo the number of entries. "even" splits the colors evenly
+        {"page_coloring_partitions", "even"},
 
         // Cache
         {"cache", "L3"},
+        // Private caches of each core. Sizes are in bytes, latencies in CPU cycles
+        {"l1_size", "32768"},
+        {"l1_assoc", "8"},
+        {"l1_mshr_num", "16"},
+        {"l1_latency", "4"},
+        {"l2_size", "262144"},
+        {"l2_assoc", "8"},
+        {"l2_mshr_num", "16"},
+        {"l2_latency", "12"},
+        // Shared LLC
         {"l3_size", "4194304"},
-        {"prefetcher", "off"}, // "off" or "stride"
+        {"l3_assoc", "8"},
+        {"l3_mshr_per_core", "16"},
+        {"l3_latency", "31"},
+        // Inclusion of the private caches in the LLC: inclusive, non_inclusive, or exclusive
+        {"llc_inclusion", "inclusive"},
+        // Replacement policy of each cache level: LRU, SRRIP, DRRIP, or SHiP
+        {"l1_replacement", "LRU"},
+        {"l2_replacement", "LRU"},
+        {"l3_replacement", "LRU"},
+        {"prefetcher", "off"}, // "off", "stride", "next_line", "stream", or "bop" (Best-Offset)
 
         // Stride Prefetcher
         {"stride_pref_entries", "1024"},
@@ -77,6 +118,14 @@ private:
         {"stride_pref_stride_degree", "4"},
         {"stride_pref_stride_dist", "16"},
 
+        // Next-line Prefetcher
+        {"next_line_pref_degree", "1"},
+
+        // Stream Prefetcher
+        {"stream_pref_entries", "32"},
+        {"stream_pref_degree", "4"},
+        {"stream_pref_distance", "16"},
+
         // Other
         {"record_cmd_trace", "off"},
         {"print_cmd_trace", "off"},
@@ -98,9 +147,16 @@ private:
         {"graphene_debug", "off"},
         {"graphene_debug_verbose", "off"},
         {"graphene_rowpress", "off"},
-        {"graphene_rowpress_increment_nticks", "0"},
+        {"graphene_rowpress_increment_nticks", "0"}, // every this many cycles a row stays open beyond tRAS count as one more activation. 0 means nRAS
 
         // DDR4 Maintenance Operations
+        {"enable_blockhammer", "off"},
+        {"blockhammer_bloom_filter_size", "1024"},
+        {"blockhammer_bloom_filter_hashes", "4"},
+        {"blockhammer_blacklist_threshold", "8192"}, // N_BL: a row is blacklisted after this many ACTs within a CBF lifetime
+        {"blockhammer_rowhammer_threshold", "32768"}, // N_RH: a blacklisted row cannot receive more ACTs than this within a CBF lifetime
+        {"blockhammer_cbf_lifetime", "64000000"}, // in nanoseconds
+
         {"enable_para", "off"},
         {"para_neighbor_refresh_pct", "1"}, // a number between 0-100 (%) indicating the probability to trigger neighbor row refresh
 
@@ -110,13 +166,21 @@ private:
         // Self-Managing DRAM (SMD)
         {"smd", "off"},
         {"smd_mode", "RSQ"}, // RSQ (refresh status query) or ALERT or ACT_NACK
-        {"smd_ref_policy", "FixedRate"},
+        {"smd_ref_policy", "FixedRate"}, // FixedRate or VariableRefresh or AccessAware or NoRefresh
         {"smd_num_ref_machines", "4"},
         {"smd_refresh_period", "102400000"}, // 102400000 cycles = 64ms at 1600Mhz (i.e., 3200 data rate)
         {"smd_row_refresh_granularity", "8"}, // means 8 rows are refreshed from one subarray once locked
         {"smd_timeout_to_ref_interval_ratio", "0.5"},
         {"smd_single_ref_latency", "80"}, // 80 cycles = 50ns at 1600Mhz (i.e., 3200 data rate) When 'auto', smd_single_ref_latency is overwritten based on average refresh latency per row of the regular DRAM refresh, i.e., (8192*tRFC)/NUM_ROWS_PER_BANK
         {"smd_pending_ref_limit", "9"},
+        {"smd_predictive_maint", "false"}, // ACT_NACK mode only. When true, MaintenanceMachines defer maintenance in SAs that are recently activated or targeted by queued requests
+        {"smd_predictive_maint_window", "200"}, // an SA activated within this many cycles is predicted to be accessed again
+        {"smd_predictive_maint_slack", "4"}, // maintenance is deferred only while the bank has at most this many pending operations. Must be smaller than smd_pending_ref_limit
+        {"smd_max_locked_SAs_per_bank", "1"}, // values above 1 model MASA-style SA-level parallelism (SALP), i.e., a chip maintains multiple SAs of the same bank concurrently
+        {"smd_coalesce_maint", "false"}, // when true, refresh, scrubbing, and neighbor row refresh operations pending on the same SA are performed within a single lock window
+        {"smd_adaptive_maint_machines", "false"}, // when true, a maintenance policy activates/deactivates MaintenanceMachines based on its backlog. smd_num_ref_machines (smd_num_scrubbing_machines) is then the initial number of machines, capped at smd_max_maint_machines
+        {"smd_max_maint_machines", "16"}, // the maximum number of active MaintenanceMachines per policy with smd_adaptive_maint_machines
+        {"smd_maint_machines_shrink_intervals", "8"}, // deactivate a MaintenanceMachine after this many consecutive maintenance intervals with at most one pending operation per bank
         {"smd_max_row_open_intervals", "8"},
         {"smd_act_to_nack_cycles", "4"},
         // to read out an entire row, the row needs to remain open for about 355ns (from the cycle ACT is issued until the PRE is issued). 
@@ -135,6 +199,9 @@ private:
         {"smd_variable_refresh_bloom_filter_size", "8192"},
         {"smd_variable_refresh_bloom_filter_hashes", "6"},
 
+        // SMD Access-Aware Refresh
+        {"smd_access_aware_refresh_subwindows", "2"}, // the refresh counters visit every row this many times per refresh period. A row activated since the last visit is refreshed later
+
         // SMD Memory Scrubbing
         {"smd_ecc_scrubbing_enabled", "false"},
         {"smd_scrubbing_lock_region", "bank"}, // valid entries: 'bank' and 'region'. When bank, scrubbing puts an entire bank under maintenance whereas region operates as in smd refresh
@@ -147,7 +214,7 @@ private:
 
         // SMD RowHammer Protection
         {"smd_rh_protection_enabled", "false"},
-        {"smd_rh_protection_mode", "CBF"}, // CBF or PARA or Graphene. CBF is Counting Bloom Filter, similar to BlockHammer's aggressor detection logic
+        {"smd_rh_protection_mode", "CBF"}, // CBF or PARA or Graphene or PRAC or CMS. CBF is Counting Bloom Filter, similar to BlockHammer's aggressor detection logic. PRAC is DDR5-style per-row activation counting with alert back-off. CMS is a count-min sketch backed by a recent aggressor table, similar to CoMeT
         {"smd_rh_blast_radius", "1"}, // Indicates how many neighbor rows from each side of an aggressor will be refreshed
         {"smd_rh_neighbor_refresh_pct", "1"}, // a number between 0-100 (%) indicating the probability to trigger neighbor row refresh
         {"smd_rh_protection_bloom_filter_size", "8192"},
@@ -156,6 +223,13 @@ private:
         {"smd_rh_protection_bloom_filter_type", "blockhammer"}, // space_efficient or blockhammer
         {"smd_rh_protection_mac", "8192"},
         {"smd_rh_protection_neighbor_ref_queue_size", "1024"},
+        {"smd_rh_rowpress", "false"}, // Graphene mode only. Counts the time a row stays open beyond tRAS as additional activations
+        {"smd_rh_rowpress_increment_nticks", "0"}, // every this many cycles a row stays open beyond tRAS count as one more activation. 0 means nRAS
+        {"smd_rh_cms_size", "512"}, // CMS: the number of counters per hash function. Must be a power of two
+        {"smd_rh_cms_hashes", "4"}, // CMS: the number of hash functions, i.e., rows of counters
+        {"smd_rh_cms_rat_size", "128"}, // CMS: the number of entries in the recent aggressor table
+        {"smd_rh_prac_backoff_threshold", "4096"}, // PRAC: a chip asserts the Back-Off alert when a row's activation counter reaches this value
+        {"smd_rh_prac_num_rfm_windows", "1"}, // PRAC: the number of RFM-like mitigation windows the memory controller provides per Back-Off alert. Each window mitigates the most activated aggressor in every bank
 
         // DRAMPower
         {"dpower_memspec_path", "./configs/SMD_configs/16Gb_DDR4_3200_8bit.xml"},
@@ -23,6 +23,7 @@
 #include "Scheduler.h"
 #include "Statistics.h"
 #include "Graphene.h"
+#include "BlockHammer.h"
 
 // #include "ALDRAM.h"
 // #include "SALP.h"
@@ -70,6 +71,7 @@ protected:
     ScalarStat num_wr;
     ScalarStat num_wra;
     ScalarStat num_ref;
+    ScalarStat num_rfm;
     ScalarStat num_speculative_precharges;
 
     ScalarStat read_latency_avg;
@@ -123,6 +125,22 @@ protected:
     VectorStat smd_ref_status_timing_failures;
     VectorStat smd_no_bank_for_ref_status_update;
     VectorStat smd_total_ref_status_queries;
+    VectorStat smd_alerts_received;
+    VectorStat smd_ref_machines_active_cycles;
+    VectorStat smd_scrub_machines_active_cycles;
+    ScalarStat smd_max_active_ref_machines;
+    ScalarStat smd_max_active_scrub_machines;
+    VectorStat smd_prac_abo_alerts;
+    VectorStat smd_prac_backoff_cycles;
+    VectorStat blockhammer_throttled_acts;
+    ScalarStat rowpress_preventive_refreshes;
+    ScalarStat smd_acts_overlapping_maint;
+    ScalarStat smd_coalesced_refs;
+    ScalarStat smd_coalesced_scrubs;
+    ScalarStat smd_coalesced_neighbor_refs;
+    ScalarStat smd_coalesced_ref_lock_cycles_saved;
+    ScalarStat smd_coalesced_scrub_lock_cycles_saved;
+    ScalarStat smd_coalesced_neighbor_ref_lock_cycles_saved;
 
     ScalarStat smd_act_nack_cnt;
     ScalarStat smd_act_partial_nack_cnt;
@@ -157,8 +175,12 @@ public:
     RowPolicy<T>* rowpolicy;  // determines the row-policy (e.g., closed-row vs. open-row)
     RowTable<T>* rowtable;  // tracks metadata about rows (e.g., which are open and for how long)
     Refresh<T>* refresh;
+    // DARP statistics, updated by the refresh scheduler
+    ScalarStat num_ref_postponed;
+    ScalarStat num_ref_out_of_order;
     RAIDR<T> raidr;
     Graphene<T> graphene;
+    BlockHammer<T> blockhammer;
     MemoryScrubber<T>* scrubber;
 
     struct Queue {
@@ -243,6 +265,7 @@ public:
     // raidr variables
     bool enable_raidr = false;
     bool enable_graphene = false;
+    bool enable_blockhammer = false;
 
     // PARA random number generation
     std::mt19937 para_gen;
@@ -252,6 +275,12 @@ public:
     bool enable_scrubbing = false;
 
     bool is_DDR4 = false, is_LPDDR4 = false; // Hasan
+    bool is_DDR5 = false, is_HBM = false;
+
+    // DDR5 refresh management (RFM): an RFM is issued to a bank once its rolling accumulated ACT (RAA) counter reaches RAAIMT
+    uint32_t rfm_raaimt = 0;
+    std::vector<std::vector<uint32_t>> rfm_raa_counters; // per rank, per bank
+    std::vector<std::vector<bool>> rfm_pending; // per rank, per bank
 
     CROWTable<T>* crow_table = nullptr;
     int* ref_counters;
@@ -263,9 +292,13 @@ public:
     
     bool refresh_disabled = false;
     bool per_bank_refresh_on = false;
+    bool darp_refresh_on = false;
     bool smd_enabled = false;
     bool smd_ecc_scrubbing_enabled = false;
     bool smd_rh_protection_enabled = false;
+    bool smd_rh_rowpress = false;
+    bool smd_prac_enabled = false;
+    std::vector<long> smd_prac_backoff_until; // per rank. The memory controller does not issue ACTs to the rank until this clk
     SMD_MODE smd_mode;
     uint32_t smd_max_row_open_intervals = 8;
     uint32_t smd_act_to_nack_cycles = 0;
@@ -273,12 +306,12 @@ public:
     int smd_partial_nack_combined_threshold = 0;
     int smd_partial_nack_resend_interval = 0;
 
+    SMDContext smd_ctx; // lock state and tracker timeouts shared by the SMD policies and trackers of this channel
     SMDTracker<T> smd_ref_tracker;
     SMDTracker<T> smd_scrub_tracker;
     std::vector<std::unique_ptr<MaintenancePolicy<T>>> smd_refreshers;
     std::vector<std::unique_ptr<MaintenancePolicy<T>>> smd_scrubbers;
     std::vector<std::unique_ptr<SMDRowHammerProtection<T>>> smd_rh_protectors;
-    std::vector<uint32_t> alerted_ranks;
 
     /* Constructor */
     Controller(const Config& configs, DRAM<T>* channel) :
@@ -289,6 +322,7 @@ public:
         refresh(new Refresh<T>(this)),
         raidr(RAIDR<T>(configs, this)),
         graphene(Graphene<T>(configs, this)),
+        blockhammer(configs, this),
         scrubber(new MemoryScrubber<T>(configs, this)),
         cmd_trace_files(channel->children.size()),
         smd_ref_tracker(SMDTracker<T>(configs, *this)),
@@ -314,6 +348,13 @@ public:
 
         is_DDR4 = channel->spec->standard_name == "DDR4";
         is_LPDDR4 = channel->spec->standard_name == "LPDDR4";
+        is_DDR5 = channel->spec->standard_name == "DDR5";
+        is_HBM = channel->spec->standard_name == "HBM";
+
+        rfm_raaimt = configs.get_uint("rfm_raaimt");
+        assert((rfm_raaimt == 0 || is_DDR5) && "ERROR: RFM is supported only by DDR5.");
+        rfm_raa_counters.assign(channel->spec->org_entry.count[int(T::Level::Rank)], std::vector<uint32_t>(banks_per_rank, 0));
+        rfm_pending.assign(channel->spec->org_entry.count[int(T::Level::Rank)], std::vector<bool>(banks_per_rank, false));
 
         // Initialize memory controller level PARA
         enable_para = configs.get_bool("enable_para");
@@ -333,6 +374,9 @@ public:
 
         smd_max_row_open_intervals = configs.get_uint("smd_max_row_open_intervals");
 
+        smd_ctx.access_predictor.init(configs, channel->id, channel->spec->org_entry.count[int(T::Level::Rank)], banks_per_rank, num_SAs);
+        smd_ctx.reg_stats(channel->id);
+
         std::string smd_ref_policy = configs.get_str("smd_ref_policy");
         if (smd_ref_policy == "FixedRate"){
             for (uint32_t rank_id = 0; rank_id < (uint32_t)channel->spec->org_entry.count[int(T::Level::Rank)]; rank_id++) {
@@ -346,6 +390,12 @@ public:
                     smd_refreshers.emplace_back(new SMDVariableRefresh<T>(configs, this, rank_id, chip_id, banks_per_rank, num_SAs, num_rows));
                 }
             }
+        } else if (smd_ref_policy == "AccessAware"){
+            for (uint32_t rank_id = 0; rank_id < (uint32_t)channel->spec->org_entry.count[int(T::Level::Rank)]; rank_id++) {
+                for (uint32_t chip_id = 0; chip_id < chips_per_rank; chip_id++) {
+                    smd_refreshers.emplace_back(new SMDAccessAwareRefresh<T>(configs, this, rank_id, chip_id, banks_per_rank, num_SAs, num_rows));
+                }
+            }
         } else if (smd_ref_policy == "NoRefresh"){
             for (uint32_t rank_id = 0; rank_id < (uint32_t)channel->spec->org_entry.count[int(T::Level::Rank)]; rank_id++) {
                 for (uint32_t chip_id = 0; chip_id < chips_per_rank; chip_id++) {
@@ -370,6 +420,9 @@ public:
                 smd_rh_protectors.emplace_back(new SMDRowHammerProtection<T>(configs, this, rank_id, chip_id, banks_per_rank, num_SAs, num_rows));
             }
         }
+        smd_prac_enabled = smd_rh_protection_enabled && smd_rh_protectors.front()->is_prac();
+        smd_rh_rowpress = configs.get_bool("smd_rh_rowpress");
+        smd_prac_backoff_until.resize(channel->spec->org_entry.count[int(T::Level::Rank)], 0);
 
         smd_partial_nack_combined_threshold = configs.get_int("smd_combined_policy_threshold");
         smd_partial_nack_resend_interval = ceil(configs.get_float("smd_act_nack_resend_interval")/channel->spec->speed_entry.tCK);;
@@ -556,6 +609,21 @@ public:
             .desc("The number of REF commands issued to the channel.")
             .precision(0)
             ;
+        num_rfm
+            .name("num_rfm_"+to_string(channel->id))
+            .desc("The number of RFM commands issued to the channel.")
+            .precision(0)
+            ;
+        num_ref_postponed
+            .name("num_ref_postponed_"+to_string(channel->id))
+            .desc("The number of per-bank REFs postponed by DARP because the rank was serving reads.")
+            .precision(0)
+            ;
+        num_ref_out_of_order
+            .name("num_ref_out_of_order_"+to_string(channel->id))
+            .desc("The number of per-bank REFs DARP issued to idle banks outside of their tREFI slot.")
+            .precision(0)
+            ;
         num_speculative_precharges
             .name("num_speculative_precharges"+to_string(channel->id) + "_core")
             .desc("Total number of precharge commands issued for speculatively closing a row.")
@@ -728,6 +796,110 @@ public:
             .precision(0)
             ;
 
+        smd_alerts_received
+            .init(channel->spec->org_entry.count[int(T::Level::Rank)])
+            .name("smd_alerts_received_"+to_string(channel->id) + "_core")
+            .desc("Number of cycles in which at least one chip in the rank asserted alert (ALERT mode only).")
+            .precision(0)
+            ;
+
+        // +1 since the number of active machines ranges from 1 to smd_max_maint_machines, which is capped at the number of banks
+        uint32_t max_maint_machines = std::min(configs.get_uint("smd_max_maint_machines"), banks_per_rank);
+        smd_ref_machines_active_cycles
+            .init(max_maint_machines + 1)
+            .name("smd_ref_machines_active_cycles_"+to_string(channel->id) + "_core")
+            .desc("Number of chip-cycles with N active refresh MaintenanceMachines (smd_adaptive_maint_machines only).")
+            .precision(0)
+            ;
+
+        smd_scrub_machines_active_cycles
+            .init(max_maint_machines + 1)
+            .name("smd_scrub_machines_active_cycles_"+to_string(channel->id) + "_core")
+            .desc("Number of chip-cycles with N active scrubbing MaintenanceMachines (smd_adaptive_maint_machines only).")
+            .precision(0)
+            ;
+
+        smd_max_active_ref_machines
+            .name("smd_max_active_ref_machines_"+to_string(channel->id) + "_core")
+            .desc("The maximum number of refresh MaintenanceMachines active at the same time in a chip (smd_adaptive_maint_machines only).")
+            .precision(0)
+            ;
+
+        smd_max_active_scrub_machines
+            .name("smd_max_active_scrub_machines_"+to_string(channel->id) + "_core")
+            .desc("The maximum number of scrubbing MaintenanceMachines active at the same time in a chip (smd_adaptive_maint_machines only).")
+            .precision(0)
+            ;
+
+        smd_prac_abo_alerts
+            .init(channel->spec->org_entry.count[int(T::Level::Rank)])
+            .name("smd_prac_abo_alerts_"+to_string(channel->id) + "_core")
+            .desc("Number of PRAC Back-Off alerts received from the rank.")
+            .precision(0)
+            ;
+
+        smd_prac_backoff_cycles
+            .init(channel->spec->org_entry.count[int(T::Level::Rank)])
+            .name("smd_prac_backoff_cycles_"+to_string(channel->id) + "_core")
+            .desc("Number of cycles the memory controller blocked ACTs to the rank to provide PRAC RFM windows.")
+            .precision(0)
+            ;
+
+        blockhammer_throttled_acts
+            .init(configs.get_int("cores"))
+            .name("blockhammer_throttled_acts_"+to_string(channel->id) + "_core")
+            .desc("Number of ACTs BlockHammer delayed because they targeted a blacklisted row, per core.")
+            .precision(0)
+            ;
+
+        rowpress_preventive_refreshes
+            .name("rowpress_preventive_refreshes_"+to_string(channel->id))
+            .desc("Number of Graphene preventive refreshes triggered by the open time of rows beyond tRAS (RowPress).")
+            .precision(0)
+            ;
+
+        smd_acts_overlapping_maint
+            .name("smd_acts_overlapping_maint_"+to_string(channel->id))
+            .desc("Number of ACTs issued to a bank while another SA of the bank was under maintenance.")
+            .precision(0)
+            ;
+
+        smd_coalesced_refs
+            .name("smd_coalesced_refs_"+to_string(channel->id))
+            .desc("Number of SMD refresh operations performed within the lock window of another maintenance operation.")
+            .precision(0)
+            ;
+
+        smd_coalesced_scrubs
+            .name("smd_coalesced_scrubs_"+to_string(channel->id))
+            .desc("Number of SMD scrubbing operations performed within the lock window of another maintenance operation.")
+            .precision(0)
+            ;
+
+        smd_coalesced_neighbor_refs
+            .name("smd_coalesced_neighbor_refs_"+to_string(channel->id))
+            .desc("Number of SMD neighbor row refresh operations performed within the lock window of another maintenance operation.")
+            .precision(0)
+            ;
+
+        smd_coalesced_ref_lock_cycles_saved
+            .name("smd_coalesced_ref_lock_cycles_saved_"+to_string(channel->id))
+            .desc("Number of SA lock cycles saved by coalesced refresh operations whose rows another maintenance operation already restores.")
+            .precision(0)
+            ;
+
+        smd_coalesced_scrub_lock_cycles_saved
+            .name("smd_coalesced_scrub_lock_cycles_saved_"+to_string(channel->id))
+            .desc("Number of SA lock cycles saved by coalesced scrubbing operations.")
+            .precision(0)
+            ;
+
+        smd_coalesced_neighbor_ref_lock_cycles_saved
+            .name("smd_coalesced_neighbor_ref_lock_cycles_saved_"+to_string(channel->id))
+            .desc("Number of SA lock cycles saved by coalesced neighbor row refresh operations whose rows another maintenance operation already restores.")
+            .precision(0)
+            ;
+
         smd_ready_but_timed_out_req
             .name("smd_ready_but_timed_out_req_"+to_string(channel->id) + "_core")
             .desc("Number of cycles no request was ready but a req might have been ready if the corresponding ref status wasn't timed out.")
@@ -1095,22 +1267,55 @@ public:
                         
                         break;
                     }
+                    case Request::Type::PREFETCH: {
+                        // prefetches do not count towards the read latency
+                        if (req.depart - req.arrive > 1)
+                            channel->update_serving_requests(
+                                req.addr_vec.data(), -1, clk);
+                        if (req.callback != nullptr)
+                            req.callback(req);
+                        break;
+                    }
                     case Request::Type::REF_STATUS_QUERY: {
                         assert(smd_mode == SMD_MODE::RSQ || smd_mode == SMD_MODE::ALERT);
                         smd_ref_status_responses++;
 
-                        for(uint32_t chip_id = 0; chip_id < chips_per_rank; chip_id++) {
-                            smd_ref_tracker.update(chip_id, req.addr_vec[2], get_smd_refresher(req.addr_vec[1], chip_id)->communicate_locked_SAs(req.addr_vec[2]));
+                        uint32_t rank_id = req.addr_vec[1];
+
+                        if(smd_mode == SMD_MODE::ALERT) {
+                            // the query reads the locked SAs of all banks in the rank
+                            uint32_t banks_per_rank = channel->spec->get_num_banks_per_rank();
+                            for(uint32_t chip_id = 0; chip_id < chips_per_rank; chip_id++) {
+                                uint32_t maint_window = smd_max_maint_window(rank_id, chip_id);
+                                for(uint32_t bank_gid = 0; bank_gid < banks_per_rank; bank_gid++) {
+                                    smd_ref_tracker.update(rank_id, chip_id, bank_gid, get_smd_refresher(rank_id, chip_id)->communicate_locked_SAs(bank_gid), maint_window);
+                                    if(smd_ecc_scrubbing_enabled)
+                                        smd_scrub_tracker.update(rank_id, chip_id, bank_gid, get_smd_scrubber(rank_id, chip_id)->communicate_locked_SAs(bank_gid), maint_window);
+                                }
+                            }
+
+                            smd_ref_tracker.resolve_alert(rank_id, req.arrive);
                             if(smd_ecc_scrubbing_enabled)
-                                smd_scrub_tracker.update(chip_id, req.addr_vec[2], get_smd_scrubber(req.addr_vec[1], chip_id)->communicate_locked_SAs(req.addr_vec[2]));
+                                smd_scrub_tracker.resolve_alert(rank_id, req.arrive);
+
+                            smd_alerts.remove(rank_id);
+
+                            // a chip may have asserted alert after the query was issued. Query the rank again
+                            if(smd_ref_tracker.is_alert_outstanding(rank_id) || (smd_ecc_scrubbing_enabled && smd_scrub_tracker.is_alert_outstanding(rank_id)))
+                                smd_alerts.push_back(rank_id);
+
+                            break;
                         }
 
-                        if(smd_mode == SMD_MODE::ALERT)
-                            smd_alerts.remove(req.addr_vec[1]);
+                        for(uint32_t chip_id = 0; chip_id < chips_per_rank; chip_id++) {
+                            smd_ref_tracker.update(rank_id, chip_id, req.addr_vec[2], get_smd_refresher(rank_id, chip_id)->communicate_locked_SAs(req.addr_vec[2]));
+                            if(smd_ecc_scrubbing_enabled)
+                                smd_scrub_tracker.update(rank_id, chip_id, req.addr_vec[2], get_smd_scrubber(rank_id, chip_id)->communicate_locked_SAs(req.addr_vec[2]));
+                        }
 
-                        smd_ref_tracker.unmark_inflight_req(req.addr_vec[2]);
+                        smd_ref_tracker.unmark_inflight_req(rank_id, req.addr_vec[2]);
                         if(smd_ecc_scrubbing_enabled)
-                            smd_scrub_tracker.unmark_inflight_req(req.addr_vec[2]);
+                            smd_scrub_tracker.unmark_inflight_req(rank_id, req.addr_vec[2]);
                         break;
                     }
 
@@ -1177,8 +1382,37 @@ public:
         if (enable_graphene)
             graphene.tick();
 
+        if (enable_blockhammer)
+            blockhammer.tick();
+
         /*** 2.5 SMD Refresh ***/
         if (smd_enabled) {
+
+            if (smd_ctx.access_predictor.is_enabled())
+                smd_record_queued_SAs();
+
+            for (auto& smd_ref : smd_refreshers) {
+                smd_ref->tick();
+                if (smd_ref->is_adaptive())
+                    smd_record_active_machines(smd_ref, smd_ref_machines_active_cycles, smd_max_active_ref_machines);
+            }
+
+            if(smd_ecc_scrubbing_enabled){
+                for (auto& smd_scrub : smd_scrubbers) {
+                    smd_scrub->tick();
+                    if (smd_scrub->is_adaptive())
+                        smd_record_active_machines(smd_scrub, smd_scrub_machines_active_cycles, smd_max_active_scrub_machines);
+                }
+            }
+
+            if(smd_rh_protection_enabled) {
+                for (auto& rh_protector : smd_rh_protectors) {
+                    rh_protector->tick();
+                }
+            }
+
+            if(smd_prac_enabled)
+                smd_process_abo_alerts();
             
             /* 
             A chip has asserted alert, updated the MR, and started refreshing the target SA that was found to be precharged.
@@ -1188,61 +1422,46 @@ public:
                     in simulation, the SMDTracker will get the latest (i.e., updated MR) locked SA when the query response arrives
                     the memory controller need to update the alert_clk based on the last clk alert is signalled
                     last_alert_clk is shared among all chips in a rank (i.e., using per rank last_alert_clk)
+            The alerts are collected after ticking the maintenance policies so that no ACT is scheduled to an SA locked in the same cycle.
             */
 
             if(smd_mode == SMD_MODE::ALERT) {
                 uint32_t num_ranks = (uint32_t) channel->spec->org_entry.count[int(T::Level::Rank)];
                 for(uint32_t rank_id = 0; rank_id < num_ranks; rank_id++) {
-                    bool is_ref_alert_set = false;
-                    bool is_scrub_alert_set = false;
+                    bool is_alert_set = false;
                     for(uint32_t chip_id = 0; chip_id < chips_per_rank; chip_id++) {
-                        is_ref_alert_set |= get_smd_refresher(rank_id, chip_id)->get_and_clear_ref_alert();
+                        is_alert_set |= get_smd_refresher(rank_id, chip_id)->get_and_clear_ref_alert();
                         if(smd_ecc_scrubbing_enabled)
-                            is_scrub_alert_set |= get_smd_scrubber(rank_id, chip_id)->get_and_clear_ref_alert();
+                            is_alert_set |= get_smd_scrubber(rank_id, chip_id)->get_and_clear_ref_alert();
+                        if(smd_rh_protection_enabled)
+                            is_alert_set |= get_smd_rh_protector(rank_id, chip_id)->get_and_clear_ref_alert();
                     }
 
-                    if (is_ref_alert_set) {
+                    // all maintenance mechanisms of a chip share the same SA locks. So, an alert updates both trackers
+                    if (is_alert_set) {
                         smd_alerts.push_back(rank_id);
                         smd_ref_tracker.update_alert_clk(rank_id);
-                    }
-
-                    if (is_scrub_alert_set) {
-                        smd_alerts.push_back(rank_id);
                         if(smd_ecc_scrubbing_enabled)
                             smd_scrub_tracker.update_alert_clk(rank_id);
+                        smd_alerts_received[rank_id]++;
                     }
 
-                    // TODO_hasan: For especially SMD_MODE::ALERT, we need to modify the address mapping scheme such that sequential addresses target different subarrays in different banks.
-                    // For example, after covering a row from SA0 in bank0, the consecutive accesses should target SAX in bankY, where X and Y are not 0.
+                    // NOTE: ALERT blocks all ACTs to a rank until the query response arrives. Use the RoSaBaRaCoCh_SaInterleaved address mapping 
+                    // so that sequential addresses target different subarrays in different banks and are less likely to hit the locked SAs.
                 }
-            }
 
-            if (smd_alerts.count() > 0) {
-                // got a REF alert. Immediately issue a command to query the ref status
-                typename T::Command _cmd = T::Command::RSQ;
-                if(smd_query_ref_status((uint32_t)smd_alerts.front(), _cmd) == 0){
-                    // RSQ is issued successfully
-                    smd_alerts.process_front();
-                }
-                // if issuing RSQ fails, the controller will try again until all ranks in alerted_ranks are cleared
-                
-                return;
-            }
-
-            
-            for (auto& smd_ref : smd_refreshers) {
-                smd_ref->tick();
-            }
-
-            if(smd_ecc_scrubbing_enabled){
-                for (auto& smd_scrub : smd_scrubbers) {
-                    smd_scrub->tick();
-                }
-            }
-
-            if(smd_rh_protection_enabled) {
-                for (auto& rh_protector : smd_rh_protectors) {
-                    rh_protector->tick();
+                if (smd_alerts.count() > 0) {
+                    // got a REF alert. Immediately issue a command to query the ref status
+                    typename T::Command _cmd = T::Command::RSQ;
+                    uint32_t alerted_rank = (uint32_t)smd_alerts.front();
+                    if(smd_query_ref_status(alerted_rank, _cmd) == 0){
+                        // RSQ is issued successfully
+                        int rsq_addr[2] = {channel->id, (int)alerted_rank};
+                        channel->update(T::Command::RSQ, rsq_addr, clk);
+                        smd_alerts.process_front();
+                        return; // the command bus is occupied by the RSQ in this cycle
+                    }
+                    // if issuing RSQ fails, the controller will try again until all ranks in alerted_ranks are cleared
                 }
             }
         }
@@ -1365,7 +1584,7 @@ public:
                                 // assuming it will be delayed by at least nack_resend interval because of timings
                                 actq_req->arrive += smd_partial_nack_resend_interval; //TODO: is this OK? Check if this is good enough
                                 std::vector<int> addr_vec = get_addr_vec(my_cmd,actq_req);
-                                issue_cmd(my_cmd, addr_vec, actq_req, false, false);
+                                issue_cmd(my_cmd, addr_vec, actq_req, &actq, false, false);
                                 new_queue->q.push_back(*actq_req);
                                 request_to_erase = actq_req;
                                 //printf("Successfully perform a precharge!\n");
@@ -1549,7 +1768,7 @@ public:
                 #ifdef PRINT_CMD_TRACE
                 std::cout << "[TimeoutPolicy] Precharge by the timeout policy!" << std::endl;
                 #endif
-                issue_cmd(cmd, victim, readq.q.end());
+                issue_cmd(cmd, victim, readq.q.end(), nullptr);
                 num_speculative_precharges++;
             }
             else if (smd_enabled && smd_mode == SMD_MODE::RSQ){
@@ -1643,7 +1862,7 @@ public:
 
                             //crow_table->invalidate(target_addr_vec, discard_ind);
 
-                            issue_cmd(cmd, target_addr_vec, req, true); 
+                            issue_cmd(cmd, target_addr_vec, req, queue, true); 
                             crow_full_restore++;
                             return;
                         } else {
@@ -1675,7 +1894,7 @@ public:
                 // convert the command to precharge
                 cmd = T::Command::PRE;
                 if(is_ready(T::Command::PRE, target_addr_vec)){
-                    issue_cmd(cmd, target_addr_vec, req, true);
+                    issue_cmd(cmd, target_addr_vec, req, queue, true);
                     tl_dram_precharge_cached_row_due_to_write++;
                 } else {
                     tl_dram_precharge_failed_due_to_timing++;
@@ -1694,10 +1913,10 @@ public:
             // If so, convert the column command to RDA/WRA to precharge the row following the column command
             // this is to prevent the rows in the subarray from being refreshed by SMD for a long time
 
-            // printf("active_time: %d, max_active_time: %d\n", rowtable->get_row_open_interval(req->addr_vec), ref_tracker_timeout_period*smd_max_row_open_intervals); // DEBUG
+            // printf("active_time: %d, max_active_time: %d\n", rowtable->get_row_open_interval(req->addr_vec), smd_ctx.ref_tracker_timeout_period*smd_max_row_open_intervals); // DEBUG
 
             assert(!channel->spec->is_closing(cmd));
-            if(rowtable->get_row_open_interval(req->addr_vec) > ref_tracker_timeout_period*smd_max_row_open_intervals) {
+            if(rowtable->get_row_open_interval(req->addr_vec) > smd_ctx.ref_tracker_timeout_period*smd_max_row_open_intervals) {
                 cmd = channel->spec->add_autoprecharge(cmd);
                 // Note: RD/WR and RDA/WRA have the same timings to is_ready() should be still true after adding an autoprecharge
 
@@ -1711,7 +1930,7 @@ public:
         #ifdef PRINT_CMD_TRACE
             printf("req_uid:%lld\t", req->req_unique_id);
         #endif
-        issue_cmd(cmd, addr_vec, req, false, make_crow_copy);
+        issue_cmd(cmd, addr_vec, req, queue, false, make_crow_copy);
 
 
         if(channel->spec->is_opening(cmd)) {
@@ -1813,7 +2032,13 @@ public:
 
         bool check_status = channel->check(cmd, addr_vec.data(), clk);
 
-        if (check_status && smd_enabled && smd_mode == SMD_MODE::RSQ && cmd == T::Command::ACT)
+        if (check_status && enable_blockhammer && cmd == T::Command::ACT && blockhammer.is_throttled(addr_vec, clk))
+            return false;
+
+        if (check_status && smd_prac_enabled && cmd == T::Command::ACT && smd_is_backing_off(addr_vec[int(T::Level::Rank)]))
+            return false;
+
+        if (check_status && smd_enabled && (smd_mode == SMD_MODE::RSQ || smd_mode == SMD_MODE::ALERT) && cmd == T::Command::ACT)
             return (smd_ref_tracker.can_open(addr_vec) == 1) && (!smd_ecc_scrubbing_enabled || smd_scrub_tracker.can_open(addr_vec) == 1);
 
         return check_status;
@@ -1827,6 +2052,12 @@ public:
 
         bool timing_check = channel->check(cmd, req.addr_vec.data(), clk);
 
+        if (timing_check && enable_blockhammer && cmd == T::Command::ACT && blockhammer.is_throttled(req.addr_vec, clk))
+            return false;
+
+        if (timing_check && smd_prac_enabled && cmd == T::Command::ACT && smd_is_backing_off(req.addr_vec[int(T::Level::Rank)]))
+            return false;
+
         if (timing_check && cmd == T::Command::ACT)
             return (smd_ref_tracker.can_open(req.addr_vec) == 1) && (!smd_ecc_scrubbing_enabled || smd_scrub_tracker.can_open(req.addr_vec) == 1);
 
@@ -1912,13 +2143,22 @@ public:
         channel->spec->act_nack_interval_ns = configs.get_float("smd_act_nack_resend_interval");
 
         per_bank_refresh_on = configs.get_bool("per_bank_refresh");
+        darp_refresh_on = configs.get_bool("darp_refresh");
+        assert((!darp_refresh_on || (per_bank_refresh_on && !is_DDR5 && channel->spec->standard_name != "DSARP"))
+                && "ERROR: darp_refresh requires per_bank_refresh and is not supported by DDR5 and DSARP (use its DARP type instead).");
         
         channel->spec->init_speed(); // init_speed() sets nREFI to its original value. So the order between
         channel->spec->speed_entry.nREFI *= refresh_mult; // these two lines must be preserved
         channel->spec->mult_refresh_pb(refresh_mult); // Atb: to multiply DSARP's tREFIpb tREFCpb
 
         channel->spec->init_prereq();
-        if(per_bank_refresh_on){
+        if(per_bank_refresh_on && is_DDR5){
+            // DDR5 has no per-bank REF. Instead, a REFsb (same-bank REF) refreshes one bank in every bank group
+            // and the refresh interval is divided across the banks of a bank group
+            channel->spec->speed_entry.nREFI = ceil(channel->spec->speed_entry.nREFI/(float)channel->spec->org_entry.count[int(T::Level::Bank)]);
+
+            otherq.q.clear(); // discarding pending rank-level REFs as in per-bank refresh below
+        } else if(per_bank_refresh_on){
             // making REF work as REFpb (per-bank REF)
             channel->spec->speed_entry.nREFI = ceil(channel->spec->speed_entry.nREFI/(float)channel->spec->get_num_banks_per_rank());
             channel->spec->speed_entry.nRFC = ceil(channel->spec->speed_entry.nRFC/2.0f);
@@ -1984,6 +2224,7 @@ public:
         enable_para = configs.get_bool("enable_para");
         enable_raidr = configs.get_bool("enable_raidr");
         enable_graphene = configs.get_bool("enable_graphene");
+        enable_blockhammer = configs.get_bool("enable_blockhammer");
 
         enable_scrubbing = configs.get_bool("enable_scrubbing");
         scrubber->reload_options(configs);
@@ -2053,6 +2294,9 @@ public:
             // TODO: implement ACT_NACK and NACK'ed ACT commands
 
             default: {
+                // DDR5 RFM (all-bank) consumes as much energy as an all-bank REF
+                if (is_DDR5 && channel->spec->is_refreshing(cmd))
+                    dpower_cmd = DRAMPower::MemCommand::REF;
 
                 // assert(false && "ERROR: Unimplemented DRAMPower command!");
             }
@@ -2061,6 +2305,20 @@ public:
         dpower[rank_id].doCommand(dpower_cmd, gbid, clk);
     }
 
+    // DDR5 same-bank commands (PREsb, REFsb, RFMsb) are sent to DRAMPower once per bank group
+    void issueDPowerSameBankCommand(const typename T::Command cmd, vector<int> addr_vec) {
+        DRAMPower::MemCommand::cmds dpower_cmd = channel->spec->is_refreshing(cmd) ? DRAMPower::MemCommand::REFB : DRAMPower::MemCommand::PRE;
+
+        for (int bg = 0; bg < channel->spec->org_entry.count[int(T::Level::Bank) - 1]; bg++) {
+            addr_vec[int(T::Level::Bank) - 1] = bg;
+            dpower[addr_vec[int(T::Level::Rank)]].doCommand(dpower_cmd, channel->spec->calc_global_bank_id(addr_vec), clk);
+        }
+    }
+
+    bool is_same_bank_cmd(const typename T::Command cmd, const vector<int>& addr_vec) const {
+        return addr_vec[int(T::Level::Bank) - 1] < 0 && channel->spec->scope[int(cmd)] == T::Level::Bank;
+    }
+
     void issueDPowerSMDREF(const uint32_t num_rows_refreshed, const uint32_t rank_id, const uint32_t gbid) {
         dpower[rank_id].doSMDRefCommand(num_rows_refreshed, gbid, clk);
     }
@@ -2069,6 +2327,39 @@ public:
         dpower[rank_id].doRowScrubCommand(num_rows_scrubbed, gbid, clk);
     }
 
+    // called when a maintenance mechanism of a chip locks the SA of lock_rows for lock_window cycles. The other mechanisms of the 
+    // chip perform their pending operations on the same SA within the same window. Returns the number of cycles to extend the window by
+    uint32_t smd_coalesce_maint(const uint32_t rank_id, const uint32_t chip_id, const MaintenancePolicy<T>* initiator, const MaintRows& lock_rows, const uint32_t lock_window) {
+        // in ALERT mode, the memory controller assumes that a lock lasts no longer than the longest maintenance window of the chip
+        uint32_t max_window = (smd_mode == SMD_MODE::ALERT) ? smd_max_maint_window(rank_id, chip_id) : std::numeric_limits<uint32_t>::max();
+        uint32_t total_extension = 0;
+
+        auto absorb = [&](MaintenancePolicy<T>* policy, ScalarStat& coalesced_ops, ScalarStat& lock_cycles_saved) {
+            if (policy == initiator)
+                return;
+
+            uint32_t cur_window = lock_window + total_extension;
+            uint32_t max_extension = (max_window > cur_window) ? max_window - cur_window : 0;
+            uint32_t extension = 0, saved_cycles = 0;
+            if (!policy->absorb_pending_maint(lock_rows, max_extension, extension, saved_cycles))
+                return;
+
+            total_extension += extension;
+            coalesced_ops++;
+            lock_cycles_saved += saved_cycles;
+        };
+
+        absorb(get_smd_refresher(rank_id, chip_id).get(), smd_coalesced_refs, smd_coalesced_ref_lock_cycles_saved);
+
+        if(smd_ecc_scrubbing_enabled)
+            absorb(get_smd_scrubber(rank_id, chip_id).get(), smd_coalesced_scrubs, smd_coalesced_scrub_lock_cycles_saved);
+
+        if(smd_rh_protection_enabled)
+            absorb(get_smd_rh_protector(rank_id, chip_id).get(), smd_coalesced_neighbor_refs, smd_coalesced_neighbor_ref_lock_cycles_saved);
+
+        return total_extension;
+    }
+
 
 private:
     typename T::Command get_first_cmd(const Request& req) const {
@@ -2084,7 +2375,8 @@ private:
 
     unsigned long last_clk = 0; // DEBUG
     unsigned long num_cas_cmds = 0;
-    void issue_cmd(typename T::Command cmd, vector<int>& addr_vec, list<Request>::iterator req, bool do_full_restore = false, bool make_crow_copy = true)
+    // req_queue is the queue req belongs to, or nullptr if the command does not serve a request
+    void issue_cmd(typename T::Command cmd, vector<int>& addr_vec, list<Request>::iterator req, const Queue* req_queue, bool do_full_restore = false, bool make_crow_copy = true)
     {
         //assert(!is_full_restore && "Full restoration feature is not needed anymore. The corresponding code pieces in Controller.h are commented out.");
 
@@ -2345,11 +2637,11 @@ private:
             }
 
             
-            if(!enable_crow_upperbound && channel->spec->is_refreshing(cmd)) {
+            if(!enable_crow_upperbound && channel->spec->is_refreshing(cmd) && !is_rfm(cmd)) {
                                 
                 int nREFI = channel->spec->speed_entry.nREFI;
                 float tCK = channel->spec->speed_entry.tCK;
-                int base_refw = is_LPDDR4 ? 32*refresh_mult : 64*refresh_mult;
+                int base_refw = (is_LPDDR4 || is_DDR5 || is_HBM) ? 32*refresh_mult : 64*refresh_mult;
                 ulong ticks_in_ref_int = base_refw*1000000/tCK;
                 int num_refs = ticks_in_ref_int/nREFI;
 
@@ -2357,7 +2649,7 @@ private:
                 int num_rows_refreshed_at_once;
                 int num_ref_limit;
                
-               if(is_DDR4 || is_LPDDR4) {
+               if(is_DDR4 || is_DDR5 || is_LPDDR4 || is_HBM) {
                   num_ref_limit = channel->spec->org_entry.count[int(T::Level::Row)];
                   num_rows_refreshed_at_once = ceil(channel->spec->org_entry
                                                     .count[int(T::Level::Row)]/(float)num_refs);
@@ -2447,6 +2739,24 @@ private:
             }
         }
 
+        // an activation restores the row in every chip that performs it
+        // a NACKed ACT is retried soon, so it also indicates an upcoming access
+        if (smd_enabled && cmd == T::Command::ACT && smd_ctx.access_predictor.is_enabled())
+            smd_ctx.access_predictor.record_activation(addr_vec[int(T::Level::Rank)], channel->spec->calc_global_bank_id(addr_vec), addr_vec[int(T::Level::Subarray)], clk);
+
+        if (smd_enabled && cmd == T::Command::ACT && smd_region_busy_resp == RegionBusyResponse::NO_CHIPS_BUSY) {
+            uint32_t bank_gid = channel->spec->calc_global_bank_id(addr_vec);
+            bool bank_under_maint = false;
+            for(uint32_t chip_id = 0; chip_id < chips_per_rank; chip_id++) {
+                get_smd_refresher(addr_vec[uint32_t(T::Level::Rank)], chip_id)->process_row_activation(addr_vec);
+                bank_under_maint |= get_smd_refresher(addr_vec[uint32_t(T::Level::Rank)], chip_id)->contains_locked_SA(bank_gid);
+            }
+
+            // the bank serves the access while maintaining another SA
+            if (bank_under_maint)
+                smd_acts_overlapping_maint++;
+        }
+
         if(cmd == T::Command::PRE){
             // replace subarray address in the addr_vec with the currently open subarray
             addr_vec.resize(int(T::Level::MAX) - 1);
@@ -2500,6 +2810,13 @@ private:
                 break;
             }
             default: {
+                // DDR5 REFsb and RFM commands
+                if (is_DDR5 && channel->spec->is_refreshing(cmd)) {
+                    if (is_rfm(cmd))
+                        num_rfm++;
+                    else
+                        num_ref++;
+                }
                 // std::cerr << "ERROR: No counter stat for command type: " << int(cmd) << std::endl;
                 // assert(false);
             }
@@ -2510,12 +2827,22 @@ private:
         // do not send ACT commands that will be NACK'ed to DRAMPower 
         if((cmd != T::Command::ACT) || (smd_region_busy_resp == RegionBusyResponse::NO_CHIPS_BUSY)) {
 
-            if(req != readq.q.end())
+            if(req_queue != nullptr)
                 req->partially_nacked = false;
-            issueDPowerCommand(cmd, addr_vec[uint32_t(T::Level::Rank)], channel->spec->calc_global_bank_id(addr_vec));
+            if (is_same_bank_cmd(cmd, addr_vec))
+                issueDPowerSameBankCommand(cmd, addr_vec);
+            else
+                issueDPowerCommand(cmd, addr_vec[uint32_t(T::Level::Rank)], channel->spec->calc_global_bank_id(addr_vec));
         }
         // END - DRAMPower
 
+        // DDR5 RFM
+        if (rfm_raaimt && channel->spec->is_refreshing(cmd))
+            rfm_process_refresh(cmd, addr_vec);
+
+        if (rfm_raaimt && (cmd == T::Command::ACT) && (smd_region_busy_resp == RegionBusyResponse::NO_CHIPS_BUSY))
+            rfm_process_activation(addr_vec);
+
         // Issue Neighbor row refreshes if memory controller level PARA is enabled
         if(enable_para && (cmd == T::Command::ACT)){
             if(flip_PARA_coin()) {
@@ -2539,6 +2866,7 @@ private:
             // clean just_opened state
             if(is_LPDDR4) {
                 channel->children[addr_vec[int(T::Level::Rank)]]->
+                    children[addr_vec[int(T::Level::BankGroup)]]->
                     children[addr_vec[int(T::Level::Bank)]]->just_opened = false;
             }
             else {
@@ -2562,6 +2890,26 @@ private:
         if (enable_graphene && (cmd == T::Command::ACT))
             graphene.update(cmd, addr_vec, 36/*random*/);
 
+        // RowPress: account for how long the rows closed by this command stayed open
+        bool smd_rowpress = smd_enabled && smd_mode == SMD_MODE::ACT_NACK && smd_rh_protection_enabled && smd_rh_rowpress;
+        if (((enable_graphene && graphene.is_rowpress_enabled()) || smd_rowpress) && channel->spec->is_closing(cmd)) {
+            for (auto& closing_row : rowtable->get_closing_rows(cmd, addr_vec, clk)) {
+                if (enable_graphene && graphene.update(cmd, closing_row.first, closing_row.second))
+                    rowpress_preventive_refreshes++;
+
+                if (smd_rowpress) {
+                    for(uint32_t chip_id = 0; chip_id < chips_per_rank; chip_id++)
+                        get_smd_rh_protector(closing_row.first[uint32_t(T::Level::Rank)], chip_id)->process_row_closure(closing_row.first, closing_row.second);
+                }
+            }
+        }
+
+        if (enable_blockhammer && (cmd == T::Command::ACT)) {
+            // attribute the ACTs BlockHammer delayed to the cores that issued them
+            if (blockhammer.update(cmd, addr_vec, clk) && (req_queue != nullptr) && (req->coreid >= 0))
+                blockhammer_throttled_acts[req->coreid]++;
+        }
+
         // SMD -- END
 
         rowtable->update(cmd, addr_vec, clk);
@@ -2577,7 +2925,7 @@ private:
                 else
                     file << clk << ',' << cmd_name;
                 // TODO bad coding here
-                if (cmd_name == "PREA" || cmd_name == "REF")
+                if (cmd_name == "PREA" || cmd_name == "REF" || cmd_name == "RFM")
                     file<<endl;
                 else{
                     int bank_id = 0;
@@ -2585,7 +2933,9 @@ private:
                         bank_id = addr_vec[int(T::Level::Bank)]*channel->spec->org_entry.count[int(T::Level::Bank) + 1] + addr_vec[int(T::Level::Bank) + 1];
                     else
                         bank_id = addr_vec[int(T::Level::Bank)];
-                    if (channel->spec->standard_name == "DDR4" || channel->spec->standard_name == "GDDR5")
+                    // same-bank commands of DDR5 do not specify a bank group
+                    if ((channel->spec->standard_name == "DDR4" || channel->spec->standard_name == "DDR5" || channel->spec->standard_name == "HBM" || channel->spec->standard_name == "GDDR5")
+                            && addr_vec[int(T::Level::Bank) - 1] >= 0)
                         bank_id += addr_vec[int(T::Level::Bank) - 1] * channel->spec->org_entry.count[int(T::Level::Bank)];
                     file<<','<<bank_id<<endl;
                 }
@@ -2598,6 +2948,58 @@ private:
             printf("\n");
         }
     }
+    bool is_rfm(typename T::Command cmd) const {
+        return is_DDR5 && (cmd == channel->spec->translate[int(Request::Type::RFM)]);
+    }
+
+    // the banks refreshed by a REF/RFM command. Same-bank commands target one bank in every bank group
+    vector<uint32_t> get_refreshed_banks(const vector<int>& addr_vec) const {
+        vector<uint32_t> banks;
+        int bank = addr_vec[int(T::Level::Bank)];
+        uint32_t banks_per_bg = channel->spec->org_entry.count[int(T::Level::Bank)];
+
+        for (uint32_t b = 0; b < channel->spec->get_num_banks_per_rank(); b++)
+            if (bank < 0 || (b % banks_per_bg) == (uint32_t)bank)
+                banks.push_back(b);
+
+        return banks;
+    }
+
+    void rfm_process_activation(const vector<int>& addr_vec) {
+        int rank_id = addr_vec[int(T::Level::Rank)];
+        uint32_t bank_id = channel->spec->calc_global_bank_id(addr_vec);
+
+        if ((++rfm_raa_counters[rank_id][bank_id] < rfm_raaimt) || rfm_pending[rank_id][bank_id])
+            return;
+
+        // RFMsb (in the same-bank refresh mode) targets the bank in every bank group, RFM targets all banks of the rank
+        vector<int> rfm_addr_vec(int(T::Level::MAX), -1);
+        rfm_addr_vec[int(T::Level::Channel)] = channel->id;
+        rfm_addr_vec[int(T::Level::Rank)] = rank_id;
+        if (per_bank_refresh_on)
+            rfm_addr_vec[int(T::Level::Bank)] = addr_vec[int(T::Level::Bank)];
+
+        Request req(rfm_addr_vec, Request::Type::RFM, nullptr);
+        if (!enqueue(req))
+            return; // retry at the next activation of the bank
+
+        for (uint32_t b : get_refreshed_banks(rfm_addr_vec))
+            rfm_pending[rank_id][b] = true;
+    }
+
+    // both REF and RFM commands decrement the RAA counters of the banks they refresh
+    void rfm_process_refresh(typename T::Command cmd, const vector<int>& addr_vec) {
+        int rank_id = addr_vec[int(T::Level::Rank)];
+
+        for (uint32_t b : get_refreshed_banks(addr_vec)) {
+            uint32_t& raa = rfm_raa_counters[rank_id][b];
+            raa = (raa > rfm_raaimt) ? (raa - rfm_raaimt) : 0;
+
+            if (is_rfm(cmd))
+                rfm_pending[rank_id][b] = false;
+        }
+    }
+
     vector<int> get_addr_vec(typename T::Command cmd, list<Request>::iterator req){
         return req->addr_vec;
     }
@@ -2890,7 +3292,7 @@ private:
         int next_SA_to_ref;
         
         
-        if(is_DDR4 || is_LPDDR4) {
+        if(is_DDR4 || is_DDR5 || is_LPDDR4 || is_HBM) {
            SA_size = channel->spec->org_entry.count[int(T::Level::Row)]/num_SAs;
         }
         else { // for SALP
@@ -2902,21 +3304,21 @@ private:
         float trefi_in_ns = nREFI * tCK;
 
         int SA_id;
-        if(is_DDR4 || is_LPDDR4)
+        if(is_DDR4 || is_DDR5 || is_LPDDR4 || is_HBM)
             SA_id = pre_row/SA_size;
         else // for SALP
             SA_id = addr_vec[int(T::Level::Row) - 1];
         //printf("SA_size: %d SA_id: %d \n", SA_size, SA_id);
 
                
-        int base_refw = is_LPDDR4 ? 32*refresh_mult : 64*refresh_mult; 
+        int base_refw = (is_LPDDR4 || is_DDR5 || is_HBM) ? 32*refresh_mult : 64*refresh_mult; 
         ulong ticks_in_ref_int = (base_refw)*1000000/tCK;
         //printf("tCK: %f, ticks_in_ref_int: %lu \n", tCK, ticks_in_ref_int);
         int num_refs = ticks_in_ref_int/nREFI;
         
         int rows_per_bank;
 
-        if(is_DDR4 || is_LPDDR4)
+        if(is_DDR4 || is_DDR5 || is_LPDDR4 || is_HBM)
             rows_per_bank = channel->spec->org_entry.count[int(T::Level::Row)];
         else // for SALP
             rows_per_bank = channel->spec->org_entry.count[int(T::Level::Row)] * channel->spec->org_entry.count[int(T::Level::Row) - 1];
@@ -3004,6 +3406,61 @@ private:
         return smd_rh_protectors[rank_id*chips_per_rank + chip_id];
     }
 
+    void smd_record_active_machines(const std::unique_ptr<MaintenancePolicy<T>>& policy, VectorStat& active_cycles, ScalarStat& max_active) {
+        uint32_t num_active = policy->get_num_active_machines();
+
+        active_cycles[num_active]++;
+        if (num_active > max_active.value())
+            max_active = num_active;
+    }
+
+    // PRAC: a Back-Off alert from any chip makes the memory controller stop activating the rank for the RFM windows, 
+    // during which every chip of the rank mitigates its aggressor rows
+    void smd_process_abo_alerts() {
+        uint32_t num_ranks = (uint32_t) channel->spec->org_entry.count[int(T::Level::Rank)];
+        for (uint32_t rank_id = 0; rank_id < num_ranks; rank_id++) {
+            bool is_alert_set = false;
+            for (uint32_t chip_id = 0; chip_id < chips_per_rank; chip_id++)
+                is_alert_set |= get_smd_rh_protector(rank_id, chip_id)->get_and_clear_abo_alert();
+
+            if (!is_alert_set)
+                continue;
+
+            uint32_t backoff_period = 0;
+            for (uint32_t chip_id = 0; chip_id < chips_per_rank; chip_id++)
+                backoff_period = std::max(backoff_period, get_smd_rh_protector(rank_id, chip_id)->start_rfm_windows());
+
+            smd_prac_backoff_until[rank_id] = clk + backoff_period;
+            smd_prac_abo_alerts[rank_id]++;
+            smd_prac_backoff_cycles[rank_id] += backoff_period;
+        }
+    }
+
+    bool smd_is_backing_off(const uint32_t rank_id) const {
+        return clk < smd_prac_backoff_until[rank_id];
+    }
+
+    // lets the access predictor know the SAs that the requests in the request buffer target
+    void smd_record_queued_SAs() {
+        for (auto* q : {&actq, &readq, &writeq}) {
+            for (auto& req : q->q)
+                smd_ctx.access_predictor.record_queued_req(req.addr_vec[int(T::Level::Rank)], channel->spec->calc_global_bank_id(req.addr_vec), req.addr_vec[int(T::Level::Subarray)], clk);
+        }
+    }
+
+    // all maintenance mechanisms of a chip share the same SA locks. The memory controller assumes the longest lock duration among them
+    uint32_t smd_max_maint_window(const uint32_t rank_id, const uint32_t chip_id) const {
+        uint32_t maint_window = get_smd_refresher(rank_id, chip_id)->get_maint_window();
+
+        if(smd_ecc_scrubbing_enabled)
+            maint_window = std::max(maint_window, get_smd_scrubber(rank_id, chip_id)->get_maint_window());
+
+        if(smd_rh_protection_enabled)
+            maint_window = std::max(maint_window, get_smd_rh_protector(rank_id, chip_id)->get_maint_window());
+
+        return maint_window;
+    }
+
     void smd_query_ref_status() {
         typename T::Command cmd = T::Command::RSQ;
         for (uint32_t rank_id = 0; rank_id < (uint32_t)channel->spec->org_entry.count[int(T::Level::Rank)]; rank_id++) {
@@ -3035,8 +3492,21 @@ private:
         //     return -1; // timing failed
         // }
 
-        int ref_bank_gid = rank_id;
-        int scrub_bank_gid = rank_id;
+        if (smd_mode == SMD_MODE::ALERT) {
+            // a single query reads the locked SAs of all banks in the rank, both for refresh and scrubbing
+            std::vector<int> req_addr = {channel->id, (int)rank_id, -1};
+            Request req_ref_status(req_addr, Request::Type::REF_STATUS_QUERY, nullptr);
+            req_ref_status.arrive = clk;
+            req_ref_status.depart = clk + channel->spec->read_latency;
+            pending.push_back(req_ref_status);
+
+            smd_total_ref_status_queries[rank_id]++;
+
+            return 0;
+        }
+
+        int ref_bank_gid = -1;
+        int scrub_bank_gid = -1;
         if (smd_mode == SMD_MODE::RSQ) {
             ref_bank_gid = smd_ref_tracker.find_bank_to_query(rank_id) ;
             if (smd_ecc_scrubbing_enabled)
@@ -3059,7 +3529,7 @@ private:
             pending.push_back(req_ref_status);
 
 
-            smd_ref_tracker.mark_inflight_req(ref_bank_gid);
+            smd_ref_tracker.mark_inflight_req(rank_id, ref_bank_gid);
 
             smd_total_ref_status_queries[rank_id]++;
 
@@ -3076,7 +3546,7 @@ private:
             pending.push_back(req_ref_status);
 
             if(smd_ecc_scrubbing_enabled)
-                smd_scrub_tracker.mark_inflight_req(scrub_bank_gid);
+                smd_scrub_tracker.mark_inflight_req(rank_id, scrub_bank_gid);
 
             smd_total_ref_status_queries[rank_id]++;
 
@@ -0,0 +1,661 @@
+#include "DDR5.h"
+#include "DRAM.h"
+
+#include <vector>
+#include <functional>
+#include <cassert>
+
+using namespace std;
+using namespace ramulator;
+
+string DDR5::standard_name = "DDR5";
+
+map<string, enum DDR5::Org> DDR5::org_map = {
+    {"DDR5_8Gb_x4", DDR5::Org::DDR5_8Gb_x4}, {"DDR5_8Gb_x8", DDR5::Org::DDR5_8Gb_x8}, {"DDR5_8Gb_x16", DDR5::Org::DDR5_8Gb_x16},
+    {"DDR5_16Gb_x4", DDR5::Org::DDR5_16Gb_x4}, {"DDR5_16Gb_x8", DDR5::Org::DDR5_16Gb_x8}, {"DDR5_16Gb_x16", DDR5::Org::DDR5_16Gb_x16},
+    {"DDR5_32Gb_x4", DDR5::Org::DDR5_32Gb_x4}, {"DDR5_32Gb_x8", DDR5::Org::DDR5_32Gb_x8}, {"DDR5_32Gb_x16", DDR5::Org::DDR5_32Gb_x16}
+};
+
+map<string, enum DDR5::Speed> DDR5::speed_map = {
+    {"DDR5_3200AN", DDR5::Speed::DDR5_3200AN}, {"DDR5_3200BN", DDR5::Speed::DDR5_3200BN}, {"DDR5_3200C", DDR5::Speed::DDR5_3200C},
+    {"DDR5_3600AN", DDR5::Speed::DDR5_3600AN},
+    {"DDR5_4000AN", DDR5::Speed::DDR5_4000AN},
+    {"DDR5_4400AN", DDR5::Speed::DDR5_4400AN},
+    {"DDR5_4800AN", DDR5::Speed::DDR5_4800AN}, {"DDR5_4800B", DDR5::Speed::DDR5_4800B}, {"DDR5_4800C", DDR5::Speed::DDR5_4800C},
+};
+
+
+DDR5::DDR5(Org org, Speed speed)
+    : org_entry(org_table[int(org)]),
+    speed_entry(speed_table[int(speed)]), 
+    read_latency(speed_entry.nCL + speed_entry.nBL)
+{
+    init_speed();
+    init_prereq();
+    init_rowhit();
+    init_rowopen();
+    init_lambda();
+    init_timing();
+}
+
+DDR5::DDR5(const string& org_str, const string& speed_str) :
+    DDR5(org_map[org_str], speed_map[speed_str]) 
+{
+}
+
+DDR5::DDR5(const Config& configs) : DDR5(org_map[configs["org"]], speed_map[configs["speed"]]){
+    act_nack_interval_ns = configs.get_float("smd_act_nack_resend_interval");
+
+    // DDR5 does not support per-bank refresh. We use same-bank refresh (REFsb) instead
+    init_refresh_mode(configs.get_bool("per_bank_refresh"));
+    init_speed();
+    init_timing();
+}
+
+void DDR5::init_refresh_mode(bool same_bank_refresh) {
+    refresh_mode = same_bank_refresh ? RefreshMode::Refresh_2X : RefreshMode::Refresh_1X;
+    translate[int(Request::Type::REFRESH)] = same_bank_refresh ? Command::REFsb : Command::REF;
+    translate[int(Request::Type::RFM)] = same_bank_refresh ? Command::RFMsb : Command::RFM;
+}
+
+void DDR5::set_channel_number(int channel) {
+  org_entry.count[int(Level::Channel)] = channel;
+}
+
+void DDR5::set_rank_number(int rank) {
+  org_entry.count[int(Level::Rank)] = rank;
+}
+
+void DDR5::set_subarray_size(uint32_t sa_size) {
+    uint rows_per_bank = org_entry.count[int(Level::Subarray)] * org_entry.count[int(Level::Row)];
+    _sa_size = sa_size;
+
+    assert((rows_per_bank % _sa_size == 0) && "ERROR: Rows per bank must be multiple of subarray size. Make sure you set the subarray size properly.");
+    org_entry.count[int(Level::Subarray)] = rows_per_bank/_sa_size;
+    org_entry.count[int(Level::Row)] = _sa_size;
+}
+
+void DDR5::init_speed()
+{
+    // refresh timings in ns
+    const static int RFC_TABLE[int(RefreshMode::MAX)][3] = {
+        {195, 295, 410}, // tRFC1
+        {130, 160, 220}  // tRFC2
+    };
+    const static int RFCsb_TABLE[3] = {115, 130, 190};
+    const static int REFSBRD_TABLE[3] = {30, 30, 30};
+    const static int REFI_NS = 3900;
+
+    int density = 0;
+    switch (org_entry.size >> 10){
+        case 8: density = 0; break;
+        case 16: density = 1; break;
+        case 32: density = 2; break;
+        default: assert(false);
+    }
+
+    speed_entry.nFAW = (org_entry.dq == 16) ? 40 : 32;
+    speed_entry.nRFC = ceil(RFC_TABLE[int(refresh_mode)][density]/speed_entry.tCK);
+    speed_entry.nRFCsb = ceil(RFCsb_TABLE[density]/speed_entry.tCK);
+    speed_entry.nREFI = ceil((REFI_NS >> int(refresh_mode))/speed_entry.tCK);
+    speed_entry.nREFSBRD = ceil(REFSBRD_TABLE[density]/speed_entry.tCK);
+    // RFMab/RFMsb take as long as the corresponding refresh commands
+    speed_entry.nRFM = speed_entry.nRFC;
+    speed_entry.nRFMsb = speed_entry.nRFCsb;
+    speed_entry.nXS = ceil((RFC_TABLE[int(RefreshMode::Refresh_1X)][density] + 10)/speed_entry.tCK);
+
+    speed_entry.nNACK_RESEND = ceil(act_nack_interval_ns/speed_entry.tCK);
+}
+
+
+void DDR5::init_prereq()
+{
+    // RD
+    prereq[int(Level::Rank)][int(Command::RD)] = [] (DRAM<DDR5>* node, Command cmd, int id) {
+        switch (int(node->state)) {
+            case int(State::PowerUp): return Command::MAX;
+            case int(State::ActPowerDown): return Command::PDX;
+            case int(State::PrePowerDown): return Command::PDX;
+            case int(State::SelfRefresh): return Command::SRX;
+            default: assert(false);
+        }};
+
+
+    prereq[int(Level::Bank)][int(Command::RD)] = [] (DRAM<DDR5>* node, Command cmd, int id) {
+        switch (int(node->state)) {
+            case int(State::Closed): return Command::ACT;
+            case int(State::Opened):
+                if (node->row_state.find(id) != node->row_state.end())
+                    return Command::MAX; // the correct SA is open (or partially open) but is the correct row open? Checked in the function below
+                else return Command::PRE; 
+            case int(State::PartiallyOpened):
+                if (node->row_state.find(id) != node->row_state.end())
+                    return Command::MAX; // the correct SA is open (or partially open) but is the correct row open? Checked in the function below
+                // else return Command::PRE; // here we probably need to return PRE when using the policy that precharges a partially-open row to attempt activating another one
+                else return Command::NOP; // here we probably need to return PRE when using the policy that precharges a partially-open row to attempt activating another one
+            default: assert(false);
+        }};
+
+    prereq[int(Level::Subarray)][int(Command::RD)] = [] (DRAM<DDR5>* node, Command cmd, int id) {
+        switch (int(node->state)) {
+            case int(State::Closed): return Command::PRE; // the target bank is active but not the target subarray (meaning another subarray is active) so need to precharge
+            case int(State::PartiallyOpened): {
+                if (node->row_state.find(id) != node->row_state.end())
+                    return Command::ACT; // the target row is partially open, try fully opening it
+                else return Command::PRE;
+            }
+            case int(State::Opened):
+                if (node->row_state.find(id) != node->row_state.end())
+                    return cmd;
+                else return Command::PRE;
+            default: assert(false);
+        }};
+    
+    // WR
+    prereq[int(Level::Rank)][int(Command::WR)] = prereq[int(Level::Rank)][int(Command::RD)];
+    prereq[int(Level::Bank)][int(Command::WR)] = prereq[int(Level::Bank)][int(Command::RD)];
+    prereq[int(Level::Subarray)][int(Command::WR)] = prereq[int(Level::Subarray)][int(Command::RD)];
+
+    // REF
+    prereq[int(Level::Rank)][int(Command::REF)] = [] (DRAM<DDR5>* node, Command cmd, int id) {
+        for (auto bg : node->children)
+            for (auto bank: bg->children) {
+                if (bank->state == State::Closed)
+                    continue;
+                return Command::PREA;
+            }
+        return Command::REF;};
+
+    // RFM
+    prereq[int(Level::Rank)][int(Command::RFM)] = [] (DRAM<DDR5>* node, Command cmd, int id) {
+        for (auto bg : node->children)
+            for (auto bank: bg->children) {
+                if (bank->state == State::Closed)
+                    continue;
+                return Command::PREA;
+            }
+        return Command::RFM;};
+
+    // REFsb and RFMsb are decoded at the target bank of every bank group
+    prereq[int(Level::Bank)][int(Command::REFsb)] = [] (DRAM<DDR5>* node, Command cmd, int id) {
+        if (node->state == State::Closed)
+            return cmd;
+        return Command::PREsb;};
+    prereq[int(Level::Bank)][int(Command::RFMsb)] = prereq[int(Level::Bank)][int(Command::REFsb)];
+
+    // PD
+    prereq[int(Level::Rank)][int(Command::PDE)] = [] (DRAM<DDR5>* node, Command cmd, int id) {
+        switch (int(node->state)) {
+            case int(State::PowerUp): return Command::PDE;
+            case int(State::ActPowerDown): return Command::PDE;
+            case int(State::PrePowerDown): return Command::PDE;
+            case int(State::SelfRefresh): return Command::SRX;
+            default: assert(false);
+        }};
+
+    // SR
+    prereq[int(Level::Rank)][int(Command::SRE)] = [] (DRAM<DDR5>* node, Command cmd, int id) {
+        switch (int(node->state)) {
+            case int(State::PowerUp): return Command::SRE;
+            case int(State::ActPowerDown): return Command::PDX;
+            case int(State::PrePowerDown): return Command::PDX;
+            case int(State::SelfRefresh): return Command::SRE;
+            default: assert(false);
+        }};
+}
+
+// row hit check functions to see if the desired location is currently open
+void DDR5::init_rowhit()
+{
+    // RD
+    rowhit[int(Level::Subarray)][int(Command::RD)] = [] (DRAM<DDR5>* node, Command cmd, int id) {
+        switch (int(node->state)) {
+            case int(State::PartiallyOpened):
+            case int(State::Closed): return false;
+            case int(State::Opened):
+                if (node->row_state.find(id) != node->row_state.end())
+                    return true;
+                return false;
+            default: assert(false);
+        }};
+
+    // WR
+    rowhit[int(Level::Subarray)][int(Command::WR)] = rowhit[int(Level::Subarray)][int(Command::RD)];
+}
+
+void DDR5::init_rowopen()
+{
+    // RD
+    rowopen[int(Level::Bank)][int(Command::RD)] = [] (DRAM<DDR5>* node, Command cmd, int id) {
+        switch (int(node->state)) {
+            case int(State::PartiallyOpened):
+            case int(State::Closed): return false;
+            case int(State::Opened): return true;
+            default: assert(false);
+        }};
+
+    // WR
+    rowopen[int(Level::Bank)][int(Command::WR)] = rowopen[int(Level::Bank)][int(Command::RD)];
+}
+
+void DDR5::init_lambda()
+{
+    lambda[int(Level::Bank)][int(Command::ACT)] = [] (DRAM<DDR5>* node, int id) {
+        node->state = State::Opened;
+        node->just_opened = true;
+        node->row_state[id] = State::Opened;}; // row_state is more like child_state now
+    
+    lambda[int(Level::Subarray)][int(Command::ACT)] = [] (DRAM<DDR5>* node, int id) {
+        node->state = State::Opened;
+        node->row_state[id] = State::Opened;};
+
+
+    lambda[int(Level::Bank)][int(Command::PRE)] = [] (DRAM<DDR5>* node, int id) {
+        // assert(node->state != State::PartiallyOpened); // DEBUG
+
+        assert(node->state == State::Opened || node->state == State::PartiallyOpened);
+        assert(node->row_state.begin() != node->row_state.end());
+        auto open_SA = node->children[node->row_state.begin()->first];
+        assert(open_SA->state == State::Opened || open_SA->state == State::PartiallyOpened);
+
+        node->collect_opened_cycles(node->cur_clk);
+        open_SA->state = State::Closed;
+        node->state = State::Closed;
+        open_SA->row_state.clear();
+        node->row_state.clear();};
+
+
+    // PREsb closes the target bank in all bank groups, some of which may already be closed
+    lambda[int(Level::Bank)][int(Command::PREsb)] = [this] (DRAM<DDR5>* node, int id) {
+        if (node->state != State::Closed)
+            lambda[int(Level::Bank)][int(Command::PRE)](node, id);
+        };
+
+
+    lambda[int(Level::Bank)][int(Command::ACT_NACK)] = [] (DRAM<DDR5>* node, int id) {
+        assert(node->state == State::Opened);
+        assert(node->row_state.begin() != node->row_state.end());
+        auto open_SA = node->children[node->row_state.begin()->first];
+        assert(open_SA->state == State::Opened);
+
+        open_SA->state = State::Closed;
+        node->state = State::Closed;
+        open_SA->row_state.clear();
+        node->row_state.clear();};
+
+    lambda[int(Level::Bank)][int(Command::ACT_PARTIAL_NACK)] = [] (DRAM<DDR5>* node, int id) {
+        assert(node->state == State::Opened);
+        assert(node->row_state.begin() != node->row_state.end());
+        auto open_SA = node->children[node->row_state.begin()->first];
+        assert(open_SA->state == State::Opened);
+
+        open_SA->state = State::PartiallyOpened;
+        node->state = State::PartiallyOpened;
+    };
+
+    lambda[int(Level::Bank)][int(Command::PRE_RSQ)] = [this] (DRAM<DDR5>* node, int id) {
+        lambda[int(Level::Bank)][int(Command::PRE)](node, id);
+        };
+    lambda[int(Level::Bank)][int(Command::RSQ)] = [] (DRAM<DDR5>* node, int id) {};
+
+    lambda[int(Level::Rank)][int(Command::PREA)] = [] (DRAM<DDR5>* node, int id) {
+        for (auto bg : node->children)
+            for (auto bank : bg->children) {
+                if(bank->state == State::Opened) {
+                    bank->collect_opened_cycles(node->cur_clk);
+
+                    if (bank->row_state.begin() != bank->row_state.end()) {
+                        auto open_SA = bank->children[bank->row_state.begin()->first];
+                        assert(open_SA->state == State::Opened);
+
+                        open_SA->state = State::Closed;
+                        open_SA->row_state.clear();
+                    }       
+                }
+                bank->state = State::Closed;
+                bank->row_state.clear();
+            }};
+    lambda[int(Level::Rank)][int(Command::REF)] = [] (DRAM<DDR5>* node, int id) {};
+    lambda[int(Level::Rank)][int(Command::RFM)] = [] (DRAM<DDR5>* node, int id) {};
+    lambda[int(Level::Bank)][int(Command::RD)] = [] (DRAM<DDR5>* node, int id) {
+        node->just_opened = false;
+    };
+    lambda[int(Level::Bank)][int(Command::WR)] = [] (DRAM<DDR5>* node, int id) {
+        node->just_opened = false;
+    };
+    lambda[int(Level::Bank)][int(Command::RDA)] = [] (DRAM<DDR5>* node, int id) {
+        assert(node->state == State::Opened);
+        node->just_opened = false;
+        node->collect_opened_cycles(node->cur_clk);
+        node->state = State::Closed;
+
+        assert(node->row_state.begin() != node->row_state.end());
+        auto open_SA = node->children[node->row_state.begin()->first];
+        assert(open_SA->state == State::Opened);
+        open_SA->state = State::Closed;
+        open_SA->row_state.clear();
+        node->row_state.clear();
+        };
+    lambda[int(Level::Bank)][int(Command::WRA)] = [] (DRAM<DDR5>* node, int id) {
+        assert(node->state == State::Opened);
+        node->just_opened = false;
+        node->collect_opened_cycles(node->cur_clk);
+        node->state = State::Closed;
+
+        assert(node->row_state.begin() != node->row_state.end());
+        auto open_SA = node->children[node->row_state.begin()->first];
+        assert(open_SA->state == State::Opened);
+        open_SA->state = State::Closed;
+        open_SA->row_state.clear();
+        node->row_state.clear();
+        };
+    lambda[int(Level::Rank)][int(Command::PDE)] = [] (DRAM<DDR5>* node, int id) {
+        for (auto bg : node->children)
+            for (auto bank : bg->children) {
+                if (bank->state == State::Closed)
+                    continue;
+                node->state = State::ActPowerDown;
+                return;
+            }
+        node->state = State::PrePowerDown;};
+    lambda[int(Level::Rank)][int(Command::PDX)] = [] (DRAM<DDR5>* node, int id) {
+        node->state = State::PowerUp;};
+    lambda[int(Level::Rank)][int(Command::SRE)] = [] (DRAM<DDR5>* node, int id) {
+        node->state = State::SelfRefresh;};
+    lambda[int(Level::Rank)][int(Command::SRX)] = [] (DRAM<DDR5>* node, int id) {
+        node->state = State::PowerUp;};
+}
+
+
+// REF and REFsb have separate timings, so per_bank_refresh does not change the timing tables of DDR5
+void DDR5::init_timing(bool per_bank_refresh)
+{
+    // clear current timing entries
+    for (auto& v : timing){
+        for (auto& v2 : v){
+            v2.clear();
+        }
+    }
+    
+    SpeedEntry& s = speed_entry;
+    vector<TimingEntry> *t;
+
+    /*** Channel ***/ 
+    t = timing[int(Level::Channel)];
+
+    // CAS <-> CAS
+    t[int(Command::RD)].push_back({Command::RD, 1, s.nBL});
+    t[int(Command::RD)].push_back({Command::RDA, 1, s.nBL});
+    t[int(Command::RDA)].push_back({Command::RD, 1, s.nBL});
+    t[int(Command::RDA)].push_back({Command::RDA, 1, s.nBL});
+    t[int(Command::WR)].push_back({Command::WR, 1, s.nBL});
+    t[int(Command::WR)].push_back({Command::WRA, 1, s.nBL});
+    t[int(Command::WRA)].push_back({Command::WR, 1, s.nBL});
+    t[int(Command::WRA)].push_back({Command::WRA, 1, s.nBL});
+
+    t[int(Command::PRE_RSQ)].push_back({Command::RD, 1, s.nBL});
+    t[int(Command::PRE_RSQ)].push_back({Command::RDA, 1, s.nBL});
+    t[int(Command::PRE_RSQ)].push_back({Command::WR, 1, s.nBL});
+    t[int(Command::PRE_RSQ)].push_back({Command::WRA, 1, s.nBL});
+    t[int(Command::RSQ)].push_back({Command::RD, 1, s.nBL});
+    t[int(Command::RSQ)].push_back({Command::RDA, 1, s.nBL});
+    t[int(Command::RSQ)].push_back({Command::WR, 1, s.nBL});
+    t[int(Command::RSQ)].push_back({Command::WRA, 1, s.nBL});
+
+    t[int(Command::RD)].push_back({Command::PRE_RSQ, 1, s.nBL});
+    t[int(Command::RDA)].push_back({Command::PRE_RSQ, 1, s.nBL});
+    t[int(Command::WR)].push_back({Command::PRE_RSQ, 1, s.nBL});
+    t[int(Command::WRA)].push_back({Command::PRE_RSQ, 1, s.nBL});
+    t[int(Command::RD)].push_back({Command::RSQ, 1, s.nBL});
+    t[int(Command::RDA)].push_back({Command::RSQ, 1, s.nBL});
+    t[int(Command::WR)].push_back({Command::RSQ, 1, s.nBL});
+    t[int(Command::WRA)].push_back({Command::RSQ, 1, s.nBL});
+
+
+    /*** Rank ***/ 
+    t = timing[int(Level::Rank)];
+
+    // CAS <-> CAS
+    t[int(Command::RD)].push_back({Command::RD, 1, s.nCCDS});
+    t[int(Command::RD)].push_back({Command::RDA, 1, s.nCCDS});
+    t[int(Command::RDA)].push_back({Command::RD, 1, s.nCCDS});
+    t[int(Command::RDA)].push_back({Command::RDA, 1, s.nCCDS});
+    t[int(Command::WR)].push_back({Command::WR, 1, s.nCCDS});
+    t[int(Command::WR)].push_back({Command::WRA, 1, s.nCCDS});
+    t[int(Command::WRA)].push_back({Command::WR, 1, s.nCCDS});
+    t[int(Command::WRA)].push_back({Command::WRA, 1, s.nCCDS});
+    t[int(Command::RD)].push_back({Command::WR, 1, s.nCL + s.nCCDS + 2 - s.nCWL});
+    t[int(Command::RD)].push_back({Command::WRA, 1, s.nCL + s.nCCDS + 2 - s.nCWL});
+    t[int(Command::RDA)].push_back({Command::WR, 1, s.nCL + s.nCCDS + 2 - s.nCWL});
+    t[int(Command::RDA)].push_back({Command::WRA, 1, s.nCL + s.nCCDS + 2 - s.nCWL});
+    t[int(Command::WR)].push_back({Command::RD, 1, s.nCWL + s.nBL + s.nWTRS});
+    t[int(Command::WR)].push_back({Command::RDA, 1, s.nCWL + s.nBL + s.nWTRS});
+    t[int(Command::WRA)].push_back({Command::RD, 1, s.nCWL + s.nBL + s.nWTRS});
+    t[int(Command::WRA)].push_back({Command::RDA, 1, s.nCWL + s.nBL + s.nWTRS});
+
+    t[int(Command::PRE_RSQ)].push_back({Command::RD, 1, s.nCCDS});
+    t[int(Command::PRE_RSQ)].push_back({Command::RDA, 1, s.nCCDS});
+    t[int(Command::RD)].push_back({Command::PRE_RSQ, 1, s.nCCDS});
+    t[int(Command::RDA)].push_back({Command::PRE_RSQ, 1, s.nCCDS});
+    t[int(Command::PRE_RSQ)].push_back({Command::WR, 1, s.nCCDS});
+    t[int(Command::PRE_RSQ)].push_back({Command::WRA, 1, s.nCCDS});
+    t[int(Command::WR)].push_back({Command::PRE_RSQ, 1, s.nCCDS});
+    t[int(Command::WRA)].push_back({Command::PRE_RSQ, 1, s.nCCDS});
+
+    t[int(Command::RSQ)].push_back({Command::RD, 1, s.nCCDS});
+    t[int(Command::RSQ)].push_back({Command::RDA, 1, s.nCCDS});
+    t[int(Command::RD)].push_back({Command::RSQ, 1, s.nCCDS});
+    t[int(Command::RDA)].push_back({Command::RSQ, 1, s.nCCDS});
+    t[int(Command::RSQ)].push_back({Command::WR, 1, s.nCCDS});
+    t[int(Command::RSQ)].push_back({Command::WRA, 1, s.nCCDS});
+    t[int(Command::WR)].push_back({Command::RSQ, 1, s.nCCDS});
+    t[int(Command::WRA)].push_back({Command::RSQ, 1, s.nCCDS});
+
+
+
+    // CAS <-> CAS (between sibling ranks)
+    t[int(Command::RD)].push_back({Command::RD, 1, s.nBL + s.nRTRS, true});
+    t[int(Command::RD)].push_back({Command::RDA, 1, s.nBL + s.nRTRS, true});
+    t[int(Command::RDA)].push_back({Command::RD, 1, s.nBL + s.nRTRS, true});
+    t[int(Command::RDA)].push_back({Command::RDA, 1, s.nBL + s.nRTRS, true});
+    t[int(Command::RD)].push_back({Command::WR, 1, s.nBL + s.nRTRS, true});
+    t[int(Command::RD)].push_back({Command::WRA, 1, s.nBL + s.nRTRS, true});
+    t[int(Command::RDA)].push_back({Command::WR, 1, s.nBL + s.nRTRS, true});
+    t[int(Command::RDA)].push_back({Command::WRA, 1, s.nBL + s.nRTRS, true});
+    t[int(Command::RD)].push_back({Command::WR, 1, s.nCL + s.nBL + s.nRTRS - s.nCWL, true});
+    t[int(Command::RD)].push_back({Command::WRA, 1, s.nCL + s.nBL + s.nRTRS - s.nCWL, true});
+    t[int(Command::RDA)].push_back({Command::WR, 1, s.nCL + s.nBL + s.nRTRS - s.nCWL, true});
+    t[int(Command::RDA)].push_back({Command::WRA, 1, s.nCL + s.nBL + s.nRTRS - s.nCWL, true});
+    t[int(Command::WR)].push_back({Command::RD, 1, s.nCWL + s.nBL + s.nRTRS - s.nCL, true});
+    t[int(Command::WR)].push_back({Command::RDA, 1, s.nCWL + s.nBL + s.nRTRS - s.nCL, true});
+    t[int(Command::WRA)].push_back({Command::RD, 1, s.nCWL + s.nBL + s.nRTRS - s.nCL, true});
+    t[int(Command::WRA)].push_back({Command::RDA, 1, s.nCWL + s.nBL + s.nRTRS - s.nCL, true});
+
+    t[int(Command::RD)].push_back({Command::PREA, 1, s.nRTP});
+    t[int(Command::WR)].push_back({Command::PREA, 1, s.nCWL + s.nBL + s.nWR});
+
+    t[int(Command::PRE_RSQ)].push_back({Command::RD, 1, s.nBL + s.nRTRS, true});
+    t[int(Command::PRE_RSQ)].push_back({Command::RDA, 1, s.nBL + s.nRTRS, true});
+    t[int(Command::RD)].push_back({Command::PRE_RSQ, 1, s.nBL + s.nRTRS, true});
+    t[int(Command::RDA)].push_back({Command::PRE_RSQ, 1, s.nBL + s.nRTRS, true});
+    t[int(Command::PRE_RSQ)].push_back({Command::WR, 1, s.nBL + s.nRTRS, true});
+    t[int(Command::PRE_RSQ)].push_back({Command::WRA, 1, s.nBL + s.nRTRS, true});
+    t[int(Command::WR)].push_back({Command::PRE_RSQ, 1, s.nBL + s.nRTRS, true});
+    t[int(Command::WRA)].push_back({Command::PRE_RSQ, 1, s.nBL + s.nRTRS, true});
+
+    t[int(Command::RSQ)].push_back({Command::RD, 1, s.nBL + s.nRTRS, true});
+    t[int(Command::RSQ)].push_back({Command::RDA, 1, s.nBL + s.nRTRS, true});
+    t[int(Command::RD)].push_back({Command::RSQ, 1, s.nBL + s.nRTRS, true});
+    t[int(Command::RDA)].push_back({Command::RSQ, 1, s.nBL + s.nRTRS, true});
+    t[int(Command::RSQ)].push_back({Command::WR, 1, s.nBL + s.nRTRS, true});
+    t[int(Command::RSQ)].push_back({Command::WRA, 1, s.nBL + s.nRTRS, true});
+    t[int(Command::WR)].push_back({Command::RSQ, 1, s.nBL + s.nRTRS, true});
+    t[int(Command::WRA)].push_back({Command::RSQ, 1, s.nBL + s.nRTRS, true});
+
+
+    // CAS <-> PD
+    t[int(Command::RD)].push_back({Command::PDE, 1, s.nCL + s.nBL + 1});
+    t[int(Command::RDA)].push_back({Command::PDE, 1, s.nCL + s.nBL + 1});
+    t[int(Command::WR)].push_back({Command::PDE, 1, s.nCWL + s.nBL + s.nWR});
+    t[int(Command::WRA)].push_back({Command::PDE, 1, s.nCWL + s.nBL + s.nWR + 1}); // +1 for pre
+    t[int(Command::PDX)].push_back({Command::RD, 1, s.nXP});
+    t[int(Command::PDX)].push_back({Command::RDA, 1, s.nXP});
+    t[int(Command::PDX)].push_back({Command::WR, 1, s.nXP});
+    t[int(Command::PDX)].push_back({Command::WRA, 1, s.nXP});
+    
+    // CAS <-> SR: none (all banks have to be precharged)
+
+    // RAS <-> RAS
+    t[int(Command::ACT)].push_back({Command::ACT, 1, s.nRRDS});
+    t[int(Command::ACT)].push_back({Command::ACT, 4, s.nFAW});
+    t[int(Command::ACT)].push_back({Command::PREA, 1, s.nRAS});
+    t[int(Command::PREA)].push_back({Command::ACT, 1, s.nRP});
+
+    t[int(Command::ACT_PARTIAL_NACK)].push_back({Command::PREA, 1, s.nRAS - s.nACTtoNACK});
+
+    // RAS <-> REF
+    t[int(Command::PRE)].push_back({Command::REF, 1, s.nRP});
+    t[int(Command::PREA)].push_back({Command::REF, 1, s.nRP});
+    t[int(Command::PREsb)].push_back({Command::REF, 1, s.nRP});
+    t[int(Command::REF)].push_back({Command::ACT, 1, s.nRFC});
+
+    t[int(Command::PRE_RSQ)].push_back({Command::REF, 1, s.nRP});
+
+    // RAS <-> RFM
+    t[int(Command::PRE)].push_back({Command::RFM, 1, s.nRP});
+    t[int(Command::PREA)].push_back({Command::RFM, 1, s.nRP});
+    t[int(Command::PREsb)].push_back({Command::RFM, 1, s.nRP});
+    t[int(Command::RFM)].push_back({Command::ACT, 1, s.nRFM});
+
+    t[int(Command::PRE_RSQ)].push_back({Command::RFM, 1, s.nRP});
+
+    // RAS <-> same-bank REF/RFM (the target banks are handled at the bank level)
+    t[int(Command::PREA)].push_back({Command::REFsb, 1, s.nRP});
+    t[int(Command::PREA)].push_back({Command::RFMsb, 1, s.nRP});
+    t[int(Command::REFsb)].push_back({Command::ACT, 1, s.nREFSBRD});
+    t[int(Command::RFMsb)].push_back({Command::ACT, 1, s.nREFSBRD});
+
+    // RAS <-> PD
+    t[int(Command::ACT)].push_back({Command::PDE, 1, 1});
+    t[int(Command::PDX)].push_back({Command::ACT, 1, s.nXP});
+    t[int(Command::PDX)].push_back({Command::PRE, 1, s.nXP});
+    t[int(Command::PDX)].push_back({Command::PREA, 1, s.nXP});
+    t[int(Command::PDX)].push_back({Command::PREsb, 1, s.nXP});
+
+    // RAS <-> SR
+    t[int(Command::PRE)].push_back({Command::SRE, 1, s.nRP});
+    t[int(Command::PREA)].push_back({Command::SRE, 1, s.nRP});
+    t[int(Command::PREsb)].push_back({Command::SRE, 1, s.nRP});
+    t[int(Command::SRX)].push_back({Command::ACT, 1, s.nXS});
+
+    // REF <-> REF
+    t[int(Command::REF)].push_back({Command::REF, 1, s.nRFC});
+    t[int(Command::REF)].push_back({Command::RFM, 1, s.nRFC});
+    t[int(Command::RFM)].push_back({Command::REF, 1, s.nRFM});
+    t[int(Command::RFM)].push_back({Command::RFM, 1, s.nRFM});
+
+    t[int(Command::REFsb)].push_back({Command::REFsb, 1, s.nREFSBRD});
+    t[int(Command::REFsb)].push_back({Command::RFMsb, 1, s.nREFSBRD});
+    t[int(Command::RFMsb)].push_back({Command::REFsb, 1, s.nREFSBRD});
+    t[int(Command::RFMsb)].push_back({Command::RFMsb, 1, s.nREFSBRD});
+
+    // REF <-> PD
+    for (auto ref_cmd : {Command::REF, Command::REFsb, Command::RFM, Command::RFMsb}) {
+        t[int(ref_cmd)].push_back({Command::PDE, 1, 1});
+        t[int(Command::PDX)].push_back({ref_cmd, 1, s.nXP});
+    }
+
+    // REF <-> SR
+    for (auto ref_cmd : {Command::REF, Command::REFsb, Command::RFM, Command::RFMsb})
+        t[int(Command::SRX)].push_back({ref_cmd, 1, s.nXS});
+    
+    // PD <-> PD
+    t[int(Command::PDE)].push_back({Command::PDX, 1, s.nPD});
+    t[int(Command::PDX)].push_back({Command::PDE, 1, s.nXP});
+
+    // PD <-> SR
+    t[int(Command::PDX)].push_back({Command::SRE, 1, s.nXP});
+    t[int(Command::SRX)].push_back({Command::PDE, 1, s.nXS});
+    
+    // SR <-> SR
+    t[int(Command::SRE)].push_back({Command::SRX, 1, s.nCKESR});
+    t[int(Command::SRX)].push_back({Command::SRE, 1, s.nXS});
+
+    /*** Bank Group ***/ 
+    t = timing[int(Level::BankGroup)];
+    // CAS <-> CAS
+    t[int(Command::RD)].push_back({Command::RD, 1, s.nCCDL});
+    t[int(Command::RD)].push_back({Command::RDA, 1, s.nCCDL});
+    t[int(Command::RDA)].push_back({Command::RD, 1, s.nCCDL});
+    t[int(Command::RDA)].push_back({Command::RDA, 1, s.nCCDL});
+    t[int(Command::WR)].push_back({Command::WR, 1, s.nCCDL});
+    t[int(Command::WR)].push_back({Command::WRA, 1, s.nCCDL});
+    t[int(Command::WRA)].push_back({Command::WR, 1, s.nCCDL});
+    t[int(Command::WRA)].push_back({Command::WRA, 1, s.nCCDL});
+    t[int(Command::WR)].push_back({Command::WR, 1, s.nCCDL});
+    t[int(Command::WR)].push_back({Command::WRA, 1, s.nCCDL});
+    t[int(Command::WRA)].push_back({Command::WR, 1, s.nCCDL});
+    t[int(Command::WRA)].push_back({Command::WRA, 1, s.nCCDL});
+    t[int(Command::WR)].push_back({Command::RD, 1, s.nCWL + s.nBL + s.nWTRL});
+    t[int(Command::WR)].push_back({Command::RDA, 1, s.nCWL + s.nBL + s.nWTRL});
+    t[int(Command::WRA)].push_back({Command::RD, 1, s.nCWL + s.nBL + s.nWTRL});
+    t[int(Command::WRA)].push_back({Command::RDA, 1, s.nCWL + s.nBL + s.nWTRL});
+
+
+    // RAS <-> RAS
+    t[int(Command::ACT)].push_back({Command::ACT, 1, s.nRRDL});
+
+    /*** Bank ***/ 
+    t = timing[int(Level::Bank)];
+
+    // CAS <-> RAS
+    t[int(Command::ACT)].push_back({Command::RD, 1, s.nRCD});
+    t[int(Command::ACT)].push_back({Command::RDA, 1, s.nRCD});
+    t[int(Command::ACT)].push_back({Command::WR, 1, s.nRCD});
+    t[int(Command::ACT)].push_back({Command::WRA, 1, s.nRCD});
+
+    t[int(Command::RD)].push_back({Command::PRE, 1, s.nRTP});
+    t[int(Command::WR)].push_back({Command::PRE, 1, s.nCWL + s.nBL + s.nWR});
+
+    t[int(Command::RDA)].push_back({Command::ACT, 1, s.nRTP + s.nRP});
+    t[int(Command::WRA)].push_back({Command::ACT, 1, s.nCWL + s.nBL + s.nWR + s.nRP});
+
+    // RAS <-> RAS
+    // t[int(Command::ACT)].push_back({Command::ACT, 1, s.nRC}); // This is not really needed as nRAS and nPRE enforce this timing anyway. Removing this as it creates problems with ACT_NACK commands in SMD
+    t[int(Command::ACT)].push_back({Command::PRE, 1, s.nRAS});
+    t[int(Command::PRE)].push_back({Command::ACT, 1, s.nRP});
+
+    t[int(Command::ACT)].push_back({Command::PRE_RSQ, 1, s.nRAS});
+    t[int(Command::PRE_RSQ)].push_back({Command::ACT, 1, s.nRP});
+
+    t[int(Command::ACT_PARTIAL_NACK)].push_back({Command::PRE, 1, s.nRAS - s.nACTtoNACK});
+
+    // PREsb
+    t[int(Command::ACT)].push_back({Command::PREsb, 1, s.nRAS});
+    t[int(Command::ACT_PARTIAL_NACK)].push_back({Command::PREsb, 1, s.nRAS - s.nACTtoNACK});
+    t[int(Command::RD)].push_back({Command::PREsb, 1, s.nRTP});
+    t[int(Command::WR)].push_back({Command::PREsb, 1, s.nCWL + s.nBL + s.nWR});
+    t[int(Command::PREsb)].push_back({Command::ACT, 1, s.nRP});
+
+    // RAS <-> same-bank REF/RFM
+    for (auto ref_cmd : {Command::REFsb, Command::RFMsb}) {
+        int rfc = (ref_cmd == Command::REFsb) ? s.nRFCsb : s.nRFMsb;
+
+        t[int(Command::PRE)].push_back({ref_cmd, 1, s.nRP});
+        t[int(Command::PREsb)].push_back({ref_cmd, 1, s.nRP});
+        t[int(Command::PRE_RSQ)].push_back({ref_cmd, 1, s.nRP});
+        t[int(Command::RDA)].push_back({ref_cmd, 1, s.nRTP + s.nRP});
+        t[int(Command::WRA)].push_back({ref_cmd, 1, s.nCWL + s.nBL + s.nWR + s.nRP});
+
+        t[int(ref_cmd)].push_back({Command::ACT, 1, rfc});
+        t[int(ref_cmd)].push_back({Command::REFsb, 1, rfc});
+        t[int(ref_cmd)].push_back({Command::RFMsb, 1, rfc});
+    }
+
+
+    /*** Subarray ***/ 
+    t = timing[int(Level::Subarray)];
+
+    t[int(Command::ACT_NACK)].push_back({Command::ACT, 1, s.nNACK_RESEND});
+    t[int(Command::ACT_PARTIAL_NACK)].push_back({Command::ACT, 1, s.nNACK_RESEND});
+}
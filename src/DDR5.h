@@ -0,0 +1,281 @@
+#ifndef __DDR5_H
+#define __DDR5_H
+
+#include "DRAM.h"
+#include "Request.h"
+#include "Config.h"
+#include <vector>
+#include <functional>
+
+using namespace std;
+
+namespace ramulator
+{
+
+// A DDR5 DIMM has two independent 32-bit subchannels. Each subchannel is modeled as a separate channel.
+class DDR5
+{
+public:
+    static string standard_name;
+    enum class Org;
+    enum class Speed;
+    DDR5(Org org, Speed speed);
+    DDR5(const string& org_str, const string& speed_str);
+    DDR5(const Config& configs);
+
+    static map<string, enum Org> org_map;
+    static map<string, enum Speed> speed_map;
+    /* Level */
+    enum class Level : int
+    {
+        Channel, Rank, BankGroup, Bank, Subarray, Row, Column, MAX
+    };
+
+    /* Command */
+    // Same-bank commands (PREsb, REFsb, RFMsb) target one bank index in all bank groups.
+    // They are issued with a negative bank group id in the address vector.
+    enum class Command : int
+    {
+        ACT, PRE, PREA, PREsb,
+        RD,  WR,  RDA,  WRA,
+        REF, REFsb, RFM, RFMsb,
+        PDE, PDX,  SRE, SRX,
+        PRE_RSQ, RSQ, ACT_NACK, ACT_PARTIAL_NACK, NOP,
+        MAX
+    };
+
+    string command_name[int(Command::MAX)] = {
+        "ACT", "PRE", "PREA", "PREsb",
+        "RD",  "WR",  "RDA",  "WRA",
+        "REF", "REFsb", "RFM", "RFMsb",
+        "PDE", "PDX",  "SRE", "SRX",
+        "PRE_RSQ", "RSQ", "ACT_NACK", "ACT_PARTIAL_NACK", "NOP"
+    };
+
+    Level scope[int(Command::MAX)] = {
+        Level::Row,    Level::Bank,   Level::Rank,   Level::Bank,
+        Level::Column, Level::Column, Level::Column, Level::Column,
+        Level::Rank,   Level::Bank,   Level::Rank,   Level::Bank,
+        Level::Rank,   Level::Rank,   Level::Rank,   Level::Rank,
+        Level::Bank,   Level::Rank,   Level::Subarray, Level::Subarray, Level::Subarray
+    };
+
+    bool is_opening(Command cmd)
+    {
+        switch(int(cmd)) {
+            case int(Command::ACT):
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    bool is_accessing(Command cmd)
+    {
+        switch(int(cmd)) {
+            case int(Command::RD):
+            case int(Command::WR):
+            case int(Command::RDA):
+            case int(Command::WRA):
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    bool is_closing(Command cmd)
+    {
+        switch(int(cmd)) {
+            case int(Command::RDA):
+            case int(Command::WRA):
+            case int(Command::PRE):
+            case int(Command::PREA):
+            case int(Command::PREsb):
+            case int(Command::PRE_RSQ):
+            case int(Command::ACT_NACK):
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    bool is_refreshing(Command cmd)
+    {
+        switch(int(cmd)) {
+            case int(Command::REF):
+            case int(Command::REFsb):
+            case int(Command::RFM):
+            case int(Command::RFMsb):
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    void mult_refresh_pb(float mult) {};
+
+    Command add_autoprecharge (const Command cmd) {
+        switch(int(cmd)) {
+            case int(Command::RD):
+            case int(Command::RDA):
+                return Command::RDA;
+            case int(Command::WR):
+            case int(Command::WRA):
+                return Command::WRA;
+            default:
+                assert(false);
+                return cmd;
+        }
+    }
+
+    // calculates a single bank id based on the bank group ID and bank ID
+    uint32_t calc_global_bank_id(const std::vector<int> addr_vec) const {
+        uint32_t banks_per_bg = org_entry.count[uint32_t(Level::Bank)];
+
+        return addr_vec[uint32_t(Level::BankGroup)]*banks_per_bg + addr_vec[uint32_t(Level::Bank)];
+    }
+
+    uint32_t calc_row_id_in_bank(const std::vector<int> addr_vec) const {
+        return addr_vec[uint32_t(Level::Subarray)]*get_subarray_size() + addr_vec[uint32_t(Level::Row)];
+    }
+
+    uint32_t get_num_banks_per_rank() const {
+        return org_entry.count[uint32_t(Level::BankGroup)] * org_entry.count[uint32_t(Level::Bank)];
+    }
+
+    uint32_t get_num_all_banks() const {
+        return org_entry.count[uint32_t(Level::Rank)] * org_entry.count[uint32_t(Level::BankGroup)] * org_entry.count[uint32_t(Level::Bank)];
+    }
+
+    /* State */
+    enum class State : int
+    {
+        Opened, Closed, PartiallyOpened, PowerUp, ActPowerDown, PrePowerDown, SelfRefresh, MAX
+    } start[int(Level::MAX)] = {
+        State::MAX, State::PowerUp, State::MAX, State::Closed, State::Closed, State::Closed, State::MAX
+    };
+
+    /* Translate */
+    // REFRESH and RFM requests are translated to their same-bank variants in the same-bank refresh mode (see init_refresh_mode())
+    Command translate[int(Request::Type::MAX)] = {
+        Command::RD,  Command::WR,
+        Command::REF, Command::PDE, Command::SRE,
+        Command::RD, Command::RD, // PARA_REFRESH, RAIDR_REFRESH
+        Command::MAX, Command::RD // EXTENSION (unused), PREFETCH
+    };
+
+    /* Prereq */
+    function<Command(DRAM<DDR5>*, Command cmd, int)> prereq[int(Level::MAX)][int(Command::MAX)];
+
+    /* Row hit */
+    function<bool(DRAM<DDR5>*, Command cmd, int)> rowhit[int(Level::MAX)][int(Command::MAX)];
+    function<bool(DRAM<DDR5>*, Command cmd, int)> rowopen[int(Level::MAX)][int(Command::MAX)];
+
+    /* Timing */
+    struct TimingEntry
+    {
+        Command cmd;
+        int dist;
+        int val;
+        bool sibling;
+    };
+    vector<TimingEntry> timing[int(Level::MAX)][int(Command::MAX)];
+
+    /* Lambda */
+    function<void(DRAM<DDR5>*, int)> lambda[int(Level::MAX)][int(Command::MAX)];
+
+    /* Organization */
+    enum class Org : int
+    {
+        DDR5_8Gb_x4,   DDR5_8Gb_x8,   DDR5_8Gb_x16,
+        DDR5_16Gb_x4,  DDR5_16Gb_x8,  DDR5_16Gb_x16,
+        DDR5_32Gb_x4,  DDR5_32Gb_x8,  DDR5_32Gb_x16,
+        MAX
+    };
+
+    struct OrgEntry {
+        int size;
+        int dq;
+        int count[int(Level::MAX)];
+    } org_table[int(Org::MAX)] = {
+        {8<<10,   4, {0, 0, 8, 2, 1, 1<<16, 1<<11}}, {8<<10,   8, {0, 0, 8, 2, 1, 1<<16, 1<<10}}, {8<<10,  16, {0, 0, 4, 2, 1, 1<<16, 1<<10}},
+        {16<<10,  4, {0, 0, 8, 4, 1, 1<<16, 1<<11}}, {16<<10,  8, {0, 0, 8, 4, 1, 1<<16, 1<<10}}, {16<<10, 16, {0, 0, 4, 4, 1, 1<<16, 1<<10}},
+        {32<<10,  4, {0, 0, 8, 4, 1, 1<<17, 1<<11}}, {32<<10,  8, {0, 0, 8, 4, 1, 1<<17, 1<<10}}, {32<<10, 16, {0, 0, 4, 4, 1, 1<<17, 1<<10}}
+    }, org_entry;
+
+    void set_channel_number(int channel);
+    void set_rank_number(int rank);
+    void set_subarray_size(uint32_t sa_size);
+    uint32_t get_subarray_size() const {
+        return _sa_size;
+    }
+
+    /* Speed */
+    enum class Speed : int
+    {
+        DDR5_3200AN, DDR5_3200BN, DDR5_3200C,
+        DDR5_3600AN,
+        DDR5_4000AN,
+        DDR5_4400AN,
+        DDR5_4800AN, DDR5_4800B, DDR5_4800C,
+        MAX
+    };
+
+    // Refresh_2X is the fine granularity refresh (FGR) mode, which is required for same-bank refresh
+    enum class RefreshMode : int
+    {
+        Refresh_1X,
+        Refresh_2X,
+        MAX
+    } refresh_mode = RefreshMode::Refresh_1X;
+
+    int prefetch_size = 16; // BL16
+    int channel_width = 32; // per subchannel
+
+    struct SpeedEntry {
+        int rate;
+        double freq, tCK;
+        int nBL, nCCDS, nCCDL, nRTRS;
+        int nCL, nRCD, nRP, nCWL;
+        int nRAS, nRC;
+        int nRTP, nWTRS, nWTRL, nWR;
+        int nRRDS, nRRDL, nFAW;
+        int nRFC, nRFCsb, nREFI, nREFSBRD;
+        int nRFM, nRFMsb;
+        int nPD, nXP, nXPDLL;
+        int nCKESR, nXS, nXSDLL;
+        int nNACK_RESEND, nACTtoNACK;
+    } speed_table[int(Speed::MAX)] = {
+        {3200, 1600,          0.625,          prefetch_size/2, 8,  8, 2, 22, 22, 22, 20, 52, 74, 12, 4, 16, 48, 8,  8, 0, 0, 0, 0, 0, 0, 0, 12, 12, 0, 12, 0, 0, 0, 0},
+        {3200, 1600,          0.625,          prefetch_size/2, 8,  8, 2, 26, 26, 26, 24, 52, 78, 12, 4, 16, 48, 8,  8, 0, 0, 0, 0, 0, 0, 0, 12, 12, 0, 12, 0, 0, 0, 0},
+        {3200, 1600,          0.625,          prefetch_size/2, 8,  8, 2, 28, 28, 28, 26, 52, 80, 12, 4, 16, 48, 8,  8, 0, 0, 0, 0, 0, 0, 0, 12, 12, 0, 12, 0, 0, 0, 0},
+        {3600, 1800,  1000.0/1800,          prefetch_size/2, 8,  9, 2, 26, 26, 26, 24, 58, 84, 14, 5, 18, 54, 8,  9, 0, 0, 0, 0, 0, 0, 0, 14, 14, 0, 14, 0, 0, 0, 0},
+        {4000, 2000,            0.5,          prefetch_size/2, 8, 10, 2, 28, 28, 28, 26, 64, 92, 15, 5, 20, 60, 8, 10, 0, 0, 0, 0, 0, 0, 0, 15, 15, 0, 15, 0, 0, 0, 0},
+        {4400, 2200,  1000.0/2200,          prefetch_size/2, 8, 11, 2, 32, 32, 32, 30, 71, 103, 17, 6, 22, 66, 8, 11, 0, 0, 0, 0, 0, 0, 0, 17, 17, 0, 17, 0, 0, 0, 0},
+        {4800, 2400,  1000.0/2400,          prefetch_size/2, 8, 12, 2, 34, 34, 34, 32, 77, 111, 18, 6, 24, 72, 8, 12, 0, 0, 0, 0, 0, 0, 0, 18, 18, 0, 18, 0, 0, 0, 0},
+        {4800, 2400,  1000.0/2400,          prefetch_size/2, 8, 12, 2, 40, 39, 39, 38, 77, 116, 18, 6, 24, 72, 8, 12, 0, 0, 0, 0, 0, 0, 0, 18, 18, 0, 18, 0, 0, 0, 0},
+        {4800, 2400,  1000.0/2400,          prefetch_size/2, 8, 12, 2, 42, 42, 42, 40, 77, 119, 18, 6, 24, 72, 8, 12, 0, 0, 0, 0, 0, 0, 0, 18, 18, 0, 18, 0, 0, 0, 0}
+        //rate, freq, tCK,                    nBL,         nCCDS nCCDL nRTRS nCL nRCD nRP nCWL nRAS nRC nRTP nWTRS nWTRL nWR nRRDS nRRDL nFAW nRFC nRFCsb nREFI nREFSBRD nRFM nRFMsb nPD nXP nXPDLL nCKESR nXS nXSDLL
+    }, speed_entry;
+
+    int read_latency;
+
+    float act_nack_interval_ns = 0;
+
+    void init_speed();
+    void init_timing(bool per_bank_refresh = false);
+    void init_prereq();
+
+private:
+    void init_lambda();
+    void init_rowhit();
+    void init_rowopen();
+    void init_refresh_mode(bool same_bank_refresh);
+
+    uint32_t _sa_size = 0;
+
+};
+
+} /*namespace ramulator*/
+
+#endif /*__DDR5_H*/
@@ -181,6 +181,11 @@ private:
     // Helper Functions
     void update_state(typename T::Command cmd, const int* addr, long clk);
     void update_timing(typename T::Command cmd, const int* addr, long clk);
+
+    // A negative child id above the scope level of a command addresses all of my children
+    bool is_broadcast(typename T::Command cmd, int child_id) const {
+        return child_id < 0 && int(level) < int(spec->scope[int(cmd)]) && children.size();
+    }
     
 }; /* class DRAM */
 
@@ -295,7 +300,7 @@ DRAM<T>::DRAM(T* spec, typename T::Level level) :
         children.push_back(child);
     }
 
-    is_DDR4 = spec->standard_name == "DDR4";
+    is_DDR4 = spec->standard_name == "DDR4" || spec->standard_name == "DDR5" || spec->standard_name == "HBM"; // DDR5 and HBM have the same bank/subarray organization
     is_LPDDR4 = spec->standard_name == "LPDDR4";
 
 }
@@ -353,6 +358,16 @@ typename T::Command DRAM<T>::decode(typename T::Command cmd, const int* addr) {
         }
     }
 
+    if (is_broadcast(cmd, child_id)) {
+        // decode at every child, e.g., DDR5 same-bank commands target the same bank of all bank groups
+        for (auto child : children) {
+            typename T::Command child_cmd = child->decode(cmd, addr);
+            if (child_cmd != cmd)
+                return child_cmd;
+        }
+        return cmd;
+    }
+
     if (child_id < 0 || !children.size())
     {
         //printf("No prereq at any level\n");
@@ -406,6 +421,13 @@ bool DRAM<T>::check(typename T::Command cmd, const int* addr, long clk)
         return false; // stop recursion: the check failed at this level
 
     int child_id = addr[int(level)+1];
+    if (is_broadcast(cmd, child_id)) {
+        for (auto child : children)
+            if (!child->check(cmd, addr, clk))
+                return false;
+        return true;
+    }
+
     if (child_id < 0 || level == spec->scope[int(cmd)] || !children.size())
         return true; // stop recursion: the check passed at all levels
 
@@ -617,6 +639,12 @@ void DRAM<T>::update_state(typename T::Command cmd, const int* addr, long clk)
         return; // stop recursion: updated all levels
     }
 
+    if (is_broadcast(cmd, child_id)) {
+        for (auto child : children)
+            child->update_state(cmd, addr, clk);
+        return;
+    }
+
     // recursively update my child
     children[child_id]->update_state(cmd, addr, clk);
 }
@@ -632,7 +660,7 @@ template <typename T>
 void DRAM<T>::update_timing(typename T::Command cmd, const int* addr, long clk)
 {
     // I am not a target node: I am merely one of its siblings
-    if (id != addr[int(level)]) {
+    if (id != addr[int(level)] && !(parent && parent->is_broadcast(cmd, addr[int(level)]))) {
         for (auto& t : timing[int(cmd)]) {
             if (!t.sibling)
                 continue; // not an applicable timing parameter
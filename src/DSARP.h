@@ -177,7 +177,9 @@ public:
     /* Translate */
     Command translate[int(Request::Type::MAX)] = {
         Command::RD,  Command::WR,
-        Command::REF, Command::PDE, Command::SRE
+        Command::REF, Command::PDE, Command::SRE,
+        Command::RD, Command::RD, // PARA_REFRESH, RAIDR_REFRESH
+        Command::MAX, Command::RD // EXTENSION (unused), PREFETCH
     };
 
     /* Prerequisite */
@@ -7,6 +7,7 @@
 #include "Memory.h"
 #include "DDR3.h"
 #include "DDR4.h"
+#include "DDR5.h"
 #include "LPDDR3.h"
 #include "LPDDR4.h"
 #include "GDDR5.h"
@@ -18,7 +19,7 @@
 using namespace ramulator;
 
 static map<string, function<MemoryBase *(const Config&, int)> > name_to_func = {
-    {"DDR3", &MemoryFactory<DDR3>::create}, {"DDR4", &MemoryFactory<DDR4>::create},
+    {"DDR3", &MemoryFactory<DDR3>::create}, {"DDR4", &MemoryFactory<DDR4>::create}, {"DDR5", &MemoryFactory<DDR5>::create},
     {"LPDDR3", &MemoryFactory<LPDDR3>::create}, {"LPDDR4", &MemoryFactory<LPDDR4>::create},
     {"GDDR5", &MemoryFactory<GDDR5>::create}, 
     {"WideIO", &MemoryFactory<WideIO>::create}, {"WideIO2", &MemoryFactory<WideIO2>::create},
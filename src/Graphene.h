@@ -25,7 +25,12 @@ namespace ramulator
      */
     void schedule_preventive_refresh(const std::vector<int> addr_vec);
     void tick();
-    void update(typename T::Command cmd, const std::vector<int> &addr_vec, uint64_t open_for_nclocks);
+    /**
+     * @brief: Counts an ACT to addr_vec. With rowpress, also counts the time a closing command's row
+     * was open beyond tRAS as additional activations. Returns true if a preventive refresh is scheduled
+     */
+    bool update(typename T::Command cmd, const std::vector<int> &addr_vec, uint64_t open_for_nclocks);
+    bool is_rowpress_enabled() const { return rowpress; }
     
     std::string to_string()
     {
@@ -48,8 +53,8 @@ namespace ramulator
     int no_banks; // b per bg
     int no_bank_groups; // bg per rank
     int no_ranks;
-    bool pending_preventive_refresh = false;
-    std::vector<int> last_addr_vec;
+    // aggressors whose victims are refreshed in the next tick. A closing command can close multiple rows that exceed the threshold
+    std::vector<std::vector<int>> pending_preventive_refreshes;
     // per bank activation count table
     // indexed using rank id, bank id
     // e.g., if rank 0, bank 4, index is 4
@@ -60,8 +65,10 @@ namespace ramulator
 
     // take rowpress into account
     bool rowpress = false;
-    int rowpress_increment_nticks = 0;
+    int rowpress_increment_nticks = 0; // every this many cycles a row stays open beyond tRAS count as one more activation
     int nRAS = 0;
+
+    int get_rowpress_increment(uint64_t open_for_nclocks) const;
   };
 
   template <class T>
@@ -74,10 +81,19 @@ namespace ramulator
     debug_verbose = config.get_bool("graphene_debug_verbose");
     rowpress = config.get_bool("graphene_rowpress");
     rowpress_increment_nticks = config.get_uint("graphene_rowpress_increment_nticks");
-    nRAS = 0;
+    nRAS = ctrl->channel->spec->speed_entry.nRAS;
     reset_period_clk = (int) (reset_period / ((float) ctrl->channel->spec->speed_entry.tCK));
 
-    assert(!rowpress);
+    // the spillover counter stays below the threshold only if the table has enough entries for the ACTs a bank
+    // can receive within a reset period. Otherwise, every ACT to a new row exceeds the threshold, and so do the
+    // ACTs of the preventive refreshes it triggers
+    if (config.get_bool("enable_graphene"))
+      assert((long) (no_table_entries + 1) * activation_threshold > reset_period_clk / ctrl->channel->spec->speed_entry.nRC &&
+          "ERROR: Graphene needs more than (reset period / tRC) / activation threshold - 1 table entries.");
+
+    // by default, keeping a row open for another tRAS is as disturbing as activating it once more
+    if (rowpress_increment_nticks == 0)
+      rowpress_increment_nticks = nRAS;
 
     // Get organization configuration
     no_rows_per_bank = ctrl->channel->spec->org_entry.count[int(T::Level::Row)] * ctrl->channel->spec->org_entry.count[int(T::Level::Subarray)];
@@ -141,11 +157,9 @@ namespace ramulator
   template <class T>
   void Graphene<T>::tick()
   {
-    if (pending_preventive_refresh)
-    {
-      schedule_preventive_refresh(last_addr_vec);
-      pending_preventive_refresh = false;
-    }
+    for (auto& aggressor_addr_vec : pending_preventive_refreshes)
+      schedule_preventive_refresh(aggressor_addr_vec);
+    pending_preventive_refreshes.clear();
 
     // reset activation count table every reset_period
     // by setting every element to 0
@@ -164,10 +178,25 @@ namespace ramulator
   }
 
   template <class T>
-  void Graphene<T>::update(typename T::Command cmd, const std::vector<int> &addr_vec, uint64_t open_for_nclocks)
+  int Graphene<T>::get_rowpress_increment(uint64_t open_for_nclocks) const
   {
-    if (cmd != T::Command::ACT)
-      return;
+    if (open_for_nclocks <= (uint64_t) nRAS)
+      return 0;
+
+    return (open_for_nclocks - nRAS + rowpress_increment_nticks - 1) / rowpress_increment_nticks;
+  }
+
+  template <class T>
+  bool Graphene<T>::update(typename T::Command cmd, const std::vector<int> &addr_vec, uint64_t open_for_nclocks)
+  {
+    int increment = 0;
+    if (cmd == T::Command::ACT)
+      increment = 1;
+    else if (rowpress && ctrl->channel->spec->is_closing(cmd))
+      increment = get_rowpress_increment(open_for_nclocks);
+
+    if (increment == 0)
+      return false;
     
     int bank_group_id = addr_vec[int(T::Level::BankGroup)];
     int bank_id = addr_vec[int(T::Level::Bank)];
@@ -221,41 +250,41 @@ namespace ramulator
         }
         // remove to_remove from the table
         activation_count_table[index].erase(to_remove);
-        // add row_id to the table
-        activation_count_table[index][row_id] = spillover_value;
+        // add row_id to the table, counting this activation on top of the spillover value
+        activation_count_table[index][row_id] = spillover_value + increment;
       }
       // if we did not find such an entry, increment spillover counter by one
       else
       {
-        int increment = rowpress ? ((open_for_nclocks - nRAS + rowpress_increment_nticks)/rowpress_increment_nticks) + 1 
-                                  : 1;
         spillover_counter[index] += increment;
+        return false;
       }
     }
     else
     {
       // if row in table, increment its activation count
-      activation_count_table[index][row_id] += rowpress ? ((open_for_nclocks - nRAS + rowpress_increment_nticks)/rowpress_increment_nticks) + 1 
-                                                        : 1;
-      
-      if (debug_verbose)
-      {
-        std::cout << "Row " << row_id << " in table[" << index << "]" << std::endl;
-        std::cout << "  └  " << "threshold: " << activation_threshold << std::endl;
-        std::cout << "  └  " << "count: " << activation_count_table[index][row_id] << std::endl;
-      }
+      activation_count_table[index][row_id] += increment;
+    }
 
-      // check if the count exceeds the threshold
-      if (activation_count_table[index][row_id] >= activation_threshold)
-      {
-        if (debug)
-          std::cout << "Row " << row_id << " in table " << index << " has exceeded the threshold!" << std::endl;
-        // if yes, schedule preventive refreshes
-        pending_preventive_refresh = true;
-        last_addr_vec = addr_vec;
-        activation_count_table[index][row_id] = spillover_counter[index];
-      }
+    if (debug_verbose)
+    {
+      std::cout << "Row " << row_id << " in table[" << index << "]" << std::endl;
+      std::cout << "  └  " << "threshold: " << activation_threshold << std::endl;
+      std::cout << "  └  " << "count: " << activation_count_table[index][row_id] << std::endl;
     }
+
+    // check if the count exceeds the threshold
+    if (activation_count_table[index][row_id] >= activation_threshold)
+    {
+      if (debug)
+        std::cout << "Row " << row_id << " in table " << index << " has exceeded the threshold!" << std::endl;
+      // if yes, schedule preventive refreshes
+      pending_preventive_refreshes.push_back(addr_vec);
+      activation_count_table[index][row_id] = spillover_counter[index];
+      return true;
+    }
+
+    return false;
   }
 }
 #endif
\ No newline at end of file
@@ -38,6 +38,10 @@ HBM::HBM(const string& org_str, const string& speed_str) :
 {
 }
 
+HBM::HBM(const Config& configs) : HBM(org_map[configs["org"]], speed_map[configs["speed"]]){
+    act_nack_interval_ns = configs.get_float("smd_act_nack_resend_interval");
+}
+
 void HBM::set_channel_number(int channel) {
   org_entry.count[int(Level::Channel)] = channel;
 }
@@ -47,7 +51,12 @@ void HBM::set_rank_number(int rank) {
 }
 
 void HBM::set_subarray_size(uint32_t sa_size) {
+    uint rows_per_bank = org_entry.count[int(Level::Subarray)] * org_entry.count[int(Level::Row)];
     _sa_size = sa_size;
+
+    assert((rows_per_bank % _sa_size == 0) && "ERROR: Rows per bank must be multiple of subarray size. Make sure you set the subarray size properly.");
+    org_entry.count[int(Level::Subarray)] = rows_per_bank/_sa_size;
+    org_entry.count[int(Level::Row)] = _sa_size;
 }
 
 void HBM::init_speed()
@@ -55,6 +64,9 @@ void HBM::init_speed()
     const static int RFC_TABLE[int(Speed::MAX)][int(Org::MAX)] = {
         {55, 80, 130}
     };
+    const static int REFI_TABLE[int(Speed::MAX)] = {
+        1950
+    };
     const static int REFI1B_TABLE[int(Speed::MAX)][int(Org::MAX)] = {
         {64, 128, 256}
     };
@@ -74,8 +86,11 @@ void HBM::init_speed()
         default: assert(false);
     }
     speed_entry.nRFC = RFC_TABLE[speed][density];
+    speed_entry.nREFI = REFI_TABLE[speed]; // reset here since the controller scales nREFI after every init_speed()
     speed_entry.nREFI1B = REFI1B_TABLE[speed][density];
     speed_entry.nXS = XS_TABLE[speed][density];
+
+    speed_entry.nNACK_RESEND = ceil(act_nack_interval_ns/speed_entry.tCK);
 }
 
 
@@ -90,19 +105,41 @@ void HBM::init_prereq()
             case int(State::SelfRefresh): return Command::SRX;
             default: assert(false);
         }};
+
+
     prereq[int(Level::Bank)][int(Command::RD)] = [] (DRAM<HBM>* node, Command cmd, int id) {
         switch (int(node->state)) {
             case int(State::Closed): return Command::ACT;
+            case int(State::Opened):
+                if (node->row_state.find(id) != node->row_state.end())
+                    return Command::MAX; // the correct SA is open (or partially open) but is the correct row open? Checked in the function below
+                else return Command::PRE; 
+            case int(State::PartiallyOpened):
+                if (node->row_state.find(id) != node->row_state.end())
+                    return Command::MAX; // the correct SA is open (or partially open) but is the correct row open? Checked in the function below
+                else return Command::NOP;
+            default: assert(false);
+        }};
+
+    prereq[int(Level::Subarray)][int(Command::RD)] = [] (DRAM<HBM>* node, Command cmd, int id) {
+        switch (int(node->state)) {
+            case int(State::Closed): return Command::PRE; // the target bank is active but not the target subarray (meaning another subarray is active) so need to precharge
+            case int(State::PartiallyOpened): {
+                if (node->row_state.find(id) != node->row_state.end())
+                    return Command::ACT; // the target row is partially open, try fully opening it
+                else return Command::PRE;
+            }
             case int(State::Opened):
                 if (node->row_state.find(id) != node->row_state.end())
                     return cmd;
                 else return Command::PRE;
             default: assert(false);
         }};
-
+    
     // WR
     prereq[int(Level::Rank)][int(Command::WR)] = prereq[int(Level::Rank)][int(Command::RD)];
     prereq[int(Level::Bank)][int(Command::WR)] = prereq[int(Level::Bank)][int(Command::RD)];
+    prereq[int(Level::Subarray)][int(Command::WR)] = prereq[int(Level::Subarray)][int(Command::RD)];
 
     // REF
     prereq[int(Level::Rank)][int(Command::REF)] = [] (DRAM<HBM>* node, Command cmd, int id) {
@@ -114,9 +151,10 @@ void HBM::init_prereq()
             }
         return Command::REF;};
 
-    // REFSB
-    prereq[int(Level::Bank)][int(Command::REFSB)] = [] (DRAM<HBM>* node, Command cmd, int id) {
-        if (node->state == State::Closed) return Command::REFSB;
+    // REF - used when per_bank_refresh_on
+    prereq[int(Level::Bank)][int(Command::REF)] = [] (DRAM<HBM>* node, Command cmd, int id) {
+        if (node->state == State::Closed)
+            return Command::REF;
         return Command::PRE;};
 
     // PD
@@ -144,8 +182,9 @@ void HBM::init_prereq()
 void HBM::init_rowhit()
 {
     // RD
-    rowhit[int(Level::Bank)][int(Command::RD)] = [] (DRAM<HBM>* node, Command cmd, int id) {
+    rowhit[int(Level::Subarray)][int(Command::RD)] = [] (DRAM<HBM>* node, Command cmd, int id) {
         switch (int(node->state)) {
+            case int(State::PartiallyOpened):
             case int(State::Closed): return false;
             case int(State::Opened):
                 if (node->row_state.find(id) != node->row_state.end())
@@ -155,7 +194,7 @@ void HBM::init_rowhit()
         }};
 
     // WR
-    rowhit[int(Level::Bank)][int(Command::WR)] = rowhit[int(Level::Bank)][int(Command::RD)];
+    rowhit[int(Level::Subarray)][int(Command::WR)] = rowhit[int(Level::Subarray)][int(Command::RD)];
 }
 
 void HBM::init_rowopen()
@@ -163,6 +202,7 @@ void HBM::init_rowopen()
     // RD
     rowopen[int(Level::Bank)][int(Command::RD)] = [] (DRAM<HBM>* node, Command cmd, int id) {
         switch (int(node->state)) {
+            case int(State::PartiallyOpened):
             case int(State::Closed): return false;
             case int(State::Opened): return true;
             default: assert(false);
@@ -175,26 +215,104 @@ void HBM::init_rowopen()
 void HBM::init_lambda()
 {
     lambda[int(Level::Bank)][int(Command::ACT)] = [] (DRAM<HBM>* node, int id) {
+        node->state = State::Opened;
+        node->just_opened = true;
+        node->row_state[id] = State::Opened;};
+    
+    lambda[int(Level::Subarray)][int(Command::ACT)] = [] (DRAM<HBM>* node, int id) {
         node->state = State::Opened;
         node->row_state[id] = State::Opened;};
+
+
     lambda[int(Level::Bank)][int(Command::PRE)] = [] (DRAM<HBM>* node, int id) {
+        assert(node->state == State::Opened || node->state == State::PartiallyOpened);
+        assert(node->row_state.begin() != node->row_state.end());
+        auto open_SA = node->children[node->row_state.begin()->first];
+        assert(open_SA->state == State::Opened || open_SA->state == State::PartiallyOpened);
+
+        node->collect_opened_cycles(node->cur_clk);
+        open_SA->state = State::Closed;
         node->state = State::Closed;
+        open_SA->row_state.clear();
         node->row_state.clear();};
+
+
+    lambda[int(Level::Bank)][int(Command::ACT_NACK)] = [] (DRAM<HBM>* node, int id) {
+        assert(node->state == State::Opened);
+        assert(node->row_state.begin() != node->row_state.end());
+        auto open_SA = node->children[node->row_state.begin()->first];
+        assert(open_SA->state == State::Opened);
+
+        open_SA->state = State::Closed;
+        node->state = State::Closed;
+        open_SA->row_state.clear();
+        node->row_state.clear();};
+
+    lambda[int(Level::Bank)][int(Command::ACT_PARTIAL_NACK)] = [] (DRAM<HBM>* node, int id) {
+        assert(node->state == State::Opened);
+        assert(node->row_state.begin() != node->row_state.end());
+        auto open_SA = node->children[node->row_state.begin()->first];
+        assert(open_SA->state == State::Opened);
+
+        open_SA->state = State::PartiallyOpened;
+        node->state = State::PartiallyOpened;
+    };
+
+    lambda[int(Level::Bank)][int(Command::PRE_RSQ)] = [this] (DRAM<HBM>* node, int id) {
+        lambda[int(Level::Bank)][int(Command::PRE)](node, id);
+        };
+    lambda[int(Level::Bank)][int(Command::RSQ)] = [] (DRAM<HBM>* node, int id) {};
+
     lambda[int(Level::Rank)][int(Command::PREA)] = [] (DRAM<HBM>* node, int id) {
         for (auto bg : node->children)
             for (auto bank : bg->children) {
+                if(bank->state == State::Opened) {
+                    bank->collect_opened_cycles(node->cur_clk);
+
+                    if (bank->row_state.begin() != bank->row_state.end()) {
+                        auto open_SA = bank->children[bank->row_state.begin()->first];
+                        assert(open_SA->state == State::Opened);
+
+                        open_SA->state = State::Closed;
+                        open_SA->row_state.clear();
+                    }       
+                }
                 bank->state = State::Closed;
                 bank->row_state.clear();
             }};
     lambda[int(Level::Rank)][int(Command::REF)] = [] (DRAM<HBM>* node, int id) {};
-    lambda[int(Level::Bank)][int(Command::RD)] = [] (DRAM<HBM>* node, int id) {};
-    lambda[int(Level::Bank)][int(Command::WR)] = [] (DRAM<HBM>* node, int id) {};
+    lambda[int(Level::Bank)][int(Command::RD)] = [] (DRAM<HBM>* node, int id) {
+        node->just_opened = false;
+    };
+    lambda[int(Level::Bank)][int(Command::WR)] = [] (DRAM<HBM>* node, int id) {
+        node->just_opened = false;
+    };
     lambda[int(Level::Bank)][int(Command::RDA)] = [] (DRAM<HBM>* node, int id) {
+        assert(node->state == State::Opened);
+        node->just_opened = false;
+        node->collect_opened_cycles(node->cur_clk);
         node->state = State::Closed;
-        node->row_state.clear();};
+
+        assert(node->row_state.begin() != node->row_state.end());
+        auto open_SA = node->children[node->row_state.begin()->first];
+        assert(open_SA->state == State::Opened);
+        open_SA->state = State::Closed;
+        open_SA->row_state.clear();
+        node->row_state.clear();
+        };
     lambda[int(Level::Bank)][int(Command::WRA)] = [] (DRAM<HBM>* node, int id) {
+        assert(node->state == State::Opened);
+        node->just_opened = false;
+        node->collect_opened_cycles(node->cur_clk);
         node->state = State::Closed;
-        node->row_state.clear();};
+
+        assert(node->row_state.begin() != node->row_state.end());
+        auto open_SA = node->children[node->row_state.begin()->first];
+        assert(open_SA->state == State::Opened);
+        open_SA->state = State::Closed;
+        open_SA->row_state.clear();
+        node->row_state.clear();
+        };
     lambda[int(Level::Rank)][int(Command::PDE)] = [] (DRAM<HBM>* node, int id) {
         for (auto bg : node->children)
             for (auto bank : bg->children) {
@@ -213,12 +331,19 @@ void HBM::init_lambda()
 }
 
 
-void HBM::init_timing()
+void HBM::init_timing(bool per_bank_refresh)
 {
+    // clear current timing entries
+    for (auto& v : timing){
+        for (auto& v2 : v){
+            v2.clear();
+        }
+    }
+    
     SpeedEntry& s = speed_entry;
     vector<TimingEntry> *t;
 
-    /*** Channel ***/
+    /*** Channel ***/ 
     t = timing[int(Level::Channel)];
 
     // CAS <-> CAS
@@ -231,8 +356,26 @@ void HBM::init_timing()
     t[int(Command::WRA)].push_back({Command::WR, 1, s.nBL});
     t[int(Command::WRA)].push_back({Command::WRA, 1, s.nBL});
 
-
-    /*** Rank ***/
+    t[int(Command::PRE_RSQ)].push_back({Command::RD, 1, s.nBL});
+    t[int(Command::PRE_RSQ)].push_back({Command::RDA, 1, s.nBL});
+    t[int(Command::PRE_RSQ)].push_back({Command::WR, 1, s.nBL});
+    t[int(Command::PRE_RSQ)].push_back({Command::WRA, 1, s.nBL});
+    t[int(Command::RSQ)].push_back({Command::RD, 1, s.nBL});
+    t[int(Command::RSQ)].push_back({Command::RDA, 1, s.nBL});
+    t[int(Command::RSQ)].push_back({Command::WR, 1, s.nBL});
+    t[int(Command::RSQ)].push_back({Command::WRA, 1, s.nBL});
+
+    t[int(Command::RD)].push_back({Command::PRE_RSQ, 1, s.nBL});
+    t[int(Command::RDA)].push_back({Command::PRE_RSQ, 1, s.nBL});
+    t[int(Command::WR)].push_back({Command::PRE_RSQ, 1, s.nBL});
+    t[int(Command::WRA)].push_back({Command::PRE_RSQ, 1, s.nBL});
+    t[int(Command::RD)].push_back({Command::RSQ, 1, s.nBL});
+    t[int(Command::RDA)].push_back({Command::RSQ, 1, s.nBL});
+    t[int(Command::WR)].push_back({Command::RSQ, 1, s.nBL});
+    t[int(Command::WRA)].push_back({Command::RSQ, 1, s.nBL});
+
+
+    /*** Rank ***/ 
     t = timing[int(Level::Rank)];
 
     // CAS <-> CAS
@@ -253,6 +396,26 @@ void HBM::init_timing()
     t[int(Command::WRA)].push_back({Command::RD, 1, s.nCWL + s.nBL + s.nWTRS});
     t[int(Command::WRA)].push_back({Command::RDA, 1, s.nCWL + s.nBL + s.nWTRS});
 
+    t[int(Command::PRE_RSQ)].push_back({Command::RD, 1, s.nCCDS});
+    t[int(Command::PRE_RSQ)].push_back({Command::RDA, 1, s.nCCDS});
+    t[int(Command::RD)].push_back({Command::PRE_RSQ, 1, s.nCCDS});
+    t[int(Command::RDA)].push_back({Command::PRE_RSQ, 1, s.nCCDS});
+    t[int(Command::PRE_RSQ)].push_back({Command::WR, 1, s.nCCDS});
+    t[int(Command::PRE_RSQ)].push_back({Command::WRA, 1, s.nCCDS});
+    t[int(Command::WR)].push_back({Command::PRE_RSQ, 1, s.nCCDS});
+    t[int(Command::WRA)].push_back({Command::PRE_RSQ, 1, s.nCCDS});
+
+    t[int(Command::RSQ)].push_back({Command::RD, 1, s.nCCDS});
+    t[int(Command::RSQ)].push_back({Command::RDA, 1, s.nCCDS});
+    t[int(Command::RD)].push_back({Command::RSQ, 1, s.nCCDS});
+    t[int(Command::RDA)].push_back({Command::RSQ, 1, s.nCCDS});
+    t[int(Command::RSQ)].push_back({Command::WR, 1, s.nCCDS});
+    t[int(Command::RSQ)].push_back({Command::WRA, 1, s.nCCDS});
+    t[int(Command::WR)].push_back({Command::RSQ, 1, s.nCCDS});
+    t[int(Command::WRA)].push_back({Command::RSQ, 1, s.nCCDS});
+
+
+
     t[int(Command::RD)].push_back({Command::PREA, 1, s.nRTP});
     t[int(Command::WR)].push_back({Command::PREA, 1, s.nCWL + s.nBL + s.nWR});
 
@@ -265,7 +428,7 @@ void HBM::init_timing()
     t[int(Command::PDX)].push_back({Command::RDA, 1, s.nXP});
     t[int(Command::PDX)].push_back({Command::WR, 1, s.nXP});
     t[int(Command::PDX)].push_back({Command::WRA, 1, s.nXP});
-
+    
     // CAS <-> SR: none (all banks have to be precharged)
 
     // RAS <-> RAS
@@ -274,10 +437,16 @@ void HBM::init_timing()
     t[int(Command::ACT)].push_back({Command::PREA, 1, s.nRAS});
     t[int(Command::PREA)].push_back({Command::ACT, 1, s.nRP});
 
+    t[int(Command::ACT_PARTIAL_NACK)].push_back({Command::PREA, 1, s.nRAS - s.nACTtoNACK});
+
     // RAS <-> REF
-    t[int(Command::PRE)].push_back({Command::REF, 1, s.nRP});
-    t[int(Command::PREA)].push_back({Command::REF, 1, s.nRP});
-    t[int(Command::REF)].push_back({Command::ACT, 1, s.nRFC});
+    if(!per_bank_refresh) {
+        t[int(Command::PRE)].push_back({Command::REF, 1, s.nRP});
+        t[int(Command::PREA)].push_back({Command::REF, 1, s.nRP});
+        t[int(Command::REF)].push_back({Command::ACT, 1, s.nRFC});
+
+        t[int(Command::PRE_RSQ)].push_back({Command::REF, 1, s.nRP});
+    }
 
     // RAS <-> PD
     t[int(Command::ACT)].push_back({Command::PDE, 1, 1});
@@ -291,7 +460,8 @@ void HBM::init_timing()
     t[int(Command::SRX)].push_back({Command::ACT, 1, s.nXS});
 
     // REF <-> REF
-    t[int(Command::REF)].push_back({Command::REF, 1, s.nRFC});
+    if(!per_bank_refresh)
+        t[int(Command::REF)].push_back({Command::REF, 1, s.nRFC});
 
     // REF <-> PD
     t[int(Command::REF)].push_back({Command::PDE, 1, 1});
@@ -299,7 +469,7 @@ void HBM::init_timing()
 
     // REF <-> SR
     t[int(Command::SRX)].push_back({Command::REF, 1, s.nXS});
-
+    
     // PD <-> PD
     t[int(Command::PDE)].push_back({Command::PDX, 1, s.nPD});
     t[int(Command::PDX)].push_back({Command::PDE, 1, s.nXP});
@@ -307,12 +477,12 @@ void HBM::init_timing()
     // PD <-> SR
     t[int(Command::PDX)].push_back({Command::SRE, 1, s.nXP});
     t[int(Command::SRX)].push_back({Command::PDE, 1, s.nXS});
-
+    
     // SR <-> SR
     t[int(Command::SRE)].push_back({Command::SRX, 1, s.nCKESR});
     t[int(Command::SRX)].push_back({Command::SRE, 1, s.nXS});
 
-    /*** Bank Group ***/
+    /*** Bank Group ***/ 
     t = timing[int(Level::BankGroup)];
     // CAS <-> CAS
     t[int(Command::RD)].push_back({Command::RD, 1, s.nCCDL});
@@ -332,10 +502,11 @@ void HBM::init_timing()
     t[int(Command::WRA)].push_back({Command::RD, 1, s.nCWL + s.nBL + s.nWTRL});
     t[int(Command::WRA)].push_back({Command::RDA, 1, s.nCWL + s.nBL + s.nWTRL});
 
+
     // RAS <-> RAS
     t[int(Command::ACT)].push_back({Command::ACT, 1, s.nRRDL});
 
-    /*** Bank ***/
+    /*** Bank ***/ 
     t = timing[int(Level::Bank)];
 
     // CAS <-> RAS
@@ -351,12 +522,29 @@ void HBM::init_timing()
     t[int(Command::WRA)].push_back({Command::ACT, 1, s.nCWL + s.nBL + s.nWR + s.nRP});
 
     // RAS <-> RAS
-    t[int(Command::ACT)].push_back({Command::ACT, 1, s.nRC});
+    // ACT -> ACT (tRC) is already enforced by tRAS and tRP, and it would delay an ACT that follows an ACT_NACK
     t[int(Command::ACT)].push_back({Command::PRE, 1, s.nRAS});
     t[int(Command::PRE)].push_back({Command::ACT, 1, s.nRP});
 
-    // REFSB
-    t[int(Command::PRE)].push_back({Command::REFSB, 1, s.nRP});
-    t[int(Command::REFSB)].push_back({Command::REFSB, 1, s.nRFC});
-    t[int(Command::REFSB)].push_back({Command::ACT, 1, s.nRFC});
+    t[int(Command::ACT)].push_back({Command::PRE_RSQ, 1, s.nRAS});
+    t[int(Command::PRE_RSQ)].push_back({Command::ACT, 1, s.nRP});
+
+    t[int(Command::ACT_PARTIAL_NACK)].push_back({Command::PRE, 1, s.nRAS - s.nACTtoNACK});
+
+    if(per_bank_refresh) {
+        t[int(Command::PRE)].push_back({Command::REF, 1, s.nRP});
+        t[int(Command::PREA)].push_back({Command::REF, 1, s.nRP});
+        t[int(Command::REF)].push_back({Command::ACT, 1, s.nRFC});
+
+        t[int(Command::PRE_RSQ)].push_back({Command::REF, 1, s.nRP});
+
+        t[int(Command::REF)].push_back({Command::REF, 1, s.nRFC});
+    }
+
+
+    /*** Subarray ***/ 
+    t = timing[int(Level::Subarray)];
+
+    t[int(Command::ACT_NACK)].push_back({Command::ACT, 1, s.nNACK_RESEND});
+    t[int(Command::ACT_PARTIAL_NACK)].push_back({Command::ACT, 1, s.nNACK_RESEND});
 }
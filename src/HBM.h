@@ -3,6 +3,7 @@
 
 #include "DRAM.h"
 #include "Request.h"
+#include "Config.h"
 #include <vector>
 #include <functional>
 
@@ -19,6 +20,7 @@ public:
     enum class Speed;
     HBM(Org org, Speed speed);
     HBM(const string& org_str, const string& speed_str);
+    HBM(const Config& configs);
 
     static map<string, enum Org> org_map;
     static map<string, enum Speed> speed_map;
@@ -26,7 +28,7 @@ public:
     /* Level */
     enum class Level : int
     {
-        Channel, Rank, BankGroup, Bank, Row, Column, MAX
+        Channel, Rank, BankGroup, Bank, Subarray, Row, Column, MAX
     };
 
     /* Command */
@@ -34,24 +36,26 @@ public:
     {
         ACT, PRE,   PREA,
         RD,  WR,    RDA, WRA,
-        REF, REFSB, PDE, PDX,  SRE, SRX,
+        REF, PDE, PDX,  SRE, SRX,
+        PRE_RSQ, RSQ, ACT_NACK, ACT_PARTIAL_NACK, NOP,
         MAX
     };
 
-    // REFSB and REF is not compatible, choose one or the other.
-    // REFSB can be issued to banks in any order, as long as REFI1B
-    // is satisfied for all banks
+    // A single-bank REF (REFSB) is a REF with Bank scope (see per_bank_refresh in Controller).
+    // REFSB and REF are not compatible, so only one of them is used in a simulation
 
     string command_name[int(Command::MAX)] = {
         "ACT", "PRE",   "PREA",
         "RD",  "WR",    "RDA",  "WRA",
-        "REF", "REFSB", "PDE",  "PDX",  "SRE", "SRX"
+        "REF", "PDE",  "PDX",  "SRE", "SRX",
+        "PRE_RSQ", "RSQ", "ACT_NACK", "ACT_PARTIAL_NACK", "NOP"
     };
 
     Level scope[int(Command::MAX)] = {
         Level::Row,    Level::Bank,   Level::Rank,
         Level::Column, Level::Column, Level::Column, Level::Column,
-        Level::Rank,   Level::Bank,   Level::Rank,   Level::Rank,   Level::Rank,   Level::Rank
+        Level::Rank,   Level::Rank,   Level::Rank,   Level::Rank,   Level::Rank,
+        Level::Bank,   Level::Rank,   Level::Subarray, Level::Subarray, Level::Subarray
     };
 
     bool is_opening(Command cmd)
@@ -84,6 +88,8 @@ public:
             case int(Command::WRA):
             case int(Command::PRE):
             case int(Command::PREA):
+            case int(Command::PRE_RSQ):
+            case int(Command::ACT_NACK):
                 return true;
             default:
                 return false;
@@ -94,13 +100,14 @@ public:
     {
         switch(int(cmd)) {
             case int(Command::REF):
-            case int(Command::REFSB):
                 return true;
             default:
                 return false;
         }
     }
 
+    void mult_refresh_pb(float mult) {};
+
     Command add_autoprecharge (const Command cmd) {
         switch(int(cmd)) {
             case int(Command::RD):
@@ -116,11 +123,15 @@ public:
     }
     
 
+    // calculates a single bank id within a rank based on the bank group ID and bank ID
     uint32_t calc_global_bank_id(const std::vector<int> addr_vec) const {
-        uint32_t banks_per_rank = org_entry.count[uint32_t(Level::BankGroup)] * org_entry.count[uint32_t(Level::Bank)];
         uint32_t banks_per_bg = org_entry.count[uint32_t(Level::Bank)];
 
-        return addr_vec[uint32_t(Level::Rank)]*banks_per_rank + addr_vec[uint32_t(Level::BankGroup)]*banks_per_bg + addr_vec[uint32_t(Level::Bank)];
+        return addr_vec[uint32_t(Level::BankGroup)]*banks_per_bg + addr_vec[uint32_t(Level::Bank)];
+    }
+
+    uint32_t calc_row_id_in_bank(const std::vector<int> addr_vec) const {
+        return addr_vec[uint32_t(Level::Subarray)]*get_subarray_size() + addr_vec[uint32_t(Level::Row)];
     }
 
     uint32_t get_num_banks_per_rank() const {
@@ -134,15 +145,17 @@ public:
     /* State */
     enum class State : int
     {
-        Opened, Closed, PowerUp, ActPowerDown, PrePowerDown, SelfRefresh, MAX
+        Opened, Closed, PartiallyOpened, PowerUp, ActPowerDown, PrePowerDown, SelfRefresh, MAX
     } start[int(Level::MAX)] = {
-        State::MAX, State::PowerUp, State::MAX, State::Closed, State::Closed, State::MAX
+        State::MAX, State::PowerUp, State::MAX, State::Closed, State::Closed, State::Closed, State::MAX
     };
 
     /* Translate */
     Command translate[int(Request::Type::MAX)] = {
         Command::RD,  Command::WR,
-        Command::REF, Command::PDE, Command::SRE
+        Command::REF, Command::PDE, Command::SRE,
+        Command::RD, Command::RD, // PARA_REFRESH, RAIDR_REFRESH
+        Command::MAX, Command::RD // EXTENSION (unused), PREFETCH
     };
 
     /* Prereq */
@@ -180,9 +193,9 @@ public:
         int dq;
         int count[int(Level::MAX)];
     } org_table[int(Org::MAX)] = {
-        {1<<10, 128, {0, 0, 4, 2, 1<<13, 1<<(6+1)}},
-        {2<<10, 128, {0, 0, 4, 2, 1<<14, 1<<(6+1)}},
-        {4<<10, 128, {0, 0, 4, 4, 1<<14, 1<<(6+1)}},
+        {1<<10, 128, {0, 0, 4, 2, 1, 1<<13, 1<<(6+1)}},
+        {2<<10, 128, {0, 0, 4, 2, 1, 1<<14, 1<<(6+1)}},
+        {4<<10, 128, {0, 0, 4, 4, 1, 1<<14, 1<<(6+1)}},
     }, org_entry;
 
     void set_channel_number(int channel);
@@ -213,21 +226,25 @@ public:
         int nRFC, nREFI, nREFI1B;
         int nPD, nXP;
         int nCKESR, nXS;
+        int nNACK_RESEND, nACTtoNACK;
     } speed_table[int(Speed::MAX)] = {
-        {1000, 500, 2.0, 2, 2, 3, 7, 7, 6, 7, 4, 17, 24, 7, 2, 4, 8, 4, 5, 20, 0, 1950, 0, 5, 5, 5, 0}
+        {1000, 500, 2.0, 2, 2, 3, 7, 7, 6, 7, 4, 17, 24, 7, 2, 4, 8, 4, 5, 20, 0, 0, 0, 5, 5, 5, 0}
     }, speed_entry;
 
     int read_latency;
 
-private:
+    float act_nack_interval_ns = 0;
+
     void init_speed();
-    void init_lambda();
     void init_prereq();
+    void init_timing(bool per_bank_refresh = false);
+
+private:
+    void init_lambda();
     void init_rowhit();  // SAUGATA: added function to check for row hits
     void init_rowopen();
-    void init_timing();
 
-    uint32_t _sa_size;
+    uint32_t _sa_size = 0;
 };
 
 } /*namespace ramulator*/
@@ -49,6 +49,8 @@ LPDDR4::LPDDR4(const Config& configs) : LPDDR4(org_map[configs["org"]], speed_ma
    }
 
    printf("LPDDR4 Org: %s\n", configs["org"].c_str());
+
+   act_nack_interval_ns = configs.get_float("smd_act_nack_resend_interval");
 }
 
 void LPDDR4::set_channel_number(int channel) {
@@ -60,7 +62,12 @@ void LPDDR4::set_rank_number(int rank) {
 }
 
 void LPDDR4::set_subarray_size(uint32_t sa_size) {
+    uint rows_per_bank = org_entry.count[int(Level::Subarray)] * org_entry.count[int(Level::Row)];
     _sa_size = sa_size;
+
+    assert((rows_per_bank % _sa_size == 0) && "ERROR: Rows per bank must be multiple of subarray size. Make sure you set the subarray size properly.");
+    org_entry.count[int(Level::Subarray)] = rows_per_bank/_sa_size;
+    org_entry.count[int(Level::Row)] = _sa_size;
 }
 
 
@@ -121,6 +128,9 @@ void LPDDR4::init_speed()
     speed_entry.nRFCab = RFCAB_TABLE[density][speed];
     speed_entry.nREFI = REFI_TABLE[int(refresh_mode)][speed];
     speed_entry.nXSR = XSR_TABLE[density][speed];
+    speed_entry.nRFC = speed_entry.nRFCab;
+
+    speed_entry.nNACK_RESEND = ceil(act_nack_interval_ns/speed_entry.tCK);
 }
 
 
@@ -138,6 +148,23 @@ void LPDDR4::init_prereq()
     prereq[int(Level::Bank)][int(Command::RD)] = [] (DRAM<LPDDR4>* node, Command cmd, int id) {
         switch (int(node->state)) {
             case int(State::Closed): return Command::ACT;
+            case int(State::Opened):
+                if (node->row_state.find(id) != node->row_state.end())
+                    return Command::MAX; // the correct SA is open. Whether the correct row is open is checked at the Subarray level
+                return Command::PRE;
+            case int(State::PartiallyOpened):
+                if (node->row_state.find(id) != node->row_state.end())
+                    return Command::MAX;
+                return Command::NOP;
+            default: assert(false);
+        }};
+    prereq[int(Level::Subarray)][int(Command::RD)] = [] (DRAM<LPDDR4>* node, Command cmd, int id) {
+        switch (int(node->state)) {
+            case int(State::Closed): return Command::PRE; // another subarray of the bank is open
+            case int(State::PartiallyOpened):
+                if (node->row_state.find(id) != node->row_state.end())
+                    return Command::ACT; // the target row is partially open, try fully opening it
+                return Command::PRE;
             case int(State::Opened):
                 if (node->row_state.find(id) != node->row_state.end())
                     return cmd;
@@ -148,16 +175,24 @@ void LPDDR4::init_prereq()
     // WR
     prereq[int(Level::Rank)][int(Command::WR)] = prereq[int(Level::Rank)][int(Command::RD)];
     prereq[int(Level::Bank)][int(Command::WR)] = prereq[int(Level::Bank)][int(Command::RD)];
+    prereq[int(Level::Subarray)][int(Command::WR)] = prereq[int(Level::Subarray)][int(Command::RD)];
 
     // REF
     prereq[int(Level::Rank)][int(Command::REF)] = [] (DRAM<LPDDR4>* node, Command cmd, int id) {
-        for (auto bank : node->children) {
-            if (bank->state == State::Closed)
-                continue;
-            return Command::PREA;
-        }
+        for (auto bg : node->children)
+            for (auto bank : bg->children) {
+                if (bank->state == State::Closed)
+                    continue;
+                return Command::PREA;
+            }
         return Command::REF;};
 
+    // REF - used as REFpb when per_bank_refresh_on
+    prereq[int(Level::Bank)][int(Command::REF)] = [] (DRAM<LPDDR4>* node, Command cmd, int id) {
+        if (node->state == State::Closed)
+            return Command::REF;
+        return Command::PRE;};
+
     // PD
     prereq[int(Level::Rank)][int(Command::PDE)] = [] (DRAM<LPDDR4>* node, Command cmd, int id) {
         switch (int(node->state)) {
@@ -183,8 +218,9 @@ void LPDDR4::init_prereq()
 void LPDDR4::init_rowhit()
 {
     // RD
-    rowhit[int(Level::Bank)][int(Command::RD)] = [] (DRAM<LPDDR4>* node, Command cmd, int id) {
+    rowhit[int(Level::Subarray)][int(Command::RD)] = [] (DRAM<LPDDR4>* node, Command cmd, int id) {
         switch (int(node->state)) {
+            case int(State::PartiallyOpened):
             case int(State::Closed): return false;
             case int(State::Opened):
                 if (node->row_state.find(id) != node->row_state.end())
@@ -194,7 +230,7 @@ void LPDDR4::init_rowhit()
         }};
 
     // WR
-    rowhit[int(Level::Bank)][int(Command::WR)] = rowhit[int(Level::Bank)][int(Command::RD)];
+    rowhit[int(Level::Subarray)][int(Command::WR)] = rowhit[int(Level::Subarray)][int(Command::RD)];
 }
 
 void LPDDR4::init_rowopen()
@@ -202,6 +238,7 @@ void LPDDR4::init_rowopen()
     // RD
     rowopen[int(Level::Bank)][int(Command::RD)] = [] (DRAM<LPDDR4>* node, Command cmd, int id) {
         switch (int(node->state)) {
+            case int(State::PartiallyOpened):
             case int(State::Closed): return false;
             case int(State::Opened): return true;
             default: assert(false);
@@ -217,17 +254,56 @@ void LPDDR4::init_lambda()
         node->state = State::Opened;
 		node->just_opened = true;
         node->row_state[id] = State::Opened;};
+    lambda[int(Level::Subarray)][int(Command::ACT)] = [] (DRAM<LPDDR4>* node, int id) {
+        node->state = State::Opened;
+        node->row_state[id] = State::Opened;};
     lambda[int(Level::Bank)][int(Command::PRE)] = [] (DRAM<LPDDR4>* node, int id) {
-		assert(node->state == State::Opened); // Hasan
+		assert(node->state == State::Opened || node->state == State::PartiallyOpened); // Hasan
+        assert(node->row_state.begin() != node->row_state.end());
+        auto open_SA = node->children[node->row_state.begin()->first];
+        assert(open_SA->state == State::Opened || open_SA->state == State::PartiallyOpened);
+
 		node->collect_opened_cycles(node->cur_clk); // Hasan
+        open_SA->state = State::Closed;
+        node->state = State::Closed;
+        open_SA->row_state.clear();
+        node->row_state.clear();};
+    lambda[int(Level::Bank)][int(Command::ACT_NACK)] = [] (DRAM<LPDDR4>* node, int id) {
+        assert(node->state == State::Opened);
+        assert(node->row_state.begin() != node->row_state.end());
+        auto open_SA = node->children[node->row_state.begin()->first];
+        assert(open_SA->state == State::Opened);
+
+        open_SA->state = State::Closed;
         node->state = State::Closed;
+        open_SA->row_state.clear();
         node->row_state.clear();};
+    lambda[int(Level::Bank)][int(Command::ACT_PARTIAL_NACK)] = [] (DRAM<LPDDR4>* node, int id) {
+        assert(node->state == State::Opened);
+        assert(node->row_state.begin() != node->row_state.end());
+        auto open_SA = node->children[node->row_state.begin()->first];
+        assert(open_SA->state == State::Opened);
+
+        open_SA->state = State::PartiallyOpened;
+        node->state = State::PartiallyOpened;};
+    lambda[int(Level::Bank)][int(Command::PRE_RSQ)] = [this] (DRAM<LPDDR4>* node, int id) {
+        lambda[int(Level::Bank)][int(Command::PRE)](node, id);};
+    lambda[int(Level::Bank)][int(Command::RSQ)] = [] (DRAM<LPDDR4>* node, int id) {};
     lambda[int(Level::Rank)][int(Command::PREA)] = [] (DRAM<LPDDR4>* node, int id) {
-        for (auto bank : node->children) {
-			if(bank->state == State::Opened) // Hasan
-				bank->collect_opened_cycles(node->cur_clk); // Hasan
-            bank->state = State::Closed;
-            bank->row_state.clear();}};
+        for (auto bg : node->children)
+            for (auto bank : bg->children) {
+                if(bank->state == State::Opened) { // Hasan
+                    bank->collect_opened_cycles(node->cur_clk); // Hasan
+
+                    if (bank->row_state.begin() != bank->row_state.end()) {
+                        auto open_SA = bank->children[bank->row_state.begin()->first];
+                        open_SA->state = State::Closed;
+                        open_SA->row_state.clear();
+                    }
+                }
+                bank->state = State::Closed;
+                bank->row_state.clear();
+            }};
     lambda[int(Level::Rank)][int(Command::REF)] = [] (DRAM<LPDDR4>* node, int id) {};
     lambda[int(Level::Bank)][int(Command::RD)] = [] (DRAM<LPDDR4>* node, int id) {
 		node->just_opened = false; // Hasan
@@ -240,20 +316,31 @@ void LPDDR4::init_lambda()
 		node->just_opened = false; // Hasan
 		node->collect_opened_cycles(node->cur_clk); // Hasan
         node->state = State::Closed;
+
+        assert(node->row_state.begin() != node->row_state.end());
+        auto open_SA = node->children[node->row_state.begin()->first];
+        open_SA->state = State::Closed;
+        open_SA->row_state.clear();
         node->row_state.clear();};
     lambda[int(Level::Bank)][int(Command::WRA)] = [] (DRAM<LPDDR4>* node, int id) {
 		assert(node->state == State::Opened);
 		node->just_opened = false; // Hasan
 		node->collect_opened_cycles(node->cur_clk); // Hasan
         node->state = State::Closed;
+
+        assert(node->row_state.begin() != node->row_state.end());
+        auto open_SA = node->children[node->row_state.begin()->first];
+        open_SA->state = State::Closed;
+        open_SA->row_state.clear();
         node->row_state.clear();};
     lambda[int(Level::Rank)][int(Command::PDE)] = [] (DRAM<LPDDR4>* node, int id) {
-        for (auto bank : node->children) {
-            if (bank->state == State::Closed)
-                continue;
-            node->state = State::ActPowerDown;
-            return;
-        }
+        for (auto bg : node->children)
+            for (auto bank : bg->children) {
+                if (bank->state == State::Closed)
+                    continue;
+                node->state = State::ActPowerDown;
+                return;
+            }
         node->state = State::PrePowerDown;};
     lambda[int(Level::Rank)][int(Command::PDX)] = [] (DRAM<LPDDR4>* node, int id) {
         node->state = State::PowerUp;};
@@ -264,8 +351,15 @@ void LPDDR4::init_lambda()
 }
 
 
-void LPDDR4::init_timing()
+void LPDDR4::init_timing(bool per_bank_refresh)
 {
+    // clear current timing entries
+    for (auto& v : timing){
+        for (auto& v2 : v){
+            v2.clear();
+        }
+    }
+
     SpeedEntry& s = speed_entry;
     vector<TimingEntry> *t;
 
@@ -282,6 +376,23 @@ void LPDDR4::init_timing()
     t[int(Command::WRA)].push_back({Command::WR, 1, s.nBL});
     t[int(Command::WRA)].push_back({Command::WRA, 1, s.nBL});
 
+    t[int(Command::PRE_RSQ)].push_back({Command::RD, 1, s.nBL});
+    t[int(Command::PRE_RSQ)].push_back({Command::RDA, 1, s.nBL});
+    t[int(Command::PRE_RSQ)].push_back({Command::WR, 1, s.nBL});
+    t[int(Command::PRE_RSQ)].push_back({Command::WRA, 1, s.nBL});
+    t[int(Command::RD)].push_back({Command::PRE_RSQ, 1, s.nBL});
+    t[int(Command::RDA)].push_back({Command::PRE_RSQ, 1, s.nBL});
+    t[int(Command::WR)].push_back({Command::PRE_RSQ, 1, s.nBL});
+    t[int(Command::WRA)].push_back({Command::PRE_RSQ, 1, s.nBL});
+    t[int(Command::RSQ)].push_back({Command::RD, 1, s.nBL});
+    t[int(Command::RSQ)].push_back({Command::RDA, 1, s.nBL});
+    t[int(Command::RSQ)].push_back({Command::WR, 1, s.nBL});
+    t[int(Command::RSQ)].push_back({Command::WRA, 1, s.nBL});
+    t[int(Command::RD)].push_back({Command::RSQ, 1, s.nBL});
+    t[int(Command::RDA)].push_back({Command::RSQ, 1, s.nBL});
+    t[int(Command::WR)].push_back({Command::RSQ, 1, s.nBL});
+    t[int(Command::WRA)].push_back({Command::RSQ, 1, s.nBL});
+
 
     /*** Rank ***/
     t = timing[int(Level::Rank)];
@@ -306,6 +417,23 @@ void LPDDR4::init_timing()
     t[int(Command::WRA)].push_back({Command::RD, 1, s.nCWL + s.nBL + s.nWTR + 1});
     t[int(Command::WRA)].push_back({Command::RDA, 1, s.nCWL + s.nBL + s.nWTR + 1});
 
+    t[int(Command::PRE_RSQ)].push_back({Command::RD, 1, s.nCCD});
+    t[int(Command::PRE_RSQ)].push_back({Command::RDA, 1, s.nCCD});
+    t[int(Command::PRE_RSQ)].push_back({Command::WR, 1, s.nCCD});
+    t[int(Command::PRE_RSQ)].push_back({Command::WRA, 1, s.nCCD});
+    t[int(Command::RD)].push_back({Command::PRE_RSQ, 1, s.nCCD});
+    t[int(Command::RDA)].push_back({Command::PRE_RSQ, 1, s.nCCD});
+    t[int(Command::WR)].push_back({Command::PRE_RSQ, 1, s.nCCD});
+    t[int(Command::WRA)].push_back({Command::PRE_RSQ, 1, s.nCCD});
+    t[int(Command::RSQ)].push_back({Command::RD, 1, s.nCCD});
+    t[int(Command::RSQ)].push_back({Command::RDA, 1, s.nCCD});
+    t[int(Command::RSQ)].push_back({Command::WR, 1, s.nCCD});
+    t[int(Command::RSQ)].push_back({Command::WRA, 1, s.nCCD});
+    t[int(Command::RD)].push_back({Command::RSQ, 1, s.nCCD});
+    t[int(Command::RDA)].push_back({Command::RSQ, 1, s.nCCD});
+    t[int(Command::WR)].push_back({Command::RSQ, 1, s.nCCD});
+    t[int(Command::WRA)].push_back({Command::RSQ, 1, s.nCCD});
+
 
     // CAS <-> CAS (between sibling ranks)
     t[int(Command::RD)].push_back({Command::RD, 1, s.nBL + s.nRTRS, true});
@@ -326,6 +454,23 @@ void LPDDR4::init_timing()
     t[int(Command::WRA)].push_back({Command::RD, 1, s.nCWL + s.nBL + s.nRTRS - s.nCL, true});
     t[int(Command::WRA)].push_back({Command::RDA, 1, s.nCWL + s.nBL + s.nRTRS - s.nCL, true});
 
+    t[int(Command::PRE_RSQ)].push_back({Command::RD, 1, s.nBL + s.nRTRS, true});
+    t[int(Command::PRE_RSQ)].push_back({Command::RDA, 1, s.nBL + s.nRTRS, true});
+    t[int(Command::PRE_RSQ)].push_back({Command::WR, 1, s.nBL + s.nRTRS, true});
+    t[int(Command::PRE_RSQ)].push_back({Command::WRA, 1, s.nBL + s.nRTRS, true});
+    t[int(Command::RD)].push_back({Command::PRE_RSQ, 1, s.nBL + s.nRTRS, true});
+    t[int(Command::RDA)].push_back({Command::PRE_RSQ, 1, s.nBL + s.nRTRS, true});
+    t[int(Command::WR)].push_back({Command::PRE_RSQ, 1, s.nBL + s.nRTRS, true});
+    t[int(Command::WRA)].push_back({Command::PRE_RSQ, 1, s.nBL + s.nRTRS, true});
+    t[int(Command::RSQ)].push_back({Command::RD, 1, s.nBL + s.nRTRS, true});
+    t[int(Command::RSQ)].push_back({Command::RDA, 1, s.nBL + s.nRTRS, true});
+    t[int(Command::RSQ)].push_back({Command::WR, 1, s.nBL + s.nRTRS, true});
+    t[int(Command::RSQ)].push_back({Command::WRA, 1, s.nBL + s.nRTRS, true});
+    t[int(Command::RD)].push_back({Command::RSQ, 1, s.nBL + s.nRTRS, true});
+    t[int(Command::RDA)].push_back({Command::RSQ, 1, s.nBL + s.nRTRS, true});
+    t[int(Command::WR)].push_back({Command::RSQ, 1, s.nBL + s.nRTRS, true});
+    t[int(Command::WRA)].push_back({Command::RSQ, 1, s.nBL + s.nRTRS, true});
+
     // CAS <-> PREA
     t[int(Command::RD)].push_back({Command::PREA, 1, s.nRTP});
     t[int(Command::WR)].push_back({Command::PREA, 1, s.nCWL + s.nBL + s.nWR});
@@ -346,11 +491,19 @@ void LPDDR4::init_timing()
     t[int(Command::ACT)].push_back({Command::PREA, 1, s.nRAS});
     t[int(Command::PREA)].push_back({Command::ACT, 1, s.nRPab});
     t[int(Command::PRE)].push_back({Command::PRE, 1, s.nPPD});
+    t[int(Command::PRE_RSQ)].push_back({Command::PRE, 1, s.nPPD});
+    t[int(Command::PRE)].push_back({Command::PRE_RSQ, 1, s.nPPD});
+
+    t[int(Command::ACT_PARTIAL_NACK)].push_back({Command::PREA, 1, s.nRAS - s.nACTtoNACK});
 
     // RAS <-> REF
-    t[int(Command::PRE)].push_back({Command::REF, 1, s.nRPpb});
-    t[int(Command::PREA)].push_back({Command::REF, 1, s.nRPab});
-    t[int(Command::REF)].push_back({Command::ACT, 1, s.nRFCab});
+    if(!per_bank_refresh) {
+        t[int(Command::PRE)].push_back({Command::REF, 1, s.nRPpb});
+        t[int(Command::PREA)].push_back({Command::REF, 1, s.nRPab});
+        t[int(Command::REF)].push_back({Command::ACT, 1, s.nRFCab});
+
+        t[int(Command::PRE_RSQ)].push_back({Command::REF, 1, s.nRPpb});
+    }
 
     // RAS <-> PD
     t[int(Command::ACT)].push_back({Command::PDE, 1, 1});
@@ -364,19 +517,15 @@ void LPDDR4::init_timing()
     t[int(Command::SREFX)].push_back({Command::ACT, 1, s.nXSR});
 
     // REF <-> REF
-    t[int(Command::REF)].push_back({Command::REF, 1, s.nRFCab});
-    t[int(Command::REF)].push_back({Command::REFPB, 1, s.nRFCab});
-    t[int(Command::REFPB)].push_back({Command::REF, 1, s.nRFCpb});
+    if(!per_bank_refresh)
+        t[int(Command::REF)].push_back({Command::REF, 1, s.nRFCab});
 
     // REF <-> PD
     t[int(Command::REF)].push_back({Command::PDE, 1, 1});
-    t[int(Command::REFPB)].push_back({Command::PDE, 1, 1});
     t[int(Command::PDX)].push_back({Command::REF, 1, s.nXP});
-    t[int(Command::PDX)].push_back({Command::REFPB, 1, s.nXP});
 
     // REF <-> SR
     t[int(Command::SREFX)].push_back({Command::REF, 1, s.nXSR});
-    t[int(Command::SREFX)].push_back({Command::REFPB, 1, s.nXSR});
 
     // PD <-> PD
     t[int(Command::PDE)].push_back({Command::PDX, 1, s.nCKE});
@@ -406,16 +555,33 @@ void LPDDR4::init_timing()
     t[int(Command::WRA)].push_back({Command::ACT, 1, s.nCWL + s.nBL + s.nWR + s.nRPpb});
 
     // RAS <-> RAS
-    t[int(Command::ACT)].push_back({Command::ACT, 1, s.nRC});
+    // ACT -> ACT (tRC) is already enforced by tRAS and tRP, and it would delay an ACT that follows an ACT_NACK
     t[int(Command::ACT)].push_back({Command::PRE, 1, s.nRAS});
     t[int(Command::PRE)].push_back({Command::ACT, 1, s.nRPpb});
-    t[int(Command::PRE)].push_back({Command::REFPB, 1, s.nRPpb});
 
-    // between different banks
-    t[int(Command::ACT)].push_back({Command::REFPB, 1, s.nRRD, true});
-    t[int(Command::REFPB)].push_back({Command::ACT, 1, s.nRRD, true});
+    t[int(Command::ACT)].push_back({Command::PRE_RSQ, 1, s.nRAS});
+    t[int(Command::PRE_RSQ)].push_back({Command::ACT, 1, s.nRPpb});
+
+    t[int(Command::ACT_PARTIAL_NACK)].push_back({Command::PRE, 1, s.nRAS - s.nACTtoNACK});
+
+    // REFpb
+    if(per_bank_refresh) {
+        t[int(Command::PRE)].push_back({Command::REF, 1, s.nRPpb});
+        t[int(Command::PREA)].push_back({Command::REF, 1, s.nRPab});
+        t[int(Command::PRE_RSQ)].push_back({Command::REF, 1, s.nRPpb});
+
+        t[int(Command::REF)].push_back({Command::REF, 1, s.nRFCpb});
+        t[int(Command::REF)].push_back({Command::ACT, 1, s.nRFCpb});
+
+        // between different banks
+        t[int(Command::ACT)].push_back({Command::REF, 1, s.nRRD, true});
+        t[int(Command::REF)].push_back({Command::ACT, 1, s.nRRD, true});
+    }
+
+
+    /*** Subarray ***/
+    t = timing[int(Level::Subarray)];
 
-    // REFPB
-    t[int(Command::REFPB)].push_back({Command::REFPB, 1, s.nRFCpb});
-    t[int(Command::REFPB)].push_back({Command::ACT, 1, s.nRFCpb});
+    t[int(Command::ACT_NACK)].push_back({Command::ACT, 1, s.nNACK_RESEND});
+    t[int(Command::ACT_PARTIAL_NACK)].push_back({Command::ACT, 1, s.nNACK_RESEND});
 }
@@ -26,9 +26,11 @@ public:
     static map<string, enum Speed> speed_map;
 
     /* Level */
+    // LPDDR4 has no bank groups. The BankGroup level has a single node per rank so that
+    // LPDDR4 has the same level layout as DDR4, which SMD relies on
     enum class Level : int
     { 
-        Channel, Rank, Bank, Row, Column, MAX
+        Channel, Rank, BankGroup, Bank, Subarray, Row, Column, MAX
     };
 
     /* Command */
@@ -36,22 +38,26 @@ public:
     { 
         ACT, PRE, PREA, 
         RD,  WR,  RDA,  WRA, 
-        REF, REFPB, PDE, PDX, SREF, SREFX, 
+        REF, PDE, PDX, SREF, SREFX, 
+        PRE_RSQ, RSQ, ACT_NACK, ACT_PARTIAL_NACK, NOP,
         MAX
     };
     // Due to multiplexing on the cmd/addr bus:
     //      ACT, RD, WR, RDA, WRA take 4 cycles
-    //      PRE, PREA, REF, REFPB, PDE, PDX, SREF, SREFX take 2 cycles
+    //      PRE, PREA, REF, PDE, PDX, SREF, SREFX take 2 cycles
+    // A per-bank REF (REFpb) is a REF with Bank scope (see per_bank_refresh in Controller)
     string command_name[int(Command::MAX)] = {
         "ACT", "PRE", "PREA", 
         "RD",  "WR",  "RDA",  "WRA", 
-        "REF", "REFPB", "PDE", "PDX", "SREF", "SREFX"
+        "REF", "PDE", "PDX", "SREF", "SREFX",
+        "PRE_RSQ", "RSQ", "ACT_NACK", "ACT_PARTIAL_NACK", "NOP"
     };
 
     Level scope[int(Command::MAX)] = {
         Level::Row,    Level::Bank,   Level::Rank,   
         Level::Column, Level::Column, Level::Column, Level::Column,
-        Level::Rank,   Level::Bank,   Level::Rank,   Level::Rank,   Level::Rank,   Level::Rank
+        Level::Rank,   Level::Rank,   Level::Rank,   Level::Rank,   Level::Rank,
+        Level::Bank,   Level::Rank,   Level::Subarray, Level::Subarray, Level::Subarray
     };
 
     bool is_opening(Command cmd) 
@@ -84,6 +90,8 @@ public:
             case int(Command::WRA):
             case int(Command::PRE):
             case int(Command::PREA):
+            case int(Command::PRE_RSQ):
+            case int(Command::ACT_NACK):
                 return true;
             default:
                 return false;
@@ -94,13 +102,14 @@ public:
     {
         switch(int(cmd)) {
             case int(Command::REF):
-            case int(Command::REFPB):
                 return true;
             default:
                 return false;
         }
     }
 
+    void mult_refresh_pb(float mult) {};
+
     Command add_autoprecharge (const Command cmd) {
         switch(int(cmd)) {
             case int(Command::RD):
@@ -115,32 +124,39 @@ public:
         }
     }
 
+    // calculates a single bank id within a rank based on the bank group ID and bank ID
     uint32_t calc_global_bank_id(const std::vector<int> addr_vec) const {
-        uint32_t banks_per_rank = org_entry.count[uint32_t(Level::Bank)];
+        uint32_t banks_per_bg = org_entry.count[uint32_t(Level::Bank)];
+
+        return addr_vec[uint32_t(Level::BankGroup)]*banks_per_bg + addr_vec[uint32_t(Level::Bank)];
+    }
 
-        return addr_vec[uint32_t(Level::Rank)]*banks_per_rank + addr_vec[uint32_t(Level::Bank)];
+    uint32_t calc_row_id_in_bank(const std::vector<int> addr_vec) const {
+        return addr_vec[uint32_t(Level::Subarray)]*get_subarray_size() + addr_vec[uint32_t(Level::Row)];
     }
 
     uint32_t get_num_banks_per_rank() const {
-        return org_entry.count[uint32_t(Level::Bank)];
+        return org_entry.count[uint32_t(Level::BankGroup)] * org_entry.count[uint32_t(Level::Bank)];
     }
 
     uint32_t get_num_all_banks() const {
-        return org_entry.count[uint32_t(Level::Rank)] * org_entry.count[uint32_t(Level::Bank)];
+        return org_entry.count[uint32_t(Level::Rank)] * org_entry.count[uint32_t(Level::BankGroup)] * org_entry.count[uint32_t(Level::Bank)];
     }
 
     /* State */
     enum class State : int
     {
-        Opened, Closed, PowerUp, ActPowerDown, PrePowerDown, SelfRefresh, MAX
+        Opened, Closed, PartiallyOpened, PowerUp, ActPowerDown, PrePowerDown, SelfRefresh, MAX
     } start[int(Level::MAX)] = {
-        State::MAX, State::PowerUp, State::Closed, State::Closed, State::MAX
+        State::MAX, State::PowerUp, State::MAX, State::Closed, State::Closed, State::Closed, State::MAX
     };
 
     /* Translate */
     Command translate[int(Request::Type::MAX)] = {
         Command::RD,  Command::WR,
-        Command::REF, Command::PDE, Command::SREF, Command::SREF, Command::RD
+        Command::REF, Command::PDE, Command::SREF,
+        Command::RD, Command::RD, // PARA_REFRESH, RAIDR_REFRESH
+        Command::MAX, Command::RD // EXTENSION (unused), PREFETCH
     };
 
     /* Prerequisite */
@@ -183,12 +199,12 @@ public:
         int dq;
         int count[int(Level::MAX)];
     } org_table[int(Org::MAX)] = {
-        {2<<10, 16, {0, 0, 8, 1<<14, 1<<10}},
-        {3<<10, 16, {0, 0, 8, 3<<13, 1<<10}},
-        {4<<10, 16, {0, 0, 8, 1<<15, 1<<10}},
-        {4<<11, 16, {0, 0, 8, 1<<16, 1<<10}},
-        {4<<12, 16, {0, 0, 8, 1<<17, 1<<10}},
-        {4<<13, 16, {0, 0, 8, 1<<18, 1<<10}},
+        {2<<10, 16, {0, 0, 1, 8, 1, 1<<14, 1<<10}},
+        {3<<10, 16, {0, 0, 1, 8, 1, 3<<13, 1<<10}},
+        {4<<10, 16, {0, 0, 1, 8, 1, 1<<15, 1<<10}},
+        {4<<11, 16, {0, 0, 1, 8, 1, 1<<16, 1<<10}},
+        {4<<12, 16, {0, 0, 1, 8, 1, 1<<17, 1<<10}},
+        {4<<13, 16, {0, 0, 1, 8, 1, 1<<18, 1<<10}},
     }, org_entry;
 
     void set_channel_number(int channel);
@@ -230,6 +246,8 @@ public:
         int nRFCab, nRFCpb, nREFI;
         int nCKE, nXP; // CKE value n/a
         int nSR, nXSR; // tXSR = tRFCab + 7.5ns
+        int nRFC; // alias to nRFCab for the refresh and SMD code that is shared with DDR4
+        int nNACK_RESEND, nACTtoNACK;
     } speed_table[int(Speed::MAX)] = {
         // LPDDR4 is 16n prefetch. Latencies in JESD209-4 counts from and to 
         // the end of each command, I've converted them as if all commands take
@@ -249,15 +267,18 @@ public:
 
     int read_latency;
 
-private:
+    float act_nack_interval_ns = 0;
+
     void init_speed();
-    void init_lambda();
     void init_prereq();
+    void init_timing(bool per_bank_refresh = false);
+
+private:
+    void init_lambda();
     void init_rowhit();  // SAUGATA: added function to check for row hits
     void init_rowopen();
-    void init_timing();
 
-    uint32_t _sa_size;
+    uint32_t _sa_size = 0;
 };
 
 } /*namespace ramulator*/
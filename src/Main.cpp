@@ -17,13 +17,14 @@
 #include "Gem5Wrapper.h"
 // #include "DDR3.h"
 #include "DDR4.h"
+#include "DDR5.h"
 #include "DSARP.h"
 // #include "GDDR5.h"
 //#include "LPDDR3.h"
-// #include "LPDDR4.h"
+#include "LPDDR4.h"
 // #include "WideIO.h"
 //#include "WideIO2.h"
-//#include "HBM.h"
+#include "HBM.h"
 // #include "SALP.h"
 // #include "ALDRAM.h"
 //#include "TLDRAM.h"
@@ -178,6 +179,7 @@ void run_cputrace(Config& configs, Memory<T, Controller>& memory, const std::vec
     }
     // This a workaround for statistics set only initially lost in the end
     memory.finish();
+    proc.finish();
 
     auto simulation_duration = std::chrono::duration_cast<std::chrono::seconds>
                                     (std::chrono::steady_clock::now() - start);
@@ -289,6 +291,19 @@ int main(int argc, char* argv[])
       DDR4* ddr4 = new DDR4(configs);
       start_run(configs, ddr4, files);
     }
+    else if (standard == "DDR5") {
+      DDR5* ddr5 = new DDR5(configs);
+      start_run(configs, ddr5, files);
+    }
+    else if (standard == "LPDDR4") {
+      // total cap: 2GB, 1/2 of others
+      LPDDR4* lpddr4 = new LPDDR4(configs);
+      start_run(configs, lpddr4, files);
+    }
+    else if (standard == "HBM") {
+      HBM* hbm = new HBM(configs);
+      start_run(configs, hbm, files);
+    }
     // else if (standard == "SALP-MASA") {
     //   //SALP* salp8 = new SALP(configs["org"], configs["speed"], "SALP-MASA", configs.get_int("subarrays"));
     //   SALP* salp8 = new SALP(configs, "SALP-MASA");
@@ -296,17 +311,9 @@ int main(int argc, char* argv[])
 //    } else if (standard == "LPDDR3") {
 //      LPDDR3* lpddr3 = new LPDDR3(configs["org"], configs["speed"]);
 //      start_run(configs, lpddr3, files);
-    // } else if (standard == "LPDDR4") {
-    //   // total cap: 2GB, 1/2 of others
-    //   //LPDDR4* lpddr4 = new LPDDR4(configs["org"], configs["speed"]);
-    //   LPDDR4* lpddr4 = new LPDDR4(configs);
-    //   start_run(configs, lpddr4, files);
     // } else if (standard == "GDDR5") {
     //   GDDR5* gddr5 = new GDDR5(configs["org"], configs["speed"]);
     //   start_run(configs, gddr5, files);
-    // } else if (standard == "HBM") {
-    //   HBM* hbm = new HBM(configs["org"], configs["speed"]);
-    //   start_run(configs, hbm, files);
 //    } else if (standard == "WideIO") {
 //      // total cap: 1GB, 1/4 of others
 //      WideIO* wio = new WideIO(configs["org"], configs["speed"]);
@@ -1,10 +1,12 @@
 #ifndef __MEMORY_H
 #define __MEMORY_H
 
+#include "AddressMapping.h"
 #include "Config.h"
 #include "DRAM.h"
 #include "Request.h"
 #include "Controller.h"
+#include "PageAllocator.h"
 #include "SpeedyController.h"
 #include "Statistics.h"
 // #include "GDDR5.h"
@@ -17,6 +19,7 @@
 #include <functional>
 #include <cmath>
 #include <cassert>
+#include <memory>
 #include <tuple>
 
 using namespace std;
@@ -35,6 +38,7 @@ public:
     virtual int pending_requests() = 0;
     virtual void finish(void) = 0;
     virtual long page_allocator(long addr, int coreid) = 0;
+    virtual bool page_mapped(long addr, int coreid) = 0; // whether page_allocator would not allocate a frame
     virtual void record_core(int coreid) = 0;
 };
 
@@ -67,11 +71,15 @@ protected:
 
   long max_address;
 public:
-    enum class Type {
-        ChRaBaSaRoCo,
-        RoSaBaRaCoCh,
-        MAX,
-    } type = Type::RoSaBaRaCoCh;
+    // The original mapping names, which leave out the bank group
+    std::map<string, string> mapping_aliases = {
+      {"ChRaBaSaRoCo", "ChRaBgBaSaRoCo"},
+      {"RoSaBaRaCoCh", "RoSaBaBgRaCoCh"},
+    };
+
+    std::unique_ptr<AddressMapping> mapping;
+    // rotate the subarray index by the bank index (the _SaInterleaved mappings)
+    bool sa_interleaved = false;
 
     enum class Translation {
       None,
@@ -84,9 +92,7 @@ public:
       {"Random", Translation::Random},
     };
 
-    vector<int> free_physical_pages;
-    long free_physical_pages_remaining;
-    map<pair<int, long>, long> page_translation;
+    std::unique_ptr<PageAllocator> random_page_allocator;
 
     vector<Controller<T>*> ctrls;
     T * spec;
@@ -105,12 +111,8 @@ public:
         if (configs.contains("translation")) {
           translation = name_to_translation[configs["translation"]];
         }
-        if (translation != Translation::None) {
-          // construct a list of available pages
-          // TODO: this should not assume a 4KB page!
-          free_physical_pages_remaining = max_address >> 12;
-
-          free_physical_pages.resize(free_physical_pages_remaining, -1);
+        if (translation == Translation::Random) {
+          init_page_allocator(configs);
         }
 
         dram_capacity
@@ -231,10 +233,6 @@ public:
         int tx = (spec->prefetch_size * spec->channel_width / 8);
         tx_bits = calc_log2(tx);
         assert((1<<tx_bits) == tx);
-        // If hi address bits will not be assigned to Rows
-        // then the chips must not be LPDDRx 6Gb, 12Gb etc.
-        if (type != Type::RoSaBaRaCoCh && spec->standard_name.substr(0, 5) == "LPDDR")
-            assert((sz[int(T::Level::Row)] & (sz[int(T::Level::Row)] - 1)) == 0);
 
         max_address = spec->channel_width / 8;
 
@@ -245,6 +243,91 @@ public:
         }
 
         addr_bits[int(T::Level::MAX) - 1] -= calc_log2(spec->prefetch_size);
+
+        init_address_mapping(configs);
+
+        // If hi address bits will not be assigned to Rows
+        // then the chips must not be LPDDRx 6Gb, 12Gb etc.
+        if (mapping->top_level() != int(T::Level::Row) && spec->standard_name.substr(0, 5) == "LPDDR")
+            assert((sz[int(T::Level::Row)] & (sz[int(T::Level::Row)] - 1)) == 0);
+    }
+
+    void init_address_mapping(const Config& configs) {
+        vector<string> level_names(int(T::Level::MAX));
+        level_names[int(T::Level::Channel)] = "Ch";
+        level_names[int(T::Level::Rank)] = "Ra";
+        level_names[int(T::Level::BankGroup)] = "Bg";
+        level_names[int(T::Level::Bank)] = "Ba";
+        level_names[int(T::Level::Subarray)] = "Sa";
+        level_names[int(T::Level::Row)] = "Ro";
+        level_names[int(T::Level::Column)] = "Co";
+        mapping.reset(new AddressMapping(level_names, addr_bits));
+
+        const string& file = configs.get_str("address_mapping_file");
+        if (file != "none") {
+            mapping->load_file(file);
+        } else {
+            string order = configs.get_str("address_mapping");
+            const string suffix = "_SaInterleaved";
+            sa_interleaved = order.size() > suffix.size() &&
+                order.compare(order.size() - suffix.size(), suffix.size(), suffix) == 0;
+            if (sa_interleaved) {
+                order.resize(order.size() - suffix.size());
+            }
+            if (mapping_aliases.find(order) != mapping_aliases.end()) {
+                order = mapping_aliases[order];
+            }
+            mapping->set_order(order);
+        }
+
+        const string& xor_levels = configs.get_str("address_mapping_xor");
+        if (xor_levels != "none") {
+            mapping->add_xor(xor_levels, int(T::Level::Row));
+        }
+    }
+
+    void init_page_allocator(const Config& configs) {
+        const string& page_size = configs.get_str("page_size");
+        int page_bits = 12;
+        if (page_size == "2MB") {
+            page_bits = 21;
+        } else {
+            assert(page_size == "4KB" && "[Memory] ERROR: Unknown page size.");
+        }
+        random_page_allocator.reset(
+            new PageAllocator(max_address >> page_bits, page_bits, physical_page_replacement));
+
+        const string& coloring = configs.get_str("page_coloring");
+        if (coloring == "off") {
+            return;
+        }
+
+        // the color is a field of the physical address: the bank bits
+        // (bank group and bank), the subarray bits, or both
+        int first = int(T::Level::BankGroup), last = int(T::Level::Bank);
+        if (coloring == "subarray") {
+            first = last = int(T::Level::Subarray);
+        } else if (coloring == "bank_subarray") {
+            last = int(T::Level::Subarray);
+        } else {
+            assert(coloring == "bank" && "[Memory] ERROR: Unknown page coloring.");
+        }
+        // the subarray bits of the _SaInterleaved mappings do not select
+        // the subarray alone, so only the bank bits can be colored
+        assert(!(sa_interleaved && last == int(T::Level::Subarray)) &&
+               "[Memory] ERROR: Subarray page coloring is not supported with the _SaInterleaved mappings.");
+
+        vector<int> levels;
+        for (int lev = first; lev <= last; lev++) {
+            levels.push_back(lev);
+        }
+        int lo_bit, hi_bit;
+        if (!mapping->field_range(levels, lo_bit, hi_bit)) {
+            assert(false && "[Memory] ERROR: Page coloring requires the colored levels to be one contiguous, unhashed address field.");
+            exit(1);
+        }
+        random_page_allocator->set_coloring(tx_bits + lo_bit, tx_bits + hi_bit,
+            configs.get_str("page_coloring_partitions"), configs.get_int("cores"));
     }
 
     double clk_ns()
@@ -342,28 +425,21 @@ public:
 
     void update_addr_vec(Request& req) {
         //std::cout << addr_bits.size() << std::endl;
-        req.addr_vec.resize(addr_bits.size());
         long addr = req.addr;
         //std::cout << addr << std::endl;
 
         // Each transaction size is 2^tx_bits, so first clear the lowest tx_bits bits
         clear_lower_bits(addr, tx_bits);
 
-        switch(int(type)){
-            case int(Type::ChRaBaSaRoCo):
-                for (int i = addr_bits.size() - 1; i >= 0; i--)
-                    req.addr_vec[i] = slice_lower_bits(addr, addr_bits[i]);
-                break;
-            case int(Type::RoSaBaRaCoCh):
-                req.addr_vec[0] = slice_lower_bits(addr, addr_bits[0]); //channel
-                req.addr_vec[addr_bits.size() - 1] = slice_lower_bits(addr, addr_bits[addr_bits.size() - 1]); //column
-                    
-                for (int i = 1; i <= int(T::Level::Row); i++)
-                    req.addr_vec[i] = slice_lower_bits(addr, addr_bits[i]);
-                
-                break;
-            default:
-                assert(false);
+        mapping->decode(addr, req.addr_vec);
+
+        if (sa_interleaved) {
+            // In RoSaBaRaCoCh, the same row address in every bank falls into the same subarray. Rotating the subarray
+            // index by the bank index makes consecutive rows that cross a bank boundary target different subarrays,
+            // which reduces the chance of multiple streams hitting the SAs that are locked for SMD maintenance at once.
+            int num_SAs = spec->org_entry.count[int(T::Level::Subarray)];
+            int bank_ind = req.addr_vec[int(T::Level::Rank)]*spec->get_num_banks_per_rank() + spec->calc_global_bank_id(req.addr_vec);
+            req.addr_vec[int(T::Level::Subarray)] = (req.addr_vec[int(T::Level::Subarray)] + bank_ind) % num_SAs;
         }
         //std::cout << req.addr_vec[0] << " " << req.addr_vec[1] << " " << req.addr_vec[2] << " " << req.addr_vec[3] << " " << req.addr_vec[4] << " " << req.addr_vec[5] << " " << req.addr_vec[6] << std::endl;
     }
@@ -393,51 +469,12 @@ public:
     }
 
     long page_allocator(long addr, int coreid) {
-        long virtual_page_number = addr >> 12;
-
         switch(int(translation)) {
             case int(Translation::None): {
               return addr;
             }
             case int(Translation::Random): {
-                auto target = make_pair(coreid, virtual_page_number);
-                if(page_translation.find(target) == page_translation.end()) {
-                    // page doesn't exist, so assign a new page
-                    // make sure there are physical pages left to be assigned
-
-                    // if physical page doesn't remain, replace a previous assigned
-                    // physical page.
-                    if (!free_physical_pages_remaining) {
-                      physical_page_replacement++;
-                      long phys_page_to_read = lrand() % free_physical_pages.size();
-                      assert(free_physical_pages[phys_page_to_read] != -1);
-                      page_translation[target] = phys_page_to_read;
-                    } else {
-                        // assign a new page
-                        long phys_page_to_read = lrand() % free_physical_pages.size();
-                        // if the randomly-selected page was already assigned
-                        if(free_physical_pages[phys_page_to_read] != -1) {
-                            long starting_page_of_search = phys_page_to_read;
-
-                            do {
-                                // iterate through the list until we find a free page
-                                // TODO: does this introduce serious non-randomness?
-                                ++phys_page_to_read;
-                                phys_page_to_read %= free_physical_pages.size();
-                            }
-                            while((phys_page_to_read != starting_page_of_search) && free_physical_pages[phys_page_to_read] != -1);
-                        }
-
-                        assert(free_physical_pages[phys_page_to_read] == -1);
-
-                        page_translation[target] = phys_page_to_read;
-                        free_physical_pages[phys_page_to_read] = coreid;
-                        --free_physical_pages_remaining;
-                    }
-                }
-
-                // SAUGATA TODO: page size should not always be fixed to 4KB
-                return (page_translation[target] << 12) | (addr & ((1 << 12) - 1));
+                return random_page_allocator->translate(addr, coreid);
             }
             default:
                 assert(false);
@@ -445,6 +482,13 @@ public:
 
     }
 
+    bool page_mapped(long addr, int coreid) {
+        if (translation == Translation::Random) {
+            return random_page_allocator->is_mapped(addr, coreid);
+        }
+        return true;
+    }
+
     void reload_options(const Config& configs) {
         set_DRAM_sizes(configs);
 
@@ -470,13 +514,6 @@ private:
     {
         addr >>= bits;
     }
-    long lrand(void) {
-        if(sizeof(int) < sizeof(long)) {
-            return static_cast<long>(rand()) << (sizeof(int) * 8) | rand();
-        }
-
-        return rand();
-    }
 };
 
 } /*namespace ramulator*/
@@ -1,8 +1,8 @@
 #include "MemoryFactory.h"
-// #include "LPDDR4.h"
+#include "LPDDR4.h"
 // #include "WideIO.h"
 //#include "WideIO2.h"
-// #include "HBM.h"
+#include "HBM.h"
 // #include "SALP.h"
 
 using namespace ramulator;
@@ -10,10 +10,10 @@ using namespace ramulator;
 namespace ramulator
 {
 
-// template <>
-// void MemoryFactory<LPDDR4>::validate(int channels, int ranks, const Config& configs) {
-//     assert(channels >= 2 && "LPDDR4 requires 2, 4, 8 ... channels");
-// }
+template <>
+void MemoryFactory<LPDDR4>::validate(int channels, int ranks, const Config& configs) {
+    assert(channels >= 2 && "LPDDR4 requires 2, 4, 8 ... channels");
+}
 
 // template <>
 // void MemoryFactory<WideIO>::validate(int channels, int ranks, const Config& configs) {
@@ -26,10 +26,10 @@ namespace ramulator
 //    assert((ranks == 1 || ranks == 2) && "WideIO2 comes with 1 or 2 ranks");
 //}
 
-// template <>
-// void MemoryFactory<HBM>::validate(int channels, int ranks, const Config& configs) {
-//     assert(channels == 8 && "HBM comes with 8 channels");
-// }
+template <>
+void MemoryFactory<HBM>::validate(int channels, int ranks, const Config& configs) {
+    assert(channels == 8 && "HBM comes with 8 channels");
+}
 
 //template <>
 //MemoryBase *MemoryFactory<WideIO2>::create(const Config& configs, int cacheline) {
@@ -0,0 +1,131 @@
+#include "PageAllocator.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+#include <cstdlib>
+#include <sstream>
+
+namespace ramulator
+{
+
+PageAllocator::PageAllocator(long num_frames, int page_bits,
+    ScalarStat& physical_page_replacement):
+    num_frames(num_frames), page_bits(page_bits),
+    physical_page_replacement(physical_page_replacement) {
+  assert(num_frames > 0);
+  free_frames.resize(1);
+  free_frames[0].num_free = num_frames;
+  partitions.push_back({0});
+}
+
+void PageAllocator::set_coloring(int lo_bit, int hi_bit,
+    const std::string& partitions_str, int num_cores) {
+  int lo = std::max(lo_bit, page_bits);
+  if (hi_bit <= lo) {
+    printf("ERROR: The page coloring bits [%d, %d) are within the page offset (%d bits)\n",
+        lo_bit, hi_bit, page_bits);
+    assert(false && "ERROR: No page coloring bits above the page offset.");
+    exit(1);
+  }
+  color_shift = lo - page_bits;
+  color_bits = hi_bit - lo;
+  assert((num_frames >> (color_shift + color_bits)) > 0);
+
+  int num_colors = 1 << color_bits;
+  free_frames.assign(num_colors, FreeFrames());
+  for (auto& f : free_frames) {
+    f.num_free = frames_per_color();
+  }
+
+  partitions.clear();
+  if (partitions_str == "even") {
+    assert(num_colors >= num_cores && "ERROR: Fewer page colors than cores.");
+    for (int core = 0; core < num_cores; core++) {
+      partitions.emplace_back();
+      for (int c = core * num_colors / num_cores;
+          c < (core + 1) * num_colors / num_cores; c++) {
+        partitions.back().push_back(c);
+      }
+    }
+    return;
+  }
+
+  std::stringstream cores_ss(partitions_str);
+  std::string core_str;
+  while (getline(cores_ss, core_str, ';')) {
+    partitions.emplace_back();
+    std::stringstream colors_ss(core_str);
+    std::string range;
+    while (getline(colors_ss, range, ',')) {
+      size_t dash = range.find('-');
+      int first = std::stoi(range.substr(0, dash));
+      int last = (dash == std::string::npos) ? first : std::stoi(range.substr(dash + 1));
+      assert(0 <= first && first <= last && last < num_colors &&
+          "ERROR: Invalid page color range.");
+      for (int c = first; c <= last; c++) {
+        partitions.back().push_back(c);
+      }
+    }
+    assert(!partitions.back().empty() && "ERROR: A core has no page colors.");
+  }
+}
+
+void PageAllocator::add_cores(int num_cores) {
+  page_tables.resize(num_cores);
+  tlbs.resize(num_cores, std::vector<TLBEntry>(tlb_entries));
+}
+
+long PageAllocator::lookup(long vpn, int coreid) {
+  auto& page_table = page_tables[coreid];
+  auto it = page_table.find(vpn);
+  if (it != page_table.end()) {
+    return it->second;
+  }
+  // page doesn't exist, so assign a new page
+  long pfn = allocate_frame(coreid);
+  page_table.emplace(vpn, pfn);
+  return pfn;
+}
+
+long PageAllocator::allocate_frame(int coreid) {
+  const std::vector<int>& colors = partitions[coreid % partitions.size()];
+
+  long total_free = 0;
+  for (int c : colors) {
+    total_free += free_frames[c].num_free;
+  }
+
+  if (total_free == 0) {
+    // if physical page doesn't remain, replace a previous assigned
+    // physical page of the same colors.
+    physical_page_replacement++;
+    int color = colors[std::uniform_int_distribution<size_t>(0, colors.size() - 1)(rng)];
+    return frame_of(color,
+        std::uniform_int_distribution<long>(0, frames_per_color() - 1)(rng));
+  }
+
+  // Pick a free frame uniformly among the colors of the core
+  long pos = std::uniform_int_distribution<long>(0, total_free - 1)(rng);
+  int color = colors[0];
+  for (int c : colors) {
+    if (pos < free_frames[c].num_free) {
+      color = c;
+      break;
+    }
+    pos -= free_frames[c].num_free;
+  }
+
+  FreeFrames& f = free_frames[color];
+  long idx = f.at(pos);
+
+  // Move the last free frame to the position that was taken
+  long last = --f.num_free;
+  if (pos != last) {
+    f.moved[pos] = f.at(last);
+  }
+  f.moved.erase(last);
+  return frame_of(color, idx);
+}
+
+} // namespace ramulator
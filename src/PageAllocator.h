@@ -0,0 +1,116 @@
+#ifndef __PAGE_ALLOCATOR_H
+#define __PAGE_ALLOCATOR_H
+
+#include "Statistics.h"
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace ramulator
+{
+
+// Virtual to physical translation with random page allocation. Each
+// core has its own page table. A small direct-mapped TLB per core
+// catches the recent translations before the page table lookup.
+//
+// The free frames are kept in an implicit array that is shuffled as
+// frames are allocated (Fisher-Yates): a random position among the
+// free ones is picked, and the last free frame takes its place. Only
+// the positions that were overwritten are stored, so the structure
+// grows with the number of allocated frames rather than the DRAM size.
+//
+// With page coloring, the color of a frame is a field of its physical
+// address (e.g., the bank or the subarray bits) and each core only
+// gets frames of its own colors. Every color has its own free array.
+class PageAllocator {
+public:
+  PageAllocator(long num_frames, int page_bits,
+      ScalarStat& physical_page_replacement);
+
+  // Color the frames by the address bits [lo_bit, hi_bit). Only the
+  // bits above the page offset can be controlled by the allocator.
+  // partitions lists the colors of each core, separated by ';', as
+  // comma-separated colors or ranges (e.g., "0-3;4-7,12"). Core i uses
+  // the partition i modulo the number of partitions. If partitions is
+  // "even", the colors are split evenly among the cores.
+  void set_coloring(int lo_bit, int hi_bit, const std::string& partitions,
+      int num_cores);
+
+  // Returns the physical address of addr in the address space of coreid
+  long translate(long addr, int coreid) {
+    long vpn = addr >> page_bits;
+    if (coreid >= int(tlbs.size())) {
+      add_cores(coreid + 1);
+    }
+    TLBEntry& entry = tlbs[coreid][vpn & (tlb_entries - 1)];
+    if (entry.vpn != vpn) {
+      entry.vpn = vpn;
+      entry.pfn = lookup(vpn, coreid);
+    }
+    return (entry.pfn << page_bits) | (addr & ((1l << page_bits) - 1));
+  }
+
+  // Whether addr already has a frame in the address space of coreid.
+  // translate() does not change any state shared between the cores for
+  // such addresses.
+  bool is_mapped(long addr, int coreid) const {
+    return coreid < int(page_tables.size()) &&
+        page_tables[coreid].count(addr >> page_bits) != 0;
+  }
+
+private:
+  static const int tlb_entries = 64;
+
+  struct TLBEntry {
+    long vpn = -1;
+    long pfn = -1;
+  };
+
+  // The free frames of one color. Position k of the implicit array
+  // holds the k-th frame of the color unless it was overwritten.
+  struct FreeFrames {
+    long num_free;
+    // position -> frame index, for the positions that do not hold their own index
+    std::unordered_map<long, long> moved;
+
+    long at(long pos) const {
+      auto it = moved.find(pos);
+      return (it == moved.end()) ? pos : it->second;
+    }
+  };
+
+  long num_frames;
+  int page_bits;
+
+  // The color is the pfn bits [color_shift, color_shift + color_bits)
+  int color_shift = 0;
+  int color_bits = 0;
+  std::vector<FreeFrames> free_frames; // by color
+  std::vector<std::vector<int>> partitions; // colors of each core
+
+  std::vector<std::unordered_map<long, long>> page_tables;
+  std::vector<std::vector<TLBEntry>> tlbs;
+
+  std::mt19937_64 rng;
+  ScalarStat& physical_page_replacement;
+
+  void add_cores(int num_cores);
+  long lookup(long vpn, int coreid);
+  long allocate_frame(int coreid);
+
+  long frames_per_color() const {
+    return num_frames >> color_bits;
+  }
+
+  // The pfn of the idx-th frame of the color
+  long frame_of(int color, long idx) const {
+    long low = idx & ((1l << color_shift) - 1);
+    long high = idx >> color_shift;
+    return (((high << color_bits) | color) << color_shift) | low;
+  }
+};
+
+} // namespace ramulator
+
+#endif /* __PAGE_ALLOCATOR_H */
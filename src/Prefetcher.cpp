@@ -0,0 +1,244 @@
+#include "Prefetcher.h"
+#include "StridePrefetcher.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+#include <cstdlib>
+
+namespace ramulator
+{
+
+Prefetcher* Prefetcher::create(const Config& configs, int block_size,
+    function<bool(Request)> send, function<void(Request&)> callback,
+    function<void(Request&)> proc_callback) {
+  const std::string& name = configs.get_str("prefetcher");
+  Prefetcher* prefetcher = nullptr;
+  if (name == "off") {
+    return nullptr;
+  } else if (name == "stride") {
+    prefetcher = new StridePrefetcher(configs.get_int("stride_pref_entries"),
+        (StridePrefetcher::StridePrefMode) configs.get_int("stride_pref_mode"),
+        configs.get_int("stride_pref_single_stride_tresh"),
+        configs.get_int("stride_pref_multi_stride_tresh"),
+        configs.get_int("stride_pref_stride_start_dist"),
+        configs.get_int("stride_pref_stride_degree"),
+        configs.get_int("stride_pref_stride_dist"),
+        send, callback, proc_callback);
+  } else if (name == "next_line") {
+    prefetcher = new NextLinePrefetcher(configs.get_int("next_line_pref_degree"),
+        send, callback, proc_callback);
+  } else if (name == "stream") {
+    prefetcher = new StreamPrefetcher(configs.get_int("stream_pref_entries"),
+        configs.get_int("stream_pref_degree"),
+        configs.get_int("stream_pref_distance"),
+        send, callback, proc_callback);
+  } else if (name == "bop") {
+    prefetcher = new BestOffsetPrefetcher(send, callback, proc_callback);
+  } else {
+    printf("ERROR: Unknown prefetcher: %s\n", name.c_str());
+    assert(false && "ERROR: Unknown prefetcher.");
+    exit(1);
+  }
+
+  assert((block_size & (block_size - 1)) == 0 && "ERROR: The cache block size should be a power of two.");
+  prefetcher->line_bits = __builtin_ctz(block_size);
+  return prefetcher;
+}
+
+bool Prefetcher::issue_prefetch(long line) {
+  Request req(line << line_bits, Request::Type::PREFETCH, callback, 0);
+  req.proc_callback = proc_callback;
+  req.from_prefetcher = true;
+  return send(req);
+}
+
+/**** Next-line ****/
+
+void NextLinePrefetcher::prefetch_next(long addr) {
+  long line = line_index(addr);
+  for (int i = 1; i <= degree; i++) {
+    if (!same_page(line, line + i) || !issue_prefetch(line + i)) {
+      break;
+    }
+  }
+}
+
+void NextLinePrefetcher::hit(long addr, long clk, bool prefetched) {
+  if (prefetched) {
+    prefetch_next(addr);
+  }
+}
+
+void NextLinePrefetcher::miss(long addr, long clk) {
+  prefetch_next(addr);
+}
+
+/**** Stream ****/
+
+StreamPrefetcher::StreamPrefetcher(int num_streams, int degree, int distance,
+    function<bool(Request)> send, function<void(Request&)> callback,
+    function<void(Request&)> proc_callback):
+    Prefetcher(send, callback, proc_callback), streams(num_streams),
+    degree(degree), distance(distance) {
+  assert(num_streams > 0);
+  assert(distance >= degree);
+}
+
+void StreamPrefetcher::hit(long addr, long clk, bool prefetched) {
+  // keep the trained streams ahead of the demand accesses
+  if (prefetched) {
+    train(addr, clk, false);
+  }
+}
+
+void StreamPrefetcher::miss(long addr, long clk) {
+  train(addr, clk, true);
+}
+
+void StreamPrefetcher::train(long addr, long clk, bool allocate) {
+  long line = line_index(addr);
+
+  // An access in the window of a trained stream moves the stream forward
+  for (auto& s : streams) {
+    if (s.valid && s.trained &&
+        line >= min(s.start, s.end) && line <= max(s.start, s.end)) {
+      s.last_access = clk;
+      advance(s, line);
+      return;
+    }
+  }
+
+  if (!allocate) {
+    return;
+  }
+
+  // A miss close to a stream in training confirms its direction
+  for (auto& s : streams) {
+    if (s.valid && !s.trained && line != s.start &&
+        abs(line - s.start) <= train_window) {
+      int dir = (line > s.start) ? 1 : -1;
+      if (dir == s.dir) {
+        s.train_hits++;
+      } else {
+        s.dir = dir;
+        s.train_hits = 1;
+      }
+      s.start = line;
+      s.last_access = clk;
+      if (s.train_hits >= train_threshold) {
+        s.trained = true;
+        s.end = line;
+        advance(s, line);
+      }
+      return;
+    }
+  }
+
+  // Start a new stream in an invalid or the least recently used entry
+  auto victim = streams.begin();
+  for (auto it = streams.begin(); it != streams.end(); it++) {
+    if (!it->valid) {
+      victim = it;
+      break;
+    }
+    if (it->last_access < victim->last_access) {
+      victim = it;
+    }
+  }
+  *victim = Stream();
+  victim->valid = true;
+  victim->start = line;
+  victim->last_access = clk;
+}
+
+void StreamPrefetcher::advance(Stream& s, long line) {
+  s.start = line;
+  for (int i = 0; i < degree && (s.end - line) * s.dir < distance; i++) {
+    long next = s.end + s.dir;
+    // the next physical page is not necessarily the next virtual page
+    if (next < 0 || !same_page(line, next) || !issue_prefetch(next)) {
+      break;
+    }
+    s.end = next;
+  }
+}
+
+/**** Best-Offset ****/
+
+BestOffsetPrefetcher::BestOffsetPrefetcher(function<bool(Request)> send,
+    function<void(Request&)> callback, function<void(Request&)> proc_callback):
+    Prefetcher(send, callback, proc_callback), rr_table(1 << rr_bits, -1) {
+  for (int i = 1; i <= 256; i++) {
+    int n = i;
+    for (int p : {2, 3, 5}) {
+      while (n % p == 0) {
+        n /= p;
+      }
+    }
+    if (n == 1) {
+      offsets.push_back(i);
+    }
+  }
+  scores.assign(offsets.size(), 0);
+}
+
+void BestOffsetPrefetcher::hit(long addr, long clk, bool prefetched) {
+  if (prefetched) {
+    access(addr);
+  }
+}
+
+void BestOffsetPrefetcher::miss(long addr, long clk) {
+  access(addr);
+}
+
+void BestOffsetPrefetcher::fill(long addr, long clk, bool prefetched) {
+  long line = line_index(addr);
+  if (prefetched) {
+    // the line would have been timely for an access best_offset lines later
+    if (same_page(line, line - best_offset)) {
+      rr_insert(line - best_offset);
+    }
+  } else if (!prefetch_on) {
+    rr_insert(line);
+  }
+}
+
+void BestOffsetPrefetcher::access(long addr) {
+  long line = line_index(addr);
+  learn(line);
+  if (prefetch_on && same_page(line, line + best_offset)) {
+    issue_prefetch(line + best_offset);
+  }
+}
+
+void BestOffsetPrefetcher::learn(long line) {
+  // Test one offset per access
+  long base = line - offsets[test_idx];
+  if (same_page(line, base) && rr_hit(base)) {
+    if (++scores[test_idx] >= score_max) {
+      end_learning_phase();
+      return;
+    }
+  }
+
+  if (++test_idx == offsets.size()) {
+    test_idx = 0;
+    if (++round >= round_max) {
+      end_learning_phase();
+    }
+  }
+}
+
+void BestOffsetPrefetcher::end_learning_phase() {
+  auto best = max_element(scores.begin(), scores.end());
+  best_offset = offsets[best - scores.begin()];
+  prefetch_on = (*best > bad_score);
+
+  fill_n(scores.begin(), scores.size(), 0);
+  test_idx = 0;
+  round = 0;
+}
+
+} // namespace ramulator
@@ -0,0 +1,168 @@
+#ifndef __PREFETCHER_H
+#define __PREFETCHER_H
+
+#include "Config.h"
+#include "Request.h"
+#include <functional>
+#include <vector>
+
+namespace ramulator
+{
+
+// Base class of the prefetchers that are plugged into a Cache (currently
+// only the LLC). The cache calls the hooks below on demand accesses and
+// on fills, and the prefetcher issues PREFETCH requests back to the same
+// cache through send. Lines that a prefetcher brings in are marked in the
+// cache, which is how the cache measures accuracy, coverage and lateness.
+class Prefetcher {
+public:
+  Prefetcher(function<bool(Request)> send, function<void(Request&)> callback,
+      function<void(Request&)> proc_callback):
+      send(send), callback(callback), proc_callback(proc_callback) {}
+  virtual ~Prefetcher() {}
+
+  // A demand access hits in the cache. prefetched is set on the first
+  // demand hit to a line that was brought in by a prefetch.
+  virtual void hit(long addr, long clk, bool prefetched) {}
+  // A demand read misses in the cache and allocates an MSHR
+  virtual void miss(long addr, long clk) {}
+  // A line arrives from the lower level. prefetched is set if the line
+  // was requested by a prefetch and no demand access merged into it.
+  virtual void fill(long addr, long clk, bool prefetched) {}
+  // A demand read merges into the MSHR of an in-flight prefetch, i.e.,
+  // the prefetch was useful but late. By default, this is treated like
+  // the first demand hit to a prefetched line.
+  virtual void late(long addr, long clk) {
+    hit(addr, clk, true);
+  }
+
+  // Returns the prefetcher selected by the "prefetcher" option:
+  // stride, next_line, stream, or bop. Returns nullptr for off.
+  // block_size is the line size of the cache the prefetcher is plugged into.
+  static Prefetcher* create(const Config& configs, int block_size,
+      function<bool(Request)> send, function<void(Request&)> callback,
+      function<void(Request&)> proc_callback);
+
+protected:
+  static const int page_bits = 12;
+  int line_bits = 6; // set by create() from the block size of the cache
+
+  function<bool(Request)> send;
+  function<void(Request&)> callback;
+  function<void(Request&)> proc_callback;
+
+  long line_index(long addr) const {
+    return addr >> line_bits;
+  }
+
+  bool same_page(long line_a, long line_b) const {
+    return (line_a >> (page_bits - line_bits)) ==
+        (line_b >> (page_bits - line_bits));
+  }
+
+  // Sends a PREFETCH for the line. Returns false if the cache cannot
+  // accept it (e.g., the MSHRs are full).
+  bool issue_prefetch(long line);
+};
+
+// Tagged next-line prefetcher. A demand miss or the first demand hit to a
+// prefetched line prefetches the next degree lines in the same page.
+class NextLinePrefetcher : public Prefetcher {
+public:
+  NextLinePrefetcher(int degree, function<bool(Request)> send,
+      function<void(Request&)> callback, function<void(Request&)> proc_callback):
+      Prefetcher(send, callback, proc_callback), degree(degree) {}
+
+  void hit(long addr, long clk, bool prefetched) override;
+  void miss(long addr, long clk) override;
+
+protected:
+  int degree;
+
+  void prefetch_next(long addr);
+};
+
+// Stream prefetcher that follows ascending and descending streams of
+// misses (in the spirit of the IBM POWER4 and Srinath et al., HPCA 2007).
+// A stream is trained when two more misses land close to its first miss
+// in the same direction. A trained stream monitors the lines between its
+// last access and its last prefetch, and each access in this window
+// prefetches up to degree more lines while staying at most distance
+// lines ahead of the access and within its page.
+class StreamPrefetcher : public Prefetcher {
+public:
+  StreamPrefetcher(int num_streams, int degree, int distance,
+      function<bool(Request)> send, function<void(Request&)> callback,
+      function<void(Request&)> proc_callback);
+
+  void hit(long addr, long clk, bool prefetched) override;
+  void miss(long addr, long clk) override;
+
+protected:
+  struct Stream {
+    bool valid = false;
+    bool trained = false;
+    int dir = 0; // +1 ascending, -1 descending, 0 unknown
+    int train_hits = 0;
+    long start = 0; // the last demand access to the stream
+    long end = 0; // the last prefetched line
+    long last_access = 0;
+  };
+
+  static const int train_window = 16; // lines
+  static const int train_threshold = 2;
+
+  std::vector<Stream> streams;
+  int degree;
+  int distance;
+
+  void train(long addr, long clk, bool allocate);
+  void advance(Stream& stream, long line);
+};
+
+// Best-Offset prefetcher (Michaud, HPCA 2016). It prefetches X + D on an
+// access to line X, where the offset D is learned by checking which of a
+// fixed list of offsets would have prefetched the recently filled lines
+// (kept in the recent requests table) in time.
+class BestOffsetPrefetcher : public Prefetcher {
+public:
+  BestOffsetPrefetcher(function<bool(Request)> send,
+      function<void(Request&)> callback, function<void(Request&)> proc_callback);
+
+  void hit(long addr, long clk, bool prefetched) override;
+  void miss(long addr, long clk) override;
+  void fill(long addr, long clk, bool prefetched) override;
+
+protected:
+  static const int rr_bits = 8; // 256-entry recent requests table
+  static const int score_max = 31;
+  static const int round_max = 100;
+  static const int bad_score = 1;
+
+  // offsets in [1, 256] with no prime factor greater than 5
+  std::vector<int> offsets;
+  std::vector<int> scores;
+  std::vector<long> rr_table;
+  unsigned int test_idx = 0;
+  int round = 0;
+  int best_offset = 1;
+  bool prefetch_on = true;
+
+  void access(long addr);
+  void learn(long line);
+  void end_learning_phase();
+
+  unsigned int rr_index(long line) const {
+    return (line ^ (line >> rr_bits)) & ((1 << rr_bits) - 1);
+  }
+  void rr_insert(long line) {
+    rr_table[rr_index(line)] = line;
+  }
+  bool rr_hit(long line) const {
+    return rr_table[rr_index(line)] == line;
+  }
+};
+
+} // namespace ramulator
+
+#endif /* __PREFETCHER_H */
@@ -1,5 +1,4 @@
 #include "Processor.h"
-#include "StridePrefetcher.h"
 #include <cassert>
 
 using namespace std;
@@ -17,10 +16,12 @@ Processor::Processor(const Config& configs,
     no_core_caches(!configs.has_core_caches()),
     no_shared_cache(!configs.has_l3_cache()),
     l3_size(configs.get_int("l3_size")),
+    l3_assoc(configs.get_int("l3_assoc")),
+    mshr_per_bank(configs.get_int("l3_mshr_per_core")),
     cachesys(new CacheSystem(configs, send_memory, upgrade_prefetch_req)),
     llc(l3_size, l3_assoc, l3_blocksz,
          mshr_per_bank * trace_list.size(),
-         Cache::Level::L3, cachesys) {
+         Cache::Level::L3, cachesys, configs.get_str("l3_replacement")) {
 
   assert(cachesys != nullptr);
   int tracenum = trace_list.size();
@@ -50,27 +51,14 @@ Processor::Processor(const Config& configs,
   // plug in a prefetcher
   // currently only supporting prefetches to llc, so shared_cache is
   // required
-  if (configs.get_str("prefetcher") == "stride") {
-      assert(!no_shared_cache && "ERROR: Currently, a shared LLC is required for the stride prefetcher!");
-
-      // Stride prefetcher configuration
-      int num_entries = configs.get_int("stride_pref_entries");
-      int mode = configs.get_int("stride_pref_mode");
-      int ss_thresh = configs.get_int("stride_pref_single_stride_tresh");
-      int ms_thresh = configs.get_int("stride_pref_multi_stride_tresh");
-      int start_dist = configs.get_int("stride_pref_stride_start_dist");
-      int stride_degree = configs.get_int("stride_pref_stride_degree");
-      int stride_dist = configs.get_int("stride_pref_stride_dist");
-
-      StridePrefetcher * pref = new StridePrefetcher(num_entries, 
-                      (StridePrefetcher::StridePrefMode) mode,
-                      ss_thresh, ms_thresh, start_dist, stride_degree, stride_dist,
+  if (configs.get_str("prefetcher") != "off") {
+      assert(!no_shared_cache && "ERROR: Currently, a shared LLC is required for prefetching!");
+
+      llc.prefetcher.reset(Prefetcher::create(configs, l3_blocksz,
                       std::bind(&Cache::send, &llc, placeholders::_1),
                       std::bind(&Cache::callback, &llc, placeholders::_1),
-                      std::bind(&Processor::receive, this, placeholders::_1));
-
-      llc.prefetcher = pref;
-  } 
+                      std::bind(&Processor::receive, this, placeholders::_1)));
+  }
 
   // regStats
   cpu_cycles.name("cpu_cycles")
@@ -78,6 +66,39 @@ Processor::Processor(const Config& configs,
             .precision(0)
             ;
   cpu_cycles = 0;
+
+  num_threads = configs.get_int("parallel_threads");
+  if (num_threads > 0) {
+    assert(no_core_caches && "ERROR: Parallel simulation does not support private caches (use cache = L3 or no).");
+    quantum = configs.get_int("parallel_quantum");
+    assert(quantum > 0);
+    for (auto& core : cores) {
+      core->defer_sends = true;
+    }
+    for (int i = 1; i < num_threads; i++) {
+      workers.emplace_back(&Processor::worker_loop, this, i);
+    }
+  }
+
+  parallel_skew_bound.name("parallel_skew_bound")
+            .desc("Upper bound on the cycles by which the cores lagged the memory system in parallel simulation")
+            .precision(0)
+            ;
+  parallel_replay_stalls.name("parallel_replay_stalls")
+            .desc("Number of deferred sends that were rejected at their cycle in parallel simulation")
+            .precision(0)
+            ;
+}
+
+Processor::~Processor() {
+  {
+    lock_guard<mutex> lock(pool_mutex);
+    stop_workers = true;
+  }
+  pool_start.notify_all();
+  for (auto& worker : workers) {
+    worker.join();
+  }
 }
 
 void Processor::tick() {
@@ -89,27 +110,109 @@ void Processor::tick() {
   if (!(no_core_caches && no_shared_cache)) {
     cachesys->tick();
   }
-  for (unsigned int i = 0 ; i < cores.size() ; ++i) {
-    Core* core = cores[i].get();
-    core->tick();
+  if (num_threads > 0) {
+    if (clk % quantum == 0) {
+      run_quantum(clk + quantum);
+    }
+    for (unsigned int i = 0 ; i < cores.size() ; ++i) {
+      cores[i]->replay(clk);
+    }
+  } else {
+    for (unsigned int i = 0 ; i < cores.size() ; ++i) {
+      Core* core = cores[i].get();
+      core->tick();
+    }
+  }
+  clk++;
+}
+
+void Processor::run_quantum(long target) {
+  while (true) {
+    {
+      lock_guard<mutex> lock(pool_mutex);
+      round_target = target;
+      running = workers.size();
+      round++;
+    }
+    pool_start.notify_all();
+    run_cores(0, target);
+    {
+      unique_lock<mutex> lock(pool_mutex);
+      pool_done.wait(lock, [this] { return running == 0; });
+    }
+
+    // Allocate the frames in core order, so that the results do not
+    // depend on the number of threads, and resume the cores
+    bool done = true;
+    for (auto& core : cores) {
+      if (core->page_fault) {
+        core->resolve_page_fault();
+      }
+      done &= (core->bound_clk == target);
+    }
+    if (done) {
+      return;
+    }
+  }
+}
+
+void Processor::run_cores(int thread, long target) {
+  for (unsigned int i = thread ; i < cores.size() ; i += num_threads) {
+    cores[i]->run_until(target);
+  }
+}
+
+void Processor::worker_loop(int thread) {
+  int seen = 0;
+  while (true) {
+    long target;
+    {
+      unique_lock<mutex> lock(pool_mutex);
+      pool_start.wait(lock, [&] { return stop_workers || round != seen; });
+      if (stop_workers) {
+        return;
+      }
+      seen = round;
+      target = round_target;
+    }
+    run_cores(thread, target);
+    {
+      lock_guard<mutex> lock(pool_mutex);
+      if (--running == 0) {
+        pool_done.notify_one();
+      }
+    }
   }
 }
 
 void Processor::receive(Request& req) {
+  assert(req.coreid >= 0 && req.coreid < int(cores.size()));
+  Core* core = cores[req.coreid].get();
   if (!no_shared_cache) {
     llc.callback(req);
-  } else if (!cores[0]->no_core_caches) {
+  } else if (!core->no_core_caches) {
     // Assume all cores have caches or don't have caches
     // at the same time.
-    for (unsigned int i = 0 ; i < cores.size() ; ++i) {
-      Core* core = cores[i].get();
-      core->caches[0]->callback(req);
-    }
+    core->caches[0]->callback(req);
   }
-  for (unsigned int i = 0 ; i < cores.size() ; ++i) {
-    Core* core = cores[i].get();
+  // An upgraded prefetch carries coreid 0. The cores whose demand misses
+  // upgraded it are in merged_requests.
+  if (!req.from_prefetcher) {
     core->receive(req);
   }
+
+  // The demand misses of other cores (or the demand miss that upgraded
+  // a prefetch) may have merged into this request in the shared cache
+  if (!no_shared_cache && req.arrive != -1) {
+    auto merged = cachesys->merged_requests.equal_range(
+        req.addr & ~(l3_blocksz - 1l));
+    for (auto it = merged.first; it != merged.second; it++) {
+      if (req.from_prefetcher || it->second != req.coreid) {
+        cores[it->second]->receive(req);
+      }
+    }
+    cachesys->merged_requests.erase(merged.first, merged.second);
+  }
 }
 
 bool Processor::finished() {
@@ -137,6 +240,27 @@ bool Processor::finished() {
   }
 }
 
+void Processor::finish() {
+  if (!no_shared_cache) {
+    llc.finish();
+  }
+  for (unsigned int i = 0 ; i < cores.size() ; ++i) {
+    for (auto& cache : cores[i]->caches) {
+      cache->finish();
+    }
+  }
+  if (num_threads > 0) {
+    long max_delay = 0;
+    long stalls = 0;
+    for (auto& core : cores) {
+      max_delay = max(max_delay, core->max_replay_delay);
+      stalls += core->replay_stalls;
+    }
+    parallel_skew_bound = quantum + max_delay;
+    parallel_replay_stalls = stalls;
+  }
+}
+
 bool Processor::has_reached_limit() {
   for (unsigned int i = 0 ; i < cores.size() ; ++i) {
     if (!cores[i]->has_reached_limit()) {
@@ -186,7 +310,13 @@ Core::Core(const Config& configs, int coreid,
     Cache* llc, std::shared_ptr<CacheSystem> cachesys, MemoryBase& memory)
     : id(coreid), no_core_caches(!configs.has_core_caches()),
     no_shared_cache(!configs.has_l3_cache()),
-    llc(llc), trace(trace_fname), memory(memory)
+    l1_size(configs.get_int("l1_size")),
+    l1_assoc(configs.get_int("l1_assoc")),
+    l1_mshr_num(configs.get_int("l1_mshr_num")),
+    l2_size(configs.get_int("l2_size")),
+    l2_assoc(configs.get_int("l2_assoc")),
+    l2_mshr_num(configs.get_int("l2_mshr_num")),
+    llc(llc), trace(trace_fname), window(~(l1_blocksz - 1l)), memory(memory)
 {
   // Build cache hierarchy
   if (no_core_caches) {
@@ -195,11 +325,11 @@ Core::Core(const Config& configs, int coreid,
     // L2 caches[0]
     caches.emplace_back(new Cache(
         l2_size, l2_assoc, l2_blocksz, l2_mshr_num,
-        Cache::Level::L2, cachesys));
+        Cache::Level::L2, cachesys, configs.get_str("l2_replacement")));
     // L1 caches[1]
     caches.emplace_back(new Cache(
         l1_size, l1_assoc, l1_blocksz, l1_mshr_num,
-        Cache::Level::L1, cachesys));
+        Cache::Level::L1, cachesys, configs.get_str("l1_replacement")));
     send = bind(&Cache::send, caches[1].get(), placeholders::_1);
     if (llc != nullptr) {
       caches[0]->concatlower(llc);
@@ -271,10 +401,7 @@ void Core::tick()
         bubble_cnt--;
         cpu_inst++;
         if (long(cpu_inst.value()) == expected_limit_insts && !reached_limit) {
-          record_cycs = clk;
-          record_insts = long(cpu_inst.value());
-          memory.record_core(id);
-          reached_limit = true;
+          record_limit();
         }
     }
 
@@ -284,10 +411,7 @@ void Core::tick()
         if (window.is_full()) return;
 
         Request req(req_addr, req_type, callback, id);
-        req.req_unique_id = req_seq_num;
-        if (!send(req)) return;
-
-        req_seq_num++;
+        if (!send_request(req)) return;
 
         window.insert(false, req_addr);
         cpu_inst++;
@@ -296,32 +420,23 @@ void Core::tick()
         // write request
         assert(req_type == Request::Type::WRITE);
         Request req(req_addr, req_type, callback, id);
-        req.req_unique_id = req_seq_num;
-        if (!send(req)) return;
-
-        req_seq_num++;
+        if (!send_request(req)) return;
 
         cpu_inst++;
     }
     if (long(cpu_inst.value()) == expected_limit_insts && !reached_limit) {
-      record_cycs = clk;
-      record_insts = long(cpu_inst.value());
-      memory.record_core(id);
-      reached_limit = true;
+      record_limit();
     }
 
     if (no_core_caches) {
       more_reqs = trace.get_filtered_request(
           bubble_cnt, req_addr, req_type);
-      if (req_addr != -1) {
-        req_addr = memory.page_allocator(req_addr, id);
-      }
     } else {
       more_reqs = trace.get_unfiltered_request(
           bubble_cnt, req_addr, req_type);
-      if (req_addr != -1) {
-        req_addr = memory.page_allocator(req_addr, id);
-      }
+    }
+    if (req_addr != -1) {
+      translate_next();
     }
     if (!more_reqs) {
       if (!reached_limit) { // if the length of this trace is shorter than expected length, then record it when the whole trace finishes, and set reached_limit to true.
@@ -329,21 +444,95 @@ void Core::tick()
         // beginning until the requested amount of instructions are
         // simulated. This should never be reached now.
         assert(false && "Shouldn't be reached since we start over the trace");
-        record_cycs = clk;
-        record_insts = long(cpu_inst.value());
-        memory.record_core(id);
-        reached_limit = true;
+        record_limit();
       }
     }
 }
 
+bool Core::send_request(Request& req)
+{
+    if (defer_sends) {
+        // keep the core from running too far ahead of a congested memory system
+        if (int(outbox.size()) >= window.depth) return false;
+        outbox.push_back({bound_clk, false, req});
+        return true;
+    }
+    return issue(req);
+}
+
+bool Core::issue(Request& req)
+{
+    req.req_unique_id = req_seq_num;
+    if (!send(req)) return false;
+
+    req_seq_num++;
+    return true;
+}
+
+void Core::record_limit()
+{
+    record_cycs = clk;
+    record_insts = long(cpu_inst.value());
+    reached_limit = true;
+    if (defer_sends) {
+        // the memory statistics are recorded when the memory reaches this cycle
+        record_pending = true;
+        outbox.push_back({bound_clk, true, Request()});
+    } else {
+        memory.record_core(id);
+    }
+}
+
+void Core::translate_next()
+{
+    if (defer_sends && !memory.page_mapped(req_addr, id)) {
+        page_fault = true;
+        return;
+    }
+    req_addr = memory.page_allocator(req_addr, id);
+}
+
+void Core::run_until(long clk)
+{
+    while (bound_clk < clk && !page_fault) {
+        tick();
+        bound_clk++;
+    }
+}
+
+void Core::replay(long clk)
+{
+    while (!outbox.empty() && outbox.front().clk <= clk) {
+        DeferredSend& d = outbox.front();
+        if (d.record) {
+            if (record_pending) {
+                memory.record_core(id);
+                record_pending = false;
+            }
+        } else if (!issue(d.req)) {
+            if (d.clk == clk) {
+                replay_stalls++;
+            }
+            max_replay_delay = max(max_replay_delay, clk - d.clk + 1);
+            return;
+        }
+        outbox.pop_front();
+    }
+}
+
+void Core::resolve_page_fault()
+{
+    req_addr = memory.page_allocator(req_addr, id);
+    page_fault = false;
+}
+
 bool Core::finished()
 {
-    return !more_reqs && window.is_empty();
+    return !more_reqs && window.is_empty() && outbox.empty();
 }
 
 bool Core::has_reached_limit() {
-  return reached_limit;
+  return reached_limit && !record_pending;
 }
 
 long Core::get_insts() {
@@ -352,7 +541,7 @@ long Core::get_insts() {
 
 void Core::receive(Request& req)
 {
-    window.set_ready(req.addr, ~(l1_blocksz - 1l));
+    window.set_ready(req.addr);
     if (req.arrive != -1 && req.depart > last) {
       memory_access_cycles += (req.depart - max(last, req.arrive));
       last = req.depart;
@@ -364,6 +553,7 @@ void Core::reset_stats() {
     retired = 0;
     cpu_inst = 0;
     reached_limit = false;
+    record_pending = false;
 }
 
 void Core::set_warmup_insts(const ulong _warmup_insts) {
@@ -394,7 +584,9 @@ void Window::insert(bool ready, long addr)
     assert(load <= depth);
 
     ready_list.at(head) = ready;
-    addr_list.at(head) = addr;
+    if (!ready) {
+        waiting.emplace(addr & addr_mask, head);
+    }
 
     head = (head + 1) % depth;
     load++;
@@ -421,16 +613,12 @@ long Window::retire()
 }
 
 
-void Window::set_ready(long addr, int mask)
+void Window::set_ready(long addr)
 {
-    if (load == 0) return;
-
-    for (int i = 0; i < load; i++) {
-        int index = (tail + i) % depth;
-        if ((addr_list.at(index) & mask) != (addr & mask))
-            continue;
-        ready_list.at(index) = true;
-    }
+    auto entries = waiting.equal_range(addr & addr_mask);
+    for (auto it = entries.first; it != entries.second; it++)
+        ready_list.at(it->second) = true;
+    waiting.erase(entries.first, entries.second);
 }
 
 
@@ -469,9 +657,6 @@ bool Trace::get_unfiltered_request(long& bubble_cnt, long& req_addr, Request::Ty
 
 bool Trace::get_filtered_request(long& bubble_cnt, long& req_addr, Request::Type& req_type)
 {
-    static bool has_write = false;
-    static long write_addr;
-    static int line_num = 0;
     if (has_write){
         bubble_cnt = 0;
         req_addr = write_addr;
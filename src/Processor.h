@@ -11,7 +11,12 @@
 #include <fstream>
 #include <string>
 #include <ctype.h>
+#include <condition_variable>
+#include <deque>
 #include <functional>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
 
 namespace ramulator 
 {
@@ -30,6 +35,10 @@ public:
 private:
     std::ifstream file;
     std::string trace_name;
+    // the write (evicted cache line) of the last filtered request
+    bool has_write = false;
+    long write_addr;
+    int line_num = 0;
 };
 
 
@@ -38,19 +47,22 @@ public:
     int ipc = 4;
     int depth = 128;
 
-    Window() : ready_list(depth), addr_list(depth, -1) {}
+    // A completed request sets all the entries of its cache line ready
+    Window(long addr_mask) : ready_list(depth), addr_mask(addr_mask) {}
     bool is_full();
     bool is_empty();
     void insert(bool ready, long addr);
     long retire();
-    void set_ready(long addr, int mask);
+    void set_ready(long addr);
 
 private:
     int load = 0;
     int head = 0;
     int tail = 0;
     std::vector<bool> ready_list;
-    std::vector<long> addr_list;
+    long addr_mask;
+    // slots of the entries that are not ready yet, by masked address
+    std::unordered_multimap<long, int> waiting;
 };
 
 
@@ -77,6 +89,22 @@ public:
     long get_insts(); // the number of the instructions issued to the core
     function<void(Request&)> callback;
 
+    // Parallel simulation (parallel_threads > 0). The core runs ahead of
+    // the memory system for a quantum and its sends are deferred: they
+    // are accepted right away and replayed at their cycle by replay().
+    bool defer_sends = false;
+    long bound_clk = 0; // the processor cycle of the next tick
+    // The next request touches an unmapped page. Allocating a frame
+    // changes shared state, so the core stops until the processor
+    // allocates it.
+    bool page_fault = false;
+    long max_replay_delay = 0; // the most cycles a deferred send waited past its cycle
+    long replay_stalls = 0; // the deferred sends that the next level rejected at their cycle
+
+    void run_until(long clk);
+    void replay(long clk);
+    void resolve_page_fault();
+
     bool no_core_caches = true;
     bool no_shared_cache = true;
     int l1_size = 1 << 15;
@@ -98,8 +126,16 @@ public:
     bool reached_limit = false;
 
 private:
+    struct DeferredSend {
+        long clk;
+        bool record; // record the core in the memory instead of sending req
+        Request req;
+    };
+
     Trace trace;
     Window window;
+    std::deque<DeferredSend> outbox;
+    bool record_pending = false;
 
     long bubble_cnt;
     long req_addr = -1;
@@ -112,16 +148,23 @@ private:
     ScalarStat memory_access_cycles;
     ScalarStat cpu_inst;
     MemoryBase& memory;
+
+    bool send_request(Request& req);
+    bool issue(Request& req);
+    void record_limit();
+    void translate_next();
 };
 
 class Processor {
 public:
     Processor(const Config& configs, vector<std::string> trace_list,
         function<bool(Request)> send, function<bool(long)> upgrade_prefetch_req, MemoryBase& memory);
+    ~Processor();
     void tick();
     void receive(Request& req);
     void reset_stats();
     bool finished();
+    void finish(); // computes the derived statistics of the caches
     bool has_reached_limit();
     long get_insts(); // the total number of instructions issued to all cores
     void set_warmup_insts(const ulong warmup_insts);
@@ -146,6 +189,36 @@ public:
     Cache llc;
 
     ScalarStat cpu_cycles;
+
+private:
+    // Parallel simulation in the spirit of the bound-weave scheme of
+    // ZSim (Sanchez and Kozyrakis, ISCA 2013). Every quantum cycles, the
+    // cores run the next quantum independently on parallel_threads
+    // threads (including the caller) and defer their sends to the LLC or
+    // the memory. The sends are then replayed in cycle and core order,
+    // so the memory system sees them at the same cycles as in lockstep
+    // simulation. A core sees a response up to quantum cycles late, plus
+    // the delay of the sends that were rejected at their cycle.
+    // Requires no private caches, as they share the CacheSystem.
+    int num_threads = 0; // 0 ticks the cores in lockstep
+    long quantum = 0;
+    long clk = 0; // not reset with the stats, unlike cpu_cycles
+
+    std::vector<std::thread> workers;
+    std::mutex pool_mutex;
+    std::condition_variable pool_start;
+    std::condition_variable pool_done;
+    long round_target = 0;
+    int round = 0;
+    int running = 0;
+    bool stop_workers = false;
+
+    ScalarStat parallel_skew_bound;
+    ScalarStat parallel_replay_stalls;
+
+    void run_quantum(long target);
+    void run_cores(int thread, long target);
+    void worker_loop(int thread);
 };
 
 }
@@ -36,6 +36,7 @@ private:
   int num_rows;
   int num_subarrays;
   int num_rows_per_subarray;
+  int bank_id_bits = 0; // ceil(log2(num_banks * num_bank_groups))
 
   int nREFI_internal;
 
@@ -47,8 +48,8 @@ private:
   }
 
   uint32_t get_bloom_filter_address(const uint32_t bank_id, const uint32_t row_id) const {
-      // there can be at most 16 banks, so shifting row_id by 4 and adding bank_id
-      return (row_id << 4) + bank_id;
+      // the bank id takes the lowest bank_id_bits bits
+      return (row_id << bank_id_bits) + bank_id;
   }
 
   std::vector<int> addr_vec_from_refresh_counter()
@@ -116,6 +117,8 @@ RAIDR<T>::RAIDR(const Config& configs, Controller<T>* ctrl) : ctrl(ctrl) {
   num_rows_per_subarray = ctrl->channel->spec->org_entry.count[(int)T::Level::Row];
   num_subarrays = ctrl->channel->spec->org_entry.count[(int)T::Level::Subarray];
   num_rows = num_rows_per_subarray * num_subarrays;
+  while ((1 << bank_id_bits) < num_banks * num_bank_groups)
+    bank_id_bits++;
 
   // print number of ranks, banks, bank groups, and rows
   std::cout << "num_ranks: " << num_ranks << std::endl;
@@ -4,10 +4,12 @@
  * This is a refresh scheduler. A list of refresh policies implemented:
  *
  * 1. All-bank refresh
- * 2. Per-bank refresh (only DSARP memory module has been completed to work with REFpb).
- *     The other modules (LPDDRx) have not been updated to pass a knob to turn on/off REFpb.
+ * 2. Per-bank refresh (per_bank_refresh). DSARP uses its own REFpb command, the other standards
+ *     issue REF with Bank scope.
  * 3. A re-implementation of DSARP from the refresh mechanisms proposed in Chang et al.,
  * "Improving DRAM Performance by Parallelizing Refreshes with Accesses", HPCA 2014.
+ * 4. DARP (out-of-order per-bank refresh with postponing and pulling in refreshes) for the
+ *     standards that use the generic per-bank refresh (darp_refresh).
  *
  *  Created on: Mar 17, 2015
  *      Author: kevincha
@@ -17,6 +19,8 @@
 #define __REFRESH_H_
 
 #include <stddef.h>
+#include <stdlib.h>
+#include <algorithm>
 #include <cassert>
 #include <iostream>
 #include <vector>
@@ -42,6 +46,8 @@ public:
   vector<int> bank_ref_counters, bankgroup_ref_counters;
   int max_rank_count, max_bank_count, max_bg_count, max_bank_bg_count, max_bankgroup_count;
   int level_chan, level_rank, level_bg, level_bank, level_sa;
+  // DDR5 refreshes the same bank of all bank groups at once (REFsb) instead of a single bank
+  bool same_bank_refresh;
 
   // ctor
   Refresh(Controller<T>* ctrl) : ctrl(ctrl) {
@@ -49,18 +55,22 @@ public:
     max_rank_count = ctrl->channel->children.size();
     max_bank_count = ctrl->channel->spec->org_entry.count[(int)T::Level::Bank];
     max_bankgroup_count = ctrl->channel->spec->org_entry.count[(int)T::Level::BankGroup];
+    max_bank_bg_count = max_bank_count * max_bankgroup_count;
 
     // Init refresh counters
     for (int r = 0; r < max_rank_count; r++) {
       bank_ref_counters.push_back(0);
       bankgroup_ref_counters.push_back(0);
-      bank_refresh_backlog.push_back(new vector<int>(max_bank_count, 0));
+      bank_refresh_backlog.push_back(new vector<int>(max_bank_bg_count, 0));
     }
 
     level_chan = (int)T::Level::Channel;
     level_rank = (int)T::Level::Rank;
+    level_bg   = (int)T::Level::BankGroup;
     level_bank = (int)T::Level::Bank;
     level_sa   = -1; // Most DRAM doesn't have subarray level
+
+    same_bank_refresh = ctrl->channel->spec->standard_name == "DDR5";
   }
 
   // dtor
@@ -76,6 +86,14 @@ public:
 
     int refresh_interval = ctrl->channel->spec->speed_entry.nREFI;
 
+    // DARP: refresh idle banks out of order and parallelize refreshes with writebacks
+    if (ctrl->darp_refresh_on) {
+      if (!ctrl_write_mode && ctrl->write_mode)
+        wrp();
+      ctrl_write_mode = ctrl->write_mode;
+      early_inject_refresh();
+    }
+
     // Time to schedule a refresh
     if ((clk - refreshed) >= refresh_interval) {
       inject_refresh(!ctrl->per_bank_refresh_on);
@@ -132,32 +150,149 @@ private:
       for (auto rank : ctrl->channel->children)
         refresh_target(ctrl, rank->id, -1, -1, -1);
     }
+    // Same-bank refresh. A negative bank group id targets the bank in all bank groups
+    else if (same_bank_refresh) {
+      for (auto rank : ctrl->channel->children) {
+        refresh_target(ctrl, rank->id, -1, bank_ref_counters[rank->id], -1);
+        bank_ref_counters[rank->id] = (bank_ref_counters[rank->id] + 1) % max_bank_count;
+      }
+    }
     // Bank-level refresh. Simultaneously issue to all ranks (better performance than staggered refreshes).
     else {
       for (auto rank : ctrl->channel->children) {
-        refresh_target(ctrl, rank->id, bankgroup_ref_counters[rank->id], bank_ref_counters[rank->id], -1);
+        int rid = rank->id;
+        int bg = bankgroup_ref_counters[rid];
+        int bank = bank_ref_counters[rid];
+        int bid = bg * max_bank_count + bank;
+
         // Next time, refresh the next bank group
+        bankgroup_ref_counters[rid]++;
+
+        if (bankgroup_ref_counters[rid] == max_bankgroup_count) {
+          bankgroup_ref_counters[rid] = 0;
+          bank_ref_counters[rid] = (bank_ref_counters[rid] + 1) % max_bank_count;
+        }
 
-        bankgroup_ref_counters[rank->id]++;
+        // Behind refresh schedule by 1 ref
+        (*(bank_refresh_backlog[rid]))[bid]--;
 
-        if (bankgroup_ref_counters[rank->id] == max_bankgroup_count) {
-          bankgroup_ref_counters[rank->id] = 0;
-          bank_ref_counters[rank->id] = (bank_ref_counters[rank->id] + 1) % max_bank_count;
+        // DARP: postpone the refresh while the rank is serving reads, unless we run out of credits
+        if (ctrl->darp_refresh_on
+            && (is_refresh_pending(rid, -1) || ctrl->readq.size() > 0)
+            && (*(bank_refresh_backlog[rid]))[bid] > backlog_min) {
+          ctrl->num_ref_postponed++;
+          continue;
         }
+
+        refresh_target(ctrl, rid, bg, bank, -1);
+        // Get 1 ref credit
+        (*(bank_refresh_backlog[rid]))[bid]++;
       }
     }
     refreshed = clk;
   }
 
-  // DSARP
+  // Is there a REF in the queue for the rank (bid < 0) or for the bank bid of the rank?
+  bool is_refresh_pending(int rank, int bid) {
+    for (auto& req : ctrl->otherq.q)
+      if (req.type == Request::Type::REFRESH && req.addr_vec[level_rank] == rank
+          && (bid < 0 || (req.addr_vec[level_bg] * max_bank_count + req.addr_vec[level_bank]) == bid))
+        return true;
+    return false;
+  }
+
+  // DSARP and DARP
   void early_inject_refresh();
   void wrp();
 };
 
+// DARP: in read mode, refresh an idle bank (no pending reads) of each rank that is about to run out of
+// postponed refresh credits, so that its refresh does not have to be forced while the bank is busy
+template <typename T>
+void Refresh<T>::early_inject_refresh() {
+  if (ctrl->write_mode)
+    return;
+
+  vector<bool> is_bank_occupied(max_rank_count * max_bank_bg_count, false);
+  for (auto& req : ctrl->readq.q)
+    is_bank_occupied[req.addr_vec[level_rank] * max_bank_bg_count
+        + req.addr_vec[level_bg] * max_bank_count + req.addr_vec[level_bank]] = true;
+
+  for (int r = 0; r < max_rank_count; r++) {
+    // Randomly pick a bank to examine
+    int bidx_start = rand_r(&rand_seed) % max_bank_bg_count;
+
+    for (int b = 0; b < max_bank_bg_count; b++) {
+      int bidx = (bidx_start + b) % max_bank_bg_count;
+      if (is_bank_occupied[r * max_bank_bg_count + bidx] || is_refresh_pending(r, bidx))
+        continue;
+
+      // Only pull in refreshes when we are almost running out of credits
+      if ((*(bank_refresh_backlog[r]))[bidx] >= backlog_early_pull_threshold ||
+          ctrl->otherq.q.size() >= ctrl->otherq.max)
+        continue;
+
+      refresh_target(ctrl, r, bidx / max_bank_count, bidx % max_bank_count, -1);
+      (*(bank_refresh_backlog[r]))[bidx]++;
+      ctrl->num_ref_out_of_order++;
+      break;
+    }
+  }
+}
+
+// DARP: write-refresh parallelization. When the controller switches to writeback mode, refresh the bank
+// with the lowest demand in each rank ahead of schedule (up to backlog_max refreshes)
+template <typename T>
+void Refresh<T>::wrp() {
+  for (int r = 0; r < max_rank_count; r++) {
+    if (is_refresh_pending(r, -1))
+      continue;
+
+    // first = number of pending requests, second = bank idx
+    vector<pair<int, int>> bank_demand;
+    for (int b = 0; b < max_bank_bg_count; b++)
+      bank_demand.push_back(make_pair(0, b));
+
+    int total_wr = 0;
+    for (auto& req : ctrl->writeq.q) {
+      if (req.addr_vec[level_rank] == r) {
+        bank_demand[req.addr_vec[level_bg] * max_bank_count + req.addr_vec[level_bank]].first++;
+        total_wr++;
+      }
+    }
+    // If there's no write, just skip.
+    if (total_wr == 0)
+      continue;
+
+    for (auto& req : ctrl->readq.q)
+      if (req.addr_vec[level_rank] == r)
+        bank_demand[req.addr_vec[level_bg] * max_bank_count + req.addr_vec[level_bank]].first++;
+
+    stable_sort(bank_demand.begin(), bank_demand.end(),
+        [](const pair<int, int>& l, const pair<int, int>& rh) { return l.first < rh.first; });
+
+    // Randomly select one of the idle banks, or the least busy bank if there is no idle bank
+    int num_idle = 0;
+    while (num_idle < max_bank_bg_count && bank_demand[num_idle].first == 0)
+      num_idle++;
+    int bid = bank_demand[(num_idle == 0) ? 0 : rand_r(&rand_seed) % num_idle].second;
+
+    // Make sure we don't exceed the credit
+    if ((*(bank_refresh_backlog[r]))[bid] < backlog_max && ctrl->otherq.q.size() < ctrl->otherq.max) {
+      refresh_target(ctrl, r, bid / max_bank_count, bid % max_bank_count, -1);
+      (*(bank_refresh_backlog[r]))[bid]++;
+      ctrl->num_ref_out_of_order++;
+    }
+  }
+}
+
 // Declaration of specialized constructor and tick_ref, so the compiler knows
 // where to look for these definitions when controller calls them!
 template<> Refresh<DSARP>::Refresh(Controller<DSARP>* ctrl);
 template<> void Refresh<DSARP>::tick_ref();
+template<> void Refresh<DSARP>::inject_refresh(bool b_ref_rank);
+template<> void Refresh<DSARP>::early_inject_refresh();
+template<> void Refresh<DSARP>::wrp();
 
 } /* namespace ramulator */
 
@@ -0,0 +1,159 @@
+#include "ReplacementPolicy.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+#include <cstdlib>
+
+namespace ramulator
+{
+
+const int SRRIPPolicy::rrpv_max;
+const int DRRIPPolicy::psel_max;
+const int SHiPPolicy::shct_max;
+
+ReplacementPolicy* ReplacementPolicy::create(const std::string& name,
+    unsigned int num_sets, unsigned int assoc) {
+  if (name == "LRU") {
+    return new LRUPolicy(num_sets, assoc);
+  } else if (name == "SRRIP") {
+    return new SRRIPPolicy(num_sets, assoc);
+  } else if (name == "DRRIP") {
+    return new DRRIPPolicy(num_sets, assoc);
+  } else if (name == "SHiP") {
+    return new SHiPPolicy(num_sets, assoc);
+  }
+  printf("ERROR: Unknown cache replacement policy: %s\n", name.c_str());
+  assert(false && "ERROR: Unknown cache replacement policy.");
+  exit(1);
+}
+
+/**** LRU ****/
+
+LRUPolicy::LRUPolicy(unsigned int num_sets, unsigned int assoc):
+    ReplacementPolicy(num_sets, assoc),
+    ages(num_sets * assoc, 0), valid(num_sets * assoc, false),
+    set_sizes(num_sets, 0) {}
+
+void LRUPolicy::age_younger(int set, unsigned int age) {
+  for (unsigned int i = first_slot(set); i < first_slot(set) + assoc; i++) {
+    if (valid[i] && ages[i] > age) {
+      ages[i]--;
+    }
+  }
+}
+
+void LRUPolicy::insert(int set, int slot, long addr) {
+  assert(!valid[slot]);
+  valid[slot] = true;
+  ages[slot] = set_sizes[set]++;
+}
+
+void LRUPolicy::hit(int set, int slot) {
+  age_younger(set, ages[slot]);
+  ages[slot] = set_sizes[set] - 1;
+}
+
+void LRUPolicy::remove(int set, int slot, bool evicted) {
+  valid[slot] = false;
+  age_younger(set, ages[slot]);
+  set_sizes[set]--;
+}
+
+int LRUPolicy::victim(int set, const std::function<bool(int)>& evictable) {
+  // The least recently used line that can be evicted
+  int victim = -1;
+  for (unsigned int i = first_slot(set); i < first_slot(set) + assoc; i++) {
+    if ((victim < 0 || ages[i] < ages[victim]) && evictable(i)) {
+      victim = i;
+    }
+  }
+  return victim;
+}
+
+/**** SRRIP ****/
+
+SRRIPPolicy::SRRIPPolicy(unsigned int num_sets, unsigned int assoc):
+    ReplacementPolicy(num_sets, assoc),
+    rrpvs(num_sets * assoc, rrpv_max) {}
+
+void SRRIPPolicy::insert(int set, int slot, long addr) {
+  rrpvs[slot] = rrpv_max - 1;
+}
+
+void SRRIPPolicy::hit(int set, int slot) {
+  rrpvs[slot] = 0;
+}
+
+int SRRIPPolicy::victim(int set, const std::function<bool(int)>& evictable) {
+  // The first line with the largest RRPV that can be evicted
+  int victim = -1;
+  for (unsigned int i = first_slot(set); i < first_slot(set) + assoc; i++) {
+    if ((victim < 0 || rrpvs[i] > rrpvs[victim]) && evictable(i)) {
+      victim = i;
+    }
+  }
+  if (victim < 0) {
+    return victim;
+  }
+
+  // Age the set until the victim reaches the distant re-reference interval
+  int inc = rrpv_max - rrpvs[victim];
+  if (inc > 0) {
+    for (unsigned int i = first_slot(set); i < first_slot(set) + assoc; i++) {
+      rrpvs[i] = std::min(rrpvs[i] + inc, rrpv_max);
+    }
+  }
+  return victim;
+}
+
+int SRRIPPolicy::brrip_insertion_rrpv() {
+  bip_counter = (bip_counter + 1) % bip_epsilon;
+  return (bip_counter == 0) ? rrpv_max - 1 : rrpv_max;
+}
+
+/**** DRRIP ****/
+
+void DRRIPPolicy::insert(int set, int slot, long addr) {
+  // Every insertion follows a miss
+  bool use_brrip;
+  if (set % dueling_period == 0) {
+    use_brrip = false;
+    psel = std::min(psel + 1, psel_max);
+  } else if (set % dueling_period == 1) {
+    use_brrip = true;
+    psel = std::max(psel - 1, 0);
+  } else {
+    use_brrip = (psel > psel_max / 2);
+  }
+  rrpvs[slot] = use_brrip ? brrip_insertion_rrpv() : rrpv_max - 1;
+}
+
+/**** SHiP ****/
+
+SHiPPolicy::SHiPPolicy(unsigned int num_sets, unsigned int assoc):
+    SRRIPPolicy(num_sets, assoc),
+    shct(1 << shct_bits, 1), signatures(num_sets * assoc, 0),
+    reused(num_sets * assoc, false) {}
+
+void SHiPPolicy::insert(int set, int slot, long addr) {
+  signatures[slot] = get_signature(addr);
+  reused[slot] = false;
+  rrpvs[slot] = (shct[signatures[slot]] == 0) ? rrpv_max : rrpv_max - 1;
+}
+
+void SHiPPolicy::hit(int set, int slot) {
+  SRRIPPolicy::hit(set, slot);
+  if (!reused[slot]) {
+    reused[slot] = true;
+    shct[signatures[slot]] = std::min(shct[signatures[slot]] + 1, shct_max);
+  }
+}
+
+void SHiPPolicy::remove(int set, int slot, bool evicted) {
+  if (evicted && !reused[slot]) {
+    shct[signatures[slot]] = std::max(shct[signatures[slot]] - 1, 0);
+  }
+}
+
+} // namespace ramulator
@@ -0,0 +1,138 @@
+#ifndef __REPLACEMENT_POLICY_H
+#define __REPLACEMENT_POLICY_H
+
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace ramulator
+{
+
+// Replacement policy of a Cache. The policy tracks the lines of the
+// cache by slot (set * assoc + way) and is notified whenever a line is
+// inserted, hit, or removed. On a miss to a full set, the cache asks
+// the policy for a victim among the lines it is allowed to evict
+// (i.e., lines that are unlocked in this and the higher levels).
+class ReplacementPolicy {
+public:
+  ReplacementPolicy(unsigned int num_sets, unsigned int assoc):
+      num_sets(num_sets), assoc(assoc) {}
+  virtual ~ReplacementPolicy() {}
+
+  // A new line is allocated for a miss to addr
+  virtual void insert(int set, int slot, long addr) = 0;
+  // The line is accessed again (a hit or a writeback from a higher level)
+  virtual void hit(int set, int slot) = 0;
+  // The line leaves the cache. evicted is false for invalidations
+  virtual void remove(int set, int slot, bool evicted) = 0;
+  // Returns the slot of the victim or -1 if no line can be evicted.
+  // The set is full when the victim is requested.
+  virtual int victim(int set, const std::function<bool(int)>& evictable) = 0;
+
+  // Returns a policy by name: LRU, SRRIP, DRRIP, or SHiP
+  static ReplacementPolicy* create(const std::string& name,
+      unsigned int num_sets, unsigned int assoc);
+
+protected:
+  unsigned int num_sets;
+  unsigned int assoc;
+
+  unsigned int first_slot(int set) const {
+    return set * assoc;
+  }
+};
+
+// Least recently used. Each valid line has an age within its set: 0 is
+// the least recently used line and the number of valid lines minus one
+// is the most recently used line.
+class LRUPolicy : public ReplacementPolicy {
+public:
+  LRUPolicy(unsigned int num_sets, unsigned int assoc);
+
+  void insert(int set, int slot, long addr) override;
+  void hit(int set, int slot) override;
+  void remove(int set, int slot, bool evicted) override;
+  int victim(int set, const std::function<bool(int)>& evictable) override;
+
+protected:
+  std::vector<unsigned int> ages;
+  std::vector<bool> valid;
+  std::vector<unsigned int> set_sizes;
+
+  // Decrement the age of the valid lines younger than age
+  void age_younger(int set, unsigned int age);
+};
+
+// Static re-reference interval prediction (Jaleel et al., ISCA 2010)
+// with 2-bit re-reference prediction values (RRPVs) and hit priority
+// promotion. New lines are inserted with a long re-reference interval.
+class SRRIPPolicy : public ReplacementPolicy {
+public:
+  SRRIPPolicy(unsigned int num_sets, unsigned int assoc);
+
+  void insert(int set, int slot, long addr) override;
+  void hit(int set, int slot) override;
+  void remove(int set, int slot, bool evicted) override {}
+  int victim(int set, const std::function<bool(int)>& evictable) override;
+
+protected:
+  static const int rrpv_max = 3;
+  std::vector<int> rrpvs;
+
+  // Bimodal RRIP insertion: distant re-reference interval except for
+  // one in bip_epsilon insertions
+  static const int bip_epsilon = 32;
+  unsigned int bip_counter = 0;
+  int brrip_insertion_rrpv();
+};
+
+// Dynamic RRIP. Set dueling between SRRIP and bimodal RRIP (BRRIP)
+// insertion: 1/32 of the sets always use SRRIP, another 1/32 always
+// use BRRIP, and the other sets follow the policy with fewer misses
+// in its leader sets.
+class DRRIPPolicy : public SRRIPPolicy {
+public:
+  DRRIPPolicy(unsigned int num_sets, unsigned int assoc):
+      SRRIPPolicy(num_sets, assoc) {}
+
+  void insert(int set, int slot, long addr) override;
+
+protected:
+  static const int psel_max = (1 << 10) - 1;
+  // Incremented on SRRIP leader set misses, decremented on BRRIP leader
+  // set misses. The followers use BRRIP when the MSB is set
+  int psel = (psel_max + 1) / 2;
+
+  static const int dueling_period = 32;
+};
+
+// Signature-based hit predictor (Wu et al., MICRO 2011) on top of
+// SRRIP. The traces do not carry PCs, so the signature is the memory
+// region of the line (SHiP-Mem). Lines from regions that were not
+// reused are inserted with a distant re-reference interval.
+class SHiPPolicy : public SRRIPPolicy {
+public:
+  SHiPPolicy(unsigned int num_sets, unsigned int assoc);
+
+  void insert(int set, int slot, long addr) override;
+  void hit(int set, int slot) override;
+  void remove(int set, int slot, bool evicted) override;
+
+protected:
+  static const int region_bits = 14; // 16KB regions
+  static const int shct_bits = 14;
+  static const int shct_max = 3; // 2-bit saturating counters
+  // Signature history counter table
+  std::vector<int> shct;
+  std::vector<unsigned int> signatures;
+  std::vector<bool> reused;
+
+  unsigned int get_signature(long addr) const {
+    long region = addr >> region_bits;
+    return (region ^ (region >> shct_bits)) & ((1 << shct_bits) - 1);
+  }
+};
+
+} // namespace ramulator
+
+#endif /* __REPLACEMENT_POLICY_H */
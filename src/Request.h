@@ -25,6 +25,7 @@ public:
 
     long long req_unique_id = -1; // a unique ID for tracking individual requests for debugging purposes
     bool partially_nacked = false; // a flag to indicate if a request has been partially nacked before
+    bool from_prefetcher = false; // issued by a prefetcher, so no core owns it even after a demand access upgrades it
 
     enum class Type
     {
@@ -40,6 +41,7 @@ public:
         REF_STATUS_QUERY,
         ACT_NACK,
         ACT_PARTIAL_NACK,
+        RFM,
         MAX
     } type;
 
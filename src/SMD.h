@@ -6,6 +6,8 @@
 #include <numeric>
 #include <algorithm>
 #include <random>
+#include <limits>
+#include <unordered_map>
 #include "Config.h"
 #include "Controller.h"
 #include "BloomFilter.h"
@@ -18,13 +20,6 @@ namespace ramulator
 {
 
 
-static uint32_t ref_tracker_timeout_period = 0; // After the SMDTracker queries a bank's refresh status, 
-                                                // the corresponding MaintenanceMachine cannot lock another SA in the same bank until this period has passed since the query
-                                                // At the same time, this defines the time interval for which a SMDTracker entry remains active and after
-                                                // which the entry becomes outdated 
-
-static uint32_t scrub_tracker_timeout_period = 0;
-
 typedef enum {
     RSQ,
     ALERT,
@@ -59,38 +54,40 @@ public:
     GrapheneCounterTable(const uint32_t num_counters, const uint32_t act_threshold) : 
         num_counters(num_counters), act_threshold(act_threshold) {}
 
-    bool increment (const uint32_t row_id) {
+    // a weight larger than one counts multiple activations at once (e.g., RowPress). Returns true if the row's counter crossed a multiple of act_threshold
+    bool increment (const uint32_t row_id, const uint32_t weight = 1) {
 
         assert(counters.size() <= num_counters);
 
         if (counters.find(row_id) != counters.end()) {
             // row_id is already in the counter table
-            counters[row_id]++;
+            uint32_t old_value = counters[row_id];
+            counters[row_id] += weight;
 
-            return (counters[row_id] % act_threshold) == 0; // return true if counter value is multiples of act_threshold
+            return crossed_threshold(old_value, counters[row_id]);
         }
 
         // row_id is not in the counter table
         if (counters.size() < num_counters) {
             // there are unused counters. Insert the row
-            counters[row_id] = 1;
-            return false;
+            counters[row_id] = weight;
+            return crossed_threshold(0, weight);
         }
 
         std::map<uint32_t, uint32_t>::iterator min_counter = get_min_counter();
 
         if(min_counter->second != spillover_counter) {
             // incrementing the spillover counter since it is smaller than the smallest entry in the counter table
-            spillover_counter++;
+            spillover_counter += weight;
             return false;
         }
 
         assert(min_counter->second == spillover_counter);
         // replace min_counter with the new row
         counters.erase(min_counter);
-        counters[row_id] = spillover_counter + 1;
+        counters[row_id] = spillover_counter + weight;
 
-        return (counters[row_id] % act_threshold) == 0; // return true if counter value is multiples of act_threshold
+        return crossed_threshold(spillover_counter, counters[row_id]);
     }
 
     void reset () {
@@ -107,13 +104,310 @@ private:
     std::map<uint32_t, uint32_t>::iterator get_min_counter() {
         return std::min_element(counters.begin(), counters.end());
     }
+
+    bool crossed_threshold(const uint32_t old_value, const uint32_t new_value) const {
+        return (old_value / act_threshold) != (new_value / act_threshold); // true if the counter reached a new multiple of act_threshold
+    }
+};
+
+// a small fully-associative table with exact activation counters for recently detected aggressor rows. Uses LRU replacement
+class RecentAggressorTable {
+public:
+    RecentAggressorTable(const uint32_t num_entries) : entries(num_entries) {
+        assert(num_entries > 0 && "[RecentAggressorTable] ERROR: the table should have at least one entry.");
+    }
+
+    // returns the activation counter of the row or nullptr if the row is not in the table
+    uint32_t* find(const uint32_t row_key) {
+        for (auto& e : entries) {
+            if (e.valid && e.row_key == row_key) {
+                e.last_use = ++use_counter;
+                return &e.count;
+            }
+        }
+
+        return nullptr;
+    }
+
+    // returns true if a valid entry is evicted
+    bool insert(const uint32_t row_key) {
+        auto victim = std::min_element(entries.begin(), entries.end(), 
+            [](const Entry& e1, const Entry& e2) { return (e1.valid ? e1.last_use + 1 : 0) < (e2.valid ? e2.last_use + 1 : 0); });
+
+        bool evicted = victim->valid;
+
+        victim->valid = true;
+        victim->row_key = row_key;
+        victim->count = 0;
+        victim->last_use = ++use_counter;
+
+        return evicted;
+    }
+
+    void reset() {
+        for (auto& e : entries)
+            e.valid = false;
+    }
+
+private:
+    typedef struct Entry {
+        bool valid = false;
+        uint32_t row_key = 0;
+        uint32_t count = 0;
+        uint64_t last_use = 0;
+    } Entry;
+
+    std::vector<Entry> entries;
+    uint64_t use_counter = 0;
+};
+
+// a fixed-capacity FIFO of RowAddrs that rejects duplicates in constant time
+// the entries are kept in a ring buffer and indexed by an open-addressed (linear probing) hash set
+class HashedRowAddrQueue {
+public:
+    HashedRowAddrQueue(const uint32_t capacity) : ring(capacity) {
+        assert(capacity > 0 && "[HashedRowAddrQueue] ERROR: the queue capacity should be positive.");
+
+        // keeping the load factor of the hash set at or below 0.5
+        uint32_t num_slots = 1;
+        while (num_slots < 2*capacity)
+            num_slots <<= 1;
+
+        slots = std::vector<Slot>(num_slots);
+        slot_mask = num_slots - 1;
+    }
+
+    bool contains(const RowAddr& ra) const {
+        return slots[find_slot(ra)].valid;
+    }
+
+    // returns false if the queue is full
+    bool push(const RowAddr& ra) {
+        if (full())
+            return false;
+
+        Slot& slot = slots[find_slot(ra)];
+        assert(!slot.valid && "[HashedRowAddrQueue] ERROR: RowAddr is already in the queue.");
+        slot.ra = ra;
+        slot.valid = true;
+
+        ring[(head + count) % ring.size()] = ra;
+        count++;
+
+        return true;
+    }
+
+    const RowAddr& front() const {
+        assert(!empty());
+        return ring[head];
+    }
+
+    void pop() {
+        assert(!empty());
+        erase_slot(find_slot(ring[head]));
+        head = (head + 1) % ring.size();
+        count--;
+    }
+
+    uint32_t size() const { return count; }
+    uint32_t capacity() const { return ring.size(); }
+    bool empty() const { return count == 0; }
+    bool full() const { return count == ring.size(); }
+
+private:
+    typedef struct Slot {
+        RowAddr ra;
+        bool valid = false;
+    } Slot;
+
+    std::vector<RowAddr> ring;
+    uint32_t head = 0;
+    uint32_t count = 0;
+
+    std::vector<Slot> slots;
+    uint32_t slot_mask;
+
+    uint32_t hash(const RowAddr& ra) const {
+        uint64_t h = (uint64_t(ra.bank_gid) << 48) ^ (uint64_t(ra.sa_id) << 32) ^ ra.row_id;
+
+        // MurmurHash3 64-bit finalizer
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdULL;
+        h ^= h >> 33;
+        h *= 0xc4ceb9fe1a85ec53ULL;
+        h ^= h >> 33;
+
+        return uint32_t(h) & slot_mask;
+    }
+
+    // returns the slot that holds ra or, if ra is not in the set, the empty slot where ra would be inserted
+    uint32_t find_slot(const RowAddr& ra) const {
+        uint32_t i = hash(ra);
+        while (slots[i].valid && !(slots[i].ra == ra))
+            i = (i + 1) & slot_mask;
+
+        return i;
+    }
+
+    // backward-shift deletion. Keeps the probe sequences intact without using tombstones
+    void erase_slot(uint32_t i) {
+        uint32_t j = i;
+        while (true) {
+            j = (j + 1) & slot_mask;
+            if (!slots[j].valid)
+                break;
+
+            // slots[j] can fill the hole at i only if its home slot is not cyclically in (i, j]
+            uint32_t home = hash(slots[j].ra);
+            bool home_in_range = (i <= j) ? (i < home && home <= j) : (i < home || home <= j);
+            if (!home_in_range) {
+                slots[i] = slots[j];
+                i = j;
+            }
+        }
+
+        slots[i].valid = false;
+    }
+};
+
+// the maintenance locks of a single bank
+typedef struct SALock {
+    std::vector<uint32_t> sa_ids; // the locked SAs. With MASA-style SA-level parallelism, multiple SAs of a bank can be under maintenance at the same time
+    long cooldown_exp = -1;
+    bool bank_locked = false;
+
+    bool is_locked() const {
+        return !sa_ids.empty();
+    }
+
+    bool is_locked(const uint32_t sa_id) const {
+        return std::find(sa_ids.cbegin(), sa_ids.cend(), sa_id) != sa_ids.cend();
+    }
+} SALock;
+
+// predicts the SAs that the memory controller accesses in the near future from the recent row activations and the requests in the request buffer.
+// In ACT_NACK mode, a MaintenanceMachine defers maintenance in such a hot SA as long as the maintenance backlog of the bank is within the slack
+class SMDAccessPredictor {
+    public:
+        void init(const Config& configs, const int channel_id, const uint32_t num_ranks, const uint32_t banks_per_rank, const uint32_t SAs_per_bank) {
+            enabled = configs.get_bool("smd_predictive_maint");
+            hot_window = configs.get_uint("smd_predictive_maint_window");
+            defer_slack = configs.get_uint("smd_predictive_maint_slack");
+            _banks_per_rank = banks_per_rank;
+            _SAs_per_bank = SAs_per_bank;
+
+            assert((!enabled || defer_slack < configs.get_uint("smd_pending_ref_limit")) && "[SMDAccessPredictor] ERROR: smd_predictive_maint_slack should be smaller than smd_pending_ref_limit.");
+            // in RSQ and ALERT modes, the memory controller learns the locked SAs and schedules around them. Deferring maintenance there only wastes the lock opportunities
+            assert((!enabled || configs.get_str("smd_mode") == "ACT_NACK") && "[SMDAccessPredictor] ERROR: smd_predictive_maint is supported only in ACT_NACK mode.");
+
+            if (enabled) {
+                last_act_clk.resize(num_ranks*banks_per_rank*SAs_per_bank, -(long)hot_window);
+                last_queued_clk.resize(num_ranks*banks_per_rank*SAs_per_bank, -1);
+            }
+
+            deferred_maint
+                .name("smd_predictive_deferred_maint_" + std::to_string(channel_id))
+                .desc("The number of times a MaintenanceMachine deferred maintenance in an SA predicted to be accessed soon.")
+                .precision(0)
+            ;
+        }
+
+        bool is_enabled() const {
+            return enabled;
+        }
+
+        void record_activation(const uint32_t rank_id, const uint32_t bank_id, const uint32_t sa_id, const long clk) {
+            last_act_clk[get_SA_ind(rank_id, bank_id, sa_id)] = clk;
+        }
+
+        // called every cycle for each request in the request buffer
+        void record_queued_req(const uint32_t rank_id, const uint32_t bank_id, const uint32_t sa_id, const long clk) {
+            last_queued_clk[get_SA_ind(rank_id, bank_id, sa_id)] = clk;
+        }
+
+        bool is_hot(const uint32_t rank_id, const uint32_t bank_id, const uint32_t sa_id, const long clk) const {
+            uint32_t ind = get_SA_ind(rank_id, bank_id, sa_id);
+            return (last_queued_clk[ind] == clk) || (clk - last_act_clk[ind] < hot_window);
+        }
+
+        bool defer_maint(const uint32_t rank_id, const uint32_t bank_id, const uint32_t sa_id, const uint32_t pending_maint, const long clk) {
+            if (!enabled || pending_maint > defer_slack || !is_hot(rank_id, bank_id, sa_id, clk))
+                return false;
+
+            deferred_maint++;
+            return true;
+        }
+
+    private:
+        uint32_t get_SA_ind(const uint32_t rank_id, const uint32_t bank_id, const uint32_t sa_id) const {
+            return (rank_id*_banks_per_rank + bank_id)*_SAs_per_bank + sa_id;
+        }
+
+        bool enabled = false;
+        long hot_window = 0; // an SA activated in the last hot_window cycles is likely to be activated again
+        uint32_t defer_slack = 0; // maintenance in a hot SA is deferred until the bank has more than this many pending operations
+        uint32_t _banks_per_rank = 0;
+        uint32_t _SAs_per_bank = 0;
+
+        std::vector<long> last_act_clk;
+        std::vector<long> last_queued_clk;
+
+        ScalarStat deferred_maint;
 };
 
+// SMD state shared by all MaintenancePolicies and SMDTrackers of a single memory controller (i.e., channel)
+// each Controller owns one SMDContext, so multiple Memory instances can coexist in the same process
+typedef struct SMDContext {
+    std::vector<std::vector<std::vector<SALock>>> locked_SAs; // [rank][chip][bank]. A chip has its own locks shared by all maintenance mechanisms
+
+    uint32_t ref_tracker_timeout_period = 0; // After the SMDTracker queries a bank's refresh status, 
+                                             // the corresponding MaintenanceMachine cannot lock another SA in the same bank until this period has passed since the query
+                                             // At the same time, this defines the time interval for which a SMDTracker entry remains active and after
+                                             // which the entry becomes outdated. The scrubbing SMDTracker uses the same
+                                             // period since all maintenance mechanisms of a chip share its SA locks
+
+    SMDAccessPredictor access_predictor;
+
+    ScalarStat maint_blocked_by_bank_lock; // maintenance attempts that found the target bank at its limit of locked SAs
+    ScalarStat concurrent_SA_locks; // SAs locked while another SA of the same bank was already under maintenance
+
+    void reg_stats(const int channel_id) {
+        maint_blocked_by_bank_lock
+            .name("smd_maint_blocked_by_bank_lock_" + std::to_string(channel_id))
+            .desc("The number of maintenance attempts delayed since other SAs of the target bank were under maintenance.")
+            .precision(0)
+        ;
+
+        concurrent_SA_locks
+            .name("smd_concurrent_SA_locks_" + std::to_string(channel_id))
+            .desc("The number of SAs locked for maintenance while another SA of the same bank was under maintenance.")
+            .precision(0)
+        ;
+    }
+
+    std::vector<SALock>& get_locked_SAs(const uint32_t rank_id, const uint32_t chip_id) {
+        return locked_SAs[rank_id][chip_id];
+    }
+
+    // allocates the locks of a chip if they do not exist yet. Called by every MaintenancePolicy of the chip
+    void init_locked_SAs(const uint32_t rank_id, const uint32_t chip_id, const uint32_t num_banks_in_chip) {
+        if (rank_id >= locked_SAs.size())
+            locked_SAs.resize(rank_id + 1);
+
+        if (chip_id >= locked_SAs[rank_id].size())
+            locked_SAs[rank_id].resize(chip_id + 1);
+
+        if (locked_SAs[rank_id][chip_id].empty())
+            locked_SAs[rank_id][chip_id].resize(num_banks_in_chip);
+    }
+} SMDContext;
+
 template <typename T>
 class SMDTracker {
 
     typedef struct MSTEntry {
         std::vector<uint32_t> busy_SAs;
+        long valid_until = -1; // used only in ALERT mode. The entry describes a maintenance operation that completes by this clk
         MSTEntry() {}
     } MSTEntry; // MST -> Maintenance Status Table
 
@@ -133,6 +427,8 @@ class SMDTracker {
         const T& spec = *(ctrl.channel->spec);
 
         auto total_num_banks = spec.get_num_all_banks();
+        banks_per_rank = spec.get_num_banks_per_rank();
+        uint32_t num_ranks = spec.org_entry.count[uint32_t(T::Level::Rank)];
 
         chips_per_rank = spec.channel_width/spec.org_entry.dq;
 
@@ -140,25 +436,28 @@ class SMDTracker {
         maint_status = std::vector<MST>(chips_per_rank, MST(total_num_banks));
         inflight_reqs = std::vector<bool>(total_num_banks, false);
         last_update_clk = std::vector<long>(total_num_banks, -1);
+
+        last_alert_clk = std::vector<long>(num_ranks, -1);
+        last_alert_query_clk = std::vector<long>(num_ranks, -1);
     }
 
     void print() {
 
         auto total_num_banks = ctrl.channel->spec->get_num_all_banks();
 
-        for (uint bank_id = 0; bank_id < total_num_banks; bank_id++) {
-            std::cout << "Bank " << bank_id << ": ";
+        for (uint bank_ind = 0; bank_ind < total_num_banks; bank_ind++) {
+            std::cout << "Rank " << bank_ind/banks_per_rank << " Bank " << bank_ind%banks_per_rank << ": ";
             for(auto& ms : maint_status) {
 
-                if(is_bank_timed_out(bank_id))
+                if(is_bank_timed_out(bank_ind/banks_per_rank, bank_ind%banks_per_rank))
                     std::cout << "*";
 
-                if (ms.entries[bank_id].busy_SAs.size() == 1) {
-                    std::cout << ms.entries[bank_id].busy_SAs[0] << " ";
+                if (ms.entries[bank_ind].busy_SAs.size() == 1) {
+                    std::cout << ms.entries[bank_ind].busy_SAs[0] << " ";
                     continue;
                 }
                 
-                if (ms.entries[bank_id].busy_SAs.size() == 0)
+                if (ms.entries[bank_ind].busy_SAs.size() == 0)
                     std::cout << "- ";
                 else
                     std::cout << "+ ";
@@ -170,27 +469,33 @@ class SMDTracker {
     
     int can_open(const std::vector<int>& addr_vec) const {
 
+        uint32_t rank_id = addr_vec[uint32_t(T::Level::Rank)];
         uint32_t global_bank_id = ctrl.channel->spec->calc_global_bank_id(addr_vec);
         // uint32_t sa_id = addr_vec[uint32_t(T::Level::Row)]/ctrl.channel->spec->get_subarray_size();
         uint32_t sa_id = addr_vec[uint32_t(T::Level::Subarray)];
 
-        return can_open(global_bank_id, sa_id);
+        return can_open(rank_id, global_bank_id, sa_id);
     }
 
-    int can_open(const uint32_t global_bank_id, const uint32_t sa_id) const {
+    int can_open(const uint32_t rank_id, const uint32_t global_bank_id, const uint32_t sa_id) const {
 
         // std::cout << "[SMD] The target subarray is available for access!" << std::endl;
 
-        return can_access_SA(ctrl.clk, SubarrayAddr(global_bank_id, sa_id));
+        return can_access_SA(ctrl.clk, rank_id, SubarrayAddr(global_bank_id, sa_id));
     }
 
-    void update(const uint32_t chip_id, const uint32_t global_bank_id, const std::vector<uint32_t>& busy_SAs) {
+    // maint_window is the longest time a chip keeps an SA locked. It is used only in ALERT mode 
+    // where the memory controller learns about a lock only once, when the chip asserts its alert signal
+    void update(const uint32_t rank_id, const uint32_t chip_id, const uint32_t global_bank_id, const std::vector<uint32_t>& busy_SAs, 
+            const uint32_t maint_window = 0) {
+
+        uint32_t bank_ind = get_bank_ind(rank_id, global_bank_id);
 
         if(smd_mode == SMD_MODE::RSQ){
-            MSTEntry& entry = maint_status[chip_id].entries[global_bank_id];
+            MSTEntry& entry = maint_status[chip_id].entries[bank_ind];
             entry.busy_SAs = busy_SAs;
 
-            last_update_clk[global_bank_id] = ctrl.clk;
+            last_update_clk[bank_ind] = ctrl.clk;
 
             // std::cout << "[SMDTracker] clk: " << ctrl.clk << " Updating SMD Ref Status. global_bank: " << global_bank_id;
             // if (busy_SAs.size() > 0) {
@@ -203,16 +508,32 @@ class SMDTracker {
             //     std::cout << ". No busy SAs" << std::endl;
             // }
         } else if (smd_mode == SMD_MODE::ALERT) {
-            assert(false && "ERROR: Incomplete implementation!");
-            // ref_status_alert[chip_id].busy_SAs = busy_SAs;
+            MSTEntry& entry = maint_status[chip_id].entries[bank_ind];
+            entry.busy_SAs = busy_SAs;
 
+            // A chip asserts alert when it locks an SA, so every SA reported as busy was locked at or before last_alert_clk.
+            // Keeping the entry until last_alert_clk + maint_window is thus conservative and never unblocks an SA early
+            entry.valid_until = busy_SAs.empty() ? -1 : last_alert_clk[rank_id] + maint_window;
+
+            last_update_clk[bank_ind] = ctrl.clk;
         } else 
             assert(false && "ERROR: Unimplemented SMD_MODE!");
     }
 
     void update_alert_clk(const uint32_t rank_id) {
-        assert(false && "ERROR: Incomplete implementation!");
-        //last_alert_clk[rank_id] = ctrl.clk;
+        assert(smd_mode == SMD_MODE::ALERT);
+        last_alert_clk[rank_id] = ctrl.clk;
+    }
+
+    // called when the response to a query issued at query_clk arrives. The response covers all alerts asserted until query_clk
+    void resolve_alert(const uint32_t rank_id, const long query_clk) {
+        assert(smd_mode == SMD_MODE::ALERT);
+        last_alert_query_clk[rank_id] = std::max(last_alert_query_clk[rank_id], query_clk);
+    }
+
+    // an alert is outstanding until the memory controller receives the response of a query issued after the alert
+    bool is_alert_outstanding(const uint32_t rank_id) const {
+        return last_alert_clk[rank_id] > last_alert_query_clk[rank_id];
     }
 
 
@@ -222,13 +543,13 @@ class SMDTracker {
         auto req_banks = ctrl.get_reqbuffer_banks(rank_id);
 
         for (auto& bank_gid : req_banks) {
-            if (is_bank_timed_out(bank_gid) && !exists_inflight_req(bank_gid))
+            if (is_bank_timed_out(rank_id, bank_gid) && !exists_inflight_req(rank_id, bank_gid))
                 return bank_gid;
         }
 
         // return the first bank that is timed out and thus requires an update
-        // for (uint32_t bank_gid = 0; bank_gid < last_update_clk.size(); bank_gid++) {
-        //     if (is_bank_timed_out(bank_gid) && !exists_inflight_req(bank_gid)) {
+        // for (uint32_t bank_gid = 0; bank_gid < banks_per_rank; bank_gid++) {
+        //     if (is_bank_timed_out(rank_id, bank_gid) && !exists_inflight_req(rank_id, bank_gid)) {
         //         return bank_gid;
         //     }
         // }
@@ -236,35 +557,54 @@ class SMDTracker {
         return -1; // return -1 if no bank needs a ref status update
     }
 
-    void mark_inflight_req(const uint32_t bank_gid) {
-        inflight_reqs[bank_gid] = true;
+    void mark_inflight_req(const uint32_t rank_id, const uint32_t bank_gid) {
+        inflight_reqs[get_bank_ind(rank_id, bank_gid)] = true;
     }
 
-    void unmark_inflight_req(const uint32_t bank_gid) {
-        inflight_reqs[bank_gid] = false;
+    void unmark_inflight_req(const uint32_t rank_id, const uint32_t bank_gid) {
+        inflight_reqs[get_bank_ind(rank_id, bank_gid)] = false;
     }
 
     
     private:
 
-        bool exists_inflight_req(const uint32_t bank_gid) const {
-            return inflight_reqs[bank_gid];
+        // calc_global_bank_id() does not account for the rank. The MSTs keep the banks of all ranks in the channel
+        uint32_t get_bank_ind(const uint32_t rank_id, const uint32_t bank_gid) const {
+            return rank_id*banks_per_rank + bank_gid;
+        }
+
+        bool exists_inflight_req(const uint32_t rank_id, const uint32_t bank_gid) const {
+            return inflight_reqs[get_bank_ind(rank_id, bank_gid)];
         }
 
-        bool is_bank_timed_out(const uint32_t bank_gid) const {
-            return last_update_clk[bank_gid] < 0 || (std::abs(ctrl.clk - last_update_clk[bank_gid]) > ref_tracker_timeout_period);
+        bool is_bank_timed_out(const uint32_t rank_id, const uint32_t bank_gid) const {
+            // in ALERT mode, the chips notify the memory controller about every new lock. So, the entries do not time out
+            if (smd_mode == SMD_MODE::ALERT)
+                return false;
+
+            long update_clk = last_update_clk[get_bank_ind(rank_id, bank_gid)];
+            return update_clk < 0 || (std::abs(ctrl.clk - update_clk) > ctrl.smd_ctx.ref_tracker_timeout_period);
         }
 
-        int can_access_SA(const long clk, const SubarrayAddr& sa_addr) const {
+        int can_access_SA(const long clk, const uint32_t rank_id, const SubarrayAddr& sa_addr) const {
             
             // the entries should not be timed out
-            if(is_bank_timed_out(sa_addr.bank_gid))
+            if(is_bank_timed_out(rank_id, sa_addr.bank_gid))
+                return -1;
+
+            // the memory controller does not know which SA got locked until it reads the maintenance status of the alerting rank
+            if(smd_mode == SMD_MODE::ALERT && is_alert_outstanding(rank_id))
                 return -1;
 
+            uint32_t bank_ind = get_bank_ind(rank_id, sa_addr.bank_gid);
 
             // no chip should be refreshing the target SA
             for (const auto& ms : maint_status) {
-                const auto& entry = ms.entries[sa_addr.bank_gid];
+                const auto& entry = ms.entries[bank_ind];
+
+                if(smd_mode == SMD_MODE::ALERT && entry.valid_until < clk)
+                    continue; // the maintenance operation reported by this entry is already complete
+
                 if(std::find(entry.busy_SAs.cbegin(), entry.busy_SAs.cend(), sa_addr.sa_id) != entry.busy_SAs.cend())
                     return -2; // found a chip that refreshes the target subarray
             }
@@ -278,9 +618,106 @@ class SMDTracker {
         std::vector<bool> inflight_reqs;
         std::vector<long> last_update_clk;
 
+        // ALERT mode
+        std::vector<long> last_alert_clk; // per rank. The last clk when any chip in the rank asserted alert
+        std::vector<long> last_alert_query_clk; // per rank. The issue clk of the last query whose response has arrived
+
+        uint32_t banks_per_rank;
         uint32_t chips_per_rank;
 };
 
+typedef struct MaintenanceCounter {
+    uint32_t bank_id; // each bank has one refresh counter
+    uint32_t row_counter; // the row to refresh with the next REF operation
+    uint32_t sa_counter; // the SA to refresh with the next REF operation
+    uint64_t rollbacks; // the number of times this counter started over
+    uint32_t pending_maint; // the number REFs that are awaiting turn to be performed on the bank the MaintenanceCounter is responsible for
+    MaintenanceCounter(const uint32_t bank_id) : bank_id(bank_id) {
+        row_counter = 0;
+        sa_counter = 0;
+        rollbacks = 0;
+        pending_maint = 0;
+    }
+
+    // We'd probably like to start ecc scrubbing operations at a different subarray than refresh operations
+    // so they are not overlapped in case the refresh and ecc intervals are the same?
+    MaintenanceCounter(const uint32_t bank_id, const uint32_t sa_offset) : bank_id(bank_id), sa_counter(sa_offset) {
+        row_counter = 0;
+        rollbacks = 0;
+        pending_maint = 0;
+    }
+
+    MaintenanceCounter() : MaintenanceCounter(0){}
+    MaintenanceCounter& operator=(const MaintenanceCounter& other) {
+        bank_id = other.bank_id;
+        row_counter = other.row_counter;
+        sa_counter = other.sa_counter;
+        rollbacks = other.rollbacks;
+        pending_maint = other.pending_maint;
+
+        return *this;
+    }
+
+    void increment(const uint32_t num_SAs, const uint32_t num_rows, const uint32_t incr_val) {
+        if(sa_counter == (num_SAs - 1)) {
+            sa_counter = 0;
+
+            auto old_row_counter = row_counter;
+            row_counter = (row_counter + incr_val) % num_rows;
+
+            if (old_row_counter > row_counter)
+                rollbacks++;
+
+            return;
+        }
+        sa_counter++;
+    }
+
+    void set(const RowAddr& ra) {
+        bank_id = ra.bank_gid;
+        sa_counter = ra.sa_id;
+        row_counter = ra.row_id;
+    }
+} MaintenanceCounter;
+
+// the rows a maintenance operation restores: [first_row, last_row) of an SA, except skip_row (the aggressor row of a neighbor row refresh)
+typedef struct MaintRows {
+    uint32_t bank_id;
+    uint32_t sa_id;
+    uint32_t first_row;
+    uint32_t last_row;
+    int skip_row;
+    MaintRows(const uint32_t bank_id, const uint32_t sa_id, const uint32_t first_row, const uint32_t last_row, const int skip_row = -1) : 
+        bank_id(bank_id), sa_id(sa_id), first_row(first_row), last_row(last_row), skip_row(skip_row) {}
+
+    uint32_t size() const {
+        return last_row - first_row - (contains(skip_row) ? 1 : 0);
+    }
+
+    // the number of rows of other that this operation also restores
+    uint32_t count_covered(const MaintRows& other) const {
+        if (bank_id != other.bank_id || sa_id != other.sa_id)
+            return 0;
+
+        uint32_t lo = std::max(first_row, other.first_row);
+        uint32_t hi = std::min(last_row, other.last_row);
+        if (hi <= lo)
+            return 0;
+
+        uint32_t covered = hi - lo;
+        if (skip_row >= (int)lo && skip_row < (int)hi)
+            covered--;
+        if (other.skip_row != skip_row && other.skip_row >= (int)lo && other.skip_row < (int)hi)
+            covered--;
+
+        return covered;
+    }
+
+    bool contains(const int row) const {
+        return row >= (int)first_row && row < (int)last_row;
+    }
+} MaintRows;
+
 template <typename T>
 class MaintenanceMachine;
 
@@ -293,13 +730,6 @@ class NeighborRowRefreshMachine;
 template <typename T>
 class ECCScrubbingMachine;
 
-typedef struct SALock {
-    bool locked = false;
-    long cooldown_exp = -1;
-    uint32_t sa_id;
-    bool bank_locked = false;
-} SALock;
-
 // this is a base class. Every CR-DRAM chip implements a MaintenancePolicy
 template <typename T>
 class MaintenancePolicy {
@@ -314,8 +744,16 @@ class MaintenancePolicy {
             const uint32_t num_banks_in_chip, const uint32_t SAs_per_bank, const uint32_t num_rows) : ctrl(ctrl) {
 
             pending_maint_limit = configs.get_uint("smd_pending_ref_limit");
+            coalesce_maint_enabled = configs.get_bool("smd_coalesce_maint");
             smd_mode = str_to_smd_mode[configs.get_str("smd_mode")];
+            adaptive_maint_machines = configs.get_bool("smd_adaptive_maint_machines");
+            max_maint_machines = std::min(configs.get_uint("smd_max_maint_machines"), num_banks_in_chip);
+            maint_machines_shrink_intervals = configs.get_uint("smd_maint_machines_shrink_intervals");
+            max_locked_SAs_per_bank = configs.get_uint("smd_max_locked_SAs_per_bank");
+            assert(max_locked_SAs_per_bank > 0 && max_locked_SAs_per_bank <= SAs_per_bank && "[MaintenancePolicy] ERROR: smd_max_locked_SAs_per_bank should be between 1 and the number of SAs in a bank.");
             _num_banks_in_chip = num_banks_in_chip;
+            while ((1u << _bank_id_bits) < num_banks_in_chip)
+                _bank_id_bits++;
             _num_SAs_per_bank = SAs_per_bank;
             _num_rows = num_rows;
             _rank_id = rank_id;
@@ -323,16 +761,7 @@ class MaintenancePolicy {
             channel = ctrl->channel;
 
             // a chip has its own locked_SAs structure shared by all maintenance mechanisms
-            ind_locked_SAs = ctrl->channel->id*ctrl->channel->spec->org_entry.count[uint32_t(T::Level::Rank)] + rank_id;
-
-            while (ind_locked_SAs >= locked_SAs.size())
-                locked_SAs.push_back(std::vector<std::vector<SALock>>());
-
-            if (chip_id == locked_SAs[ind_locked_SAs].size()){
-                // adding locked_SAs for a new chip
-                locked_SAs[ind_locked_SAs].push_back(std::vector<SALock>());
-                get_locked_SAs().resize(_num_banks_in_chip);
-            }
+            ctrl->smd_ctx.init_locked_SAs(rank_id, chip_id, _num_banks_in_chip);
 
             
         }
@@ -340,16 +769,45 @@ class MaintenancePolicy {
 
         virtual void tick() = 0;
 
+        // called for every row activation the chip performs
+        virtual void process_row_activation(const std::vector<int>& addr_vec) {}
+
+        // returns true if the rows pointed by mc do not need maintenance in this round. The MaintenanceMachine then advances mc without locking the SA
+        virtual bool skip_maint(const MaintenanceCounter& mc) { return false; }
+
+        // called when a MaintenanceMachine initiates the maintenance of the rows pointed by mc
+        virtual void notify_maint(const MaintenanceCounter& mc) {}
+
+        // called when another maintenance mechanism of the same chip locks the SA of lock_rows. If the policy has a pending operation on 
+        // the same SA, it performs the operation within that lock window. extension is set to the cycles the window needs to grow by 
+        // (must not exceed max_extension) and saved_cycles to the lock cycles the rows already maintained by lock_rows save
+        virtual bool absorb_pending_maint(const MaintRows& lock_rows, const uint32_t max_extension, uint32_t& extension, uint32_t& saved_cycles) { return false; }
+
+        // lets the other maintenance mechanisms of the chip coalesce their pending operations into a new lock window. Returns the number of cycles to extend the window by
+        uint32_t coalesce_maint(const MaintRows& lock_rows, const uint32_t lock_window) {
+            if (!coalesce_maint_enabled)
+                return 0;
+
+            return ctrl->smd_coalesce_maint(_rank_id, _chip_id, this, lock_rows, lock_window);
+        }
+
         std::vector<uint32_t> communicate_locked_SAs (const uint32_t bank_id) {
             std::vector<uint32_t> SAs;
 
             auto& le = get_locked_SAs()[bank_id];
-            if (le.locked)
-                SAs.push_back(le.sa_id);
+            if (le.bank_locked) {
+                // the entire bank is under maintenance
+                SAs.resize(_num_SAs_per_bank);
+                std::iota(SAs.begin(), SAs.end(), 0);
+            } else
+                SAs = le.sa_ids;
 
-            assert(le.cooldown_exp <= clk && "[MaintenancePolicy] ERROR: Communicating the refresh status for the second time before the expiration of the cooldown period.");
+            // in ALERT mode, the chip notifies the memory controller about each new lock, so it does not need to wait for a cooldown period
+            if (smd_mode == SMD_MODE::RSQ) {
+                assert(le.cooldown_exp <= clk && "[MaintenancePolicy] ERROR: Communicating the refresh status for the second time before the expiration of the cooldown period.");
 
-            le.cooldown_exp = clk + ref_tracker_timeout_period;
+                le.cooldown_exp = clk + ctrl->smd_ctx.ref_tracker_timeout_period;
+            }
 
             // std::cout << "[MaintenancePolicy] Communicating locked SAs of bank " << bank_id << std::endl;
 
@@ -359,16 +817,32 @@ class MaintenancePolicy {
         bool is_SA_under_maintenance(const uint32_t global_bank_id, const uint32_t sa_id) const {
             const auto& le = get_locked_SAs()[global_bank_id];
 
-            if ((le.locked && le.sa_id == sa_id) || le.bank_locked)
-                return true;
-
-            return false;
+            return le.bank_locked || le.is_locked(sa_id);
         }
 
         bool contains_locked_SA(const uint32_t global_bank_id) const {
             const auto& le = get_locked_SAs()[global_bank_id];
 
-            return le.locked;
+            return le.is_locked();
+        }
+
+        // a bank without SA-level parallelism (max_locked_SAs_per_bank = 1) has a single SA under maintenance at a time. 
+        // A bank lock (e.g., for scrubbing) excludes all other locks in the bank
+        bool can_lock_SA(const uint32_t global_bank_id, const uint32_t sa_id) const {
+            const auto& le = get_locked_SAs()[global_bank_id];
+
+            if (!le.is_locked())
+                return true;
+
+            if (le.is_locked(sa_id))
+                return false;
+
+            if (le.bank_locked || lock_entire_bank || (le.sa_ids.size() >= max_locked_SAs_per_bank)) {
+                ctrl->smd_ctx.maint_blocked_by_bank_lock++;
+                return false;
+            }
+
+            return true;
         }
 
         long get_clk() const {
@@ -390,6 +864,23 @@ class MaintenancePolicy {
             return cur_alert;
         }
 
+        bool defer_maint(const MaintenanceCounter& mc) {
+            return ctrl->smd_ctx.access_predictor.defer_maint(_rank_id, mc.bank_id, mc.sa_counter, mc.pending_maint, ctrl->clk);
+        }
+
+        // the longest time an SA stays locked for a single maintenance operation
+        uint32_t get_maint_window() const {
+            return maint_latency*row_maint_granularity;
+        }
+
+        bool is_adaptive() const {
+            return adaptive_maint_machines;
+        }
+
+        uint32_t get_num_active_machines() const {
+            return num_maint_machines;
+        }
+
     protected:
 
         void lockSA(const uint32_t bank_id, const uint32_t sa_id) {
@@ -402,11 +893,13 @@ class MaintenancePolicy {
 
             auto& le = get_locked_SAs()[bank_id];
 
-            assert(!le.locked && "[MaintenancePolicy] ERROR: Already locked a subarray from the target bank. The policy has to release a subarray first.");
+            assert(!le.bank_locked && !le.is_locked(sa_id) && (le.sa_ids.size() < max_locked_SAs_per_bank) && "[MaintenancePolicy] ERROR: Cannot lock another subarray from the target bank. The policy has to release a subarray first.");
             assert(le.cooldown_exp <= clk && "[MaintenancePolicy] ERROR: Cannot lock a subarray from a bank before its cooldown period expires.");
 
-            le.sa_id = sa_id;
-            le.locked = true;
+            if (le.is_locked())
+                ctrl->smd_ctx.concurrent_SA_locks++;
+
+            le.sa_ids.push_back(sa_id);
             le.bank_locked = lock_entire_bank;
         }
 
@@ -415,22 +908,21 @@ class MaintenancePolicy {
 
             // std::cout << "[MaintenancePolicy] Releasing locked SAs in bank  " << bank_id << std::endl;
 
-            if (le.sa_id == sa_id) {
-                assert(le.locked && "[MaintenancePolicy] ERROR: Trying to release an already released subarray.");
-
+            auto it = std::find(le.sa_ids.begin(), le.sa_ids.end(), sa_id);
+            if (it != le.sa_ids.end()) {
                 #ifdef SMD_DEBUG
                     uint bgid = bank_id/channel->spec->org_entry.count[int(T::Level::Bank)];
                     uint bid = bank_id % channel->spec->org_entry.count[int(T::Level::Bank)];
                     printf("%lu\t[%s]\t[Chip %d] Releasing r: %d bg: %d b: %d, sa: %d \n", clk, _policy_name.c_str(), _chip_id, _rank_id, bgid, bid, sa_id);
                 #endif // SMD_DEBUG
 
-                le.locked = false;
+                le.sa_ids.erase(it);
                 le.bank_locked = false;
 
                 // std::cout << "[MaintenancePolicy] clk: " << clk << ", Releasing bank: " << sa_addr.bank_id << ", SA: " << sa_addr.sa_id << std::endl;
                 return;
             } else {
-                std::cout << "[MaintenancePolicy] ERROR: Trying to release SA " << sa_id << " but SA " << le.sa_id << " is the currently locked SA." << std::endl;
+                std::cout << "[MaintenancePolicy] ERROR: Trying to release SA " << sa_id << " but it is not among the " << le.sa_ids.size() << " currently locked SAs." << std::endl;
                 assert(false);
             }
 
@@ -450,13 +942,123 @@ class MaintenancePolicy {
             return get_locked_SAs()[bank_id].cooldown_exp > clk;
         }
 
+        // distributes the MaintenanceCounters of all machines across the first num_active machines the same way
+        // as when the policy is constructed with num_active machines. Inactive machines still tick to release their last locked SA
+        template <typename M>
+        void distribute_maint_counters(std::vector<M>& machines, const uint32_t num_active) {
+            assert(num_active > 0 && num_active <= machines.size());
+
+            std::vector<MaintenanceCounter> counters;
+            for (auto& m : machines) {
+                counters.insert(counters.end(), m.maint_counters.begin(), m.maint_counters.end());
+                m.maint_counters.clear();
+                m.ctr_index = 0;
+            }
+
+            std::sort(counters.begin(), counters.end(), [](const MaintenanceCounter& a, const MaintenanceCounter& b) {return a.bank_id < b.bank_id;});
+
+            for (auto& mc : counters)
+                machines[mc.bank_id % num_active].maint_counters.push_back(mc);
+
+            num_maint_machines = num_active;
+        }
+
+        // activates one more machine when the maintenance backlog of a bank reaches half of pending_maint_limit, and deactivates 
+        // a machine after maint_machines_shrink_intervals consecutive maintenance intervals in which no bank has more than one pending operation
+        template <typename M>
+        void adapt_maint_machines(std::vector<M>& machines) {
+            if (!adaptive_maint_machines)
+                return;
+
+            uint32_t max_pending = 0;
+            for (auto& m : machines)
+                for (auto& mc : m.maint_counters)
+                    max_pending = std::max(max_pending, mc.pending_maint);
+
+            if ((max_pending*2 >= pending_maint_limit) && (num_maint_machines < machines.size())) {
+                distribute_maint_counters(machines, num_maint_machines + 1);
+                low_backlog_intervals = 0;
+                return;
+            }
+
+            if (max_pending > 1) {
+                low_backlog_intervals = 0;
+                return;
+            }
+
+            if ((++low_backlog_intervals >= maint_machines_shrink_intervals) && (num_maint_machines > 1)) {
+                distribute_maint_counters(machines, num_maint_machines - 1);
+                low_backlog_intervals = 0;
+            }
+        }
+
+        // in adaptive mode, the initial number of active machines cannot exceed max_maint_machines
+        void set_initial_maint_machines(const uint32_t num) {
+            num_maint_machines = adaptive_maint_machines ? std::min(num, max_maint_machines) : num;
+        }
+
+        // the number of machines to construct. In adaptive mode, all machines up to max_maint_machines are constructed and num_maint_machines of them are active
+        uint32_t num_machines_to_construct() const {
+            if (adaptive_maint_machines)
+                return max_maint_machines;
+
+            return num_maint_machines;
+        }
+
         std::vector<SALock>& get_locked_SAs() const {
-            return locked_SAs[ind_locked_SAs][_chip_id];
+            return ctrl->smd_ctx.get_locked_SAs(_rank_id, _chip_id);
+        }
+
+        // absorbs the pending operation of the MaintenanceCounter responsible for the bank of lock_rows
+        template <typename M>
+        bool absorb_pending_maint_of(std::vector<M>& machines, const MaintRows& lock_rows, const uint32_t max_extension, uint32_t& extension, uint32_t& saved_cycles) {
+            for (auto& m : machines) {
+                for (auto& mc : m.maint_counters) {
+                    if (mc.bank_id != lock_rows.bank_id)
+                        continue;
+
+                    if (mc.pending_maint == 0 || mc.sa_counter != lock_rows.sa_id)
+                        return false;
+
+                    if (!accept_coalesced_maint(lock_rows, m.get_maint_rows(mc), max_extension, extension, saved_cycles))
+                        return false;
+
+                    notify_maint(mc);
+                    mc.increment(_num_SAs_per_bank, _num_rows, row_maint_granularity);
+                    mc.pending_maint--;
+                    return true;
+                }
+            }
+
+            return false;
+        }
+
+        // the rows of op_rows that lock_rows does not restore extend the lock window
+        bool accept_coalesced_maint(const MaintRows& lock_rows, const MaintRows& op_rows, const uint32_t max_extension, uint32_t& extension, uint32_t& saved_cycles) {
+            uint32_t covered = rows_covered_by_other_maint ? lock_rows.count_covered(op_rows) : 0;
+            uint32_t uncovered = op_rows.size() - covered;
+
+            if (uncovered*maint_latency > max_extension)
+                return false;
+
+            extension = uncovered*maint_latency;
+            saved_cycles = covered*maint_latency;
+
+            // similar to the MaintenanceMachines, only chip0 reports the maintenance energy to DRAMPower
+            if (uncovered > 0 && _chip_id == 0)
+                issue_dpower_maint(uncovered, op_rows.bank_id);
+
+            return true;
+        }
+
+        virtual void issue_dpower_maint(const uint32_t num_rows, const uint32_t bank_id) {
+            ctrl->issueDPowerSMDREF(num_rows, _rank_id, bank_id);
         }
 
         long clk = 0;
 
         uint32_t _num_banks_in_chip;
+        uint32_t _bank_id_bits = 0; // ceil(log2(_num_banks_in_chip))
         uint32_t _num_SAs_per_bank;
         uint32_t _num_rows;
 
@@ -466,11 +1068,22 @@ class MaintenancePolicy {
 
         bool lock_entire_bank = false;
 
+        // coalescing pending operations of different maintenance mechanisms into the same lock window
+        bool coalesce_maint_enabled = false;
+        bool rows_covered_by_other_maint = true; // false if maintaining the rows of another operation does not accomplish this policy's operation
+
         uint32_t num_maint_machines;
 
+        // adaptive MaintenanceMachine provisioning
+        bool adaptive_maint_machines = false;
+        uint32_t max_maint_machines;
+        uint32_t maint_machines_shrink_intervals;
+        uint32_t low_backlog_intervals = 0;
+
+        uint32_t max_locked_SAs_per_bank = 1; // >1 models MASA-style per-SA row address latches that let a bank maintain multiple SAs concurrently
+
         uint32_t _rank_id;
         uint32_t _chip_id;
-        uint32_t ind_locked_SAs;
         std::string _policy_name = "";
 
         SMD_MODE smd_mode;
@@ -479,76 +1092,18 @@ class MaintenancePolicy {
 
         Controller<T>* ctrl;
         DRAM<T>* channel;
-
-    private:
-        static std::vector<std::vector<std::vector<SALock>>> locked_SAs;
 };
 
-template <typename T> 
-std::vector<std::vector<std::vector<SALock>>> MaintenancePolicy<T>::locked_SAs;
 
 
-typedef struct MaintenanceCounter {
-    uint32_t bank_id; // each bank has one refresh counter
-    uint32_t row_counter; // the row to refresh with the next REF operation
-    uint32_t sa_counter; // the SA to refresh with the next REF operation
-    uint64_t rollbacks; // the number of times this counter started over
-    uint32_t pending_maint; // the number REFs that are awaiting turn to be performed on the bank the MaintenanceCounter is responsible for
-    MaintenanceCounter(const uint32_t bank_id) : bank_id(bank_id) {
-        row_counter = 0;
-        sa_counter = 0;
-        rollbacks = 0;
-        pending_maint = 0;
-    }
-
-    // We'd probably like to start ecc scrubbing operations at a different subarray than refresh operations
-    // so they are not overlapped in case the refresh and ecc intervals are the same?
-    MaintenanceCounter(const uint32_t bank_id, const uint32_t sa_offset) : bank_id(bank_id), sa_counter(sa_offset) {
-        row_counter = 0;
-        rollbacks = 0;
-        pending_maint = 0;
-    }
-
-    MaintenanceCounter() : MaintenanceCounter(0){}
-    MaintenanceCounter& operator=(const MaintenanceCounter& other) {
-        bank_id = other.bank_id;
-        row_counter = other.row_counter;
-        sa_counter = other.sa_counter;
-        rollbacks = other.rollbacks;
-        pending_maint = other.pending_maint;
-
-        return *this;
-    }
-
-    void increment(const uint32_t num_SAs, const uint32_t num_rows, const uint32_t incr_val) {
-        if(sa_counter == (num_SAs - 1)) {
-            sa_counter = 0;
-
-            auto old_row_counter = row_counter;
-            row_counter = (row_counter + incr_val) % num_rows;
-
-            if (old_row_counter > row_counter)
-                rollbacks++;
-
-            return;
-        }
-        sa_counter++;
-    }
-
-    void set(const RowAddr& ra) {
-        bank_id = ra.bank_gid;
-        sa_counter = ra.sa_id;
-        row_counter = ra.row_id;
-    }
-} MaintenanceCounter;
-
 // a MaintenanceMachine is responsible for performing refresh operation as needed by its RefreshCounters
 template <typename T>
 class MaintenanceMachine {
 
     public:
+        friend class MaintenancePolicy<T>;
+
         MaintenanceMachine(const uint32_t id, const uint32_t num_counters, MaintenancePolicy<T>& maint_policy) : id(id), maint_policy(maint_policy) {
-            _num_counters = num_counters;
             maint_counters.reserve(num_counters);
         }
 
@@ -559,7 +1114,10 @@ class MaintenanceMachine {
                 rc.pending_maint++;
                 if (rc.pending_maint > maint_policy.pending_maint_limit) {
                     std::cout << "[MaintenanceMachine] ERROR: pending maintenance limit exceeded for bank " << rc.bank_id << ". Current pending maintenances: " << rc.pending_maint << std::endl;
-                    std::cout << "[MaintenanceMachine] hitting this most likely because the current MaintenanceMachines cannot keep up with the refresh demand. Consider increasing the number of MaintenanceMachines" << std::endl;
+                    if (maint_policy.adaptive_maint_machines)
+                        std::cout << "[MaintenanceMachine] hitting this most likely because even " << maint_policy.num_maint_machines << " MaintenanceMachines cannot keep up with the refresh demand. Consider increasing smd_max_maint_machines" << std::endl;
+                    else
+                        std::cout << "[MaintenanceMachine] hitting this most likely because the current MaintenanceMachines cannot keep up with the refresh demand. Consider increasing the number of MaintenanceMachines or enabling smd_adaptive_maint_machines" << std::endl;
                     assert(false);
                 }
 
@@ -577,36 +1135,51 @@ class MaintenanceMachine {
             if(maint_completion_clk == maint_policy.get_clk()) // just finished refreshing. Release the SA
                 maint_policy.releaseSA(last_locked_SA.bank_id, last_locked_SA.sa_counter);
 
+            if (maint_counters.empty())
+                return; // the machine is deactivated by adaptive provisioning
+
             // check if the counter pointed to by ctr_index has a pending refresh. If so, try to issue a REF. If not (or cannot issue a REF), just increment the ctr_index.
             MaintenanceCounter& cur_mc = maint_counters[ctr_index];
-            ctr_index = (ctr_index + 1) % _num_counters;
+            ctr_index = (ctr_index + 1) % maint_counters.size();
 
             if (cur_mc.pending_maint == 0) {
                 // std::cout << "[MaintenanceMachine] clk: " <<  maint_policy.get_clk() << " No pending REFs - bank: " << cur_mc.bank_id << " SA: " << cur_mc.sa_counter << std::endl;
                 return;
             }
 
-            bool maint_initiated = false;
-            switch(maint_policy.smd_mode) {
-                case SMD_MODE::RSQ: {
-                    maint_initiated = process_ref_rsq(cur_mc);
-                    break;
-                }
-                case SMD_MODE::ALERT: {
-                    maint_initiated = process_ref_alert(cur_mc);
-                    break;
-                }
-                case SMD_MODE::ACT_NACK: {
-                    maint_initiated = process_maint_act_nack(cur_mc);
-                    break;
+            // the memory controller is likely to access the SA soon. Leave the turn to the next bank
+            if (maint_policy.defer_maint(cur_mc))
+                return;
+
+            // the policy may find that the target rows do not need maintenance yet. Then, the counter advances without locking the SA
+            bool maint_skipped = maint_policy.skip_maint(cur_mc);
+
+            bool maint_initiated = maint_skipped;
+            if (!maint_skipped) {
+                switch(maint_policy.smd_mode) {
+                    case SMD_MODE::RSQ: {
+                        maint_initiated = process_ref_rsq(cur_mc);
+                        break;
+                    }
+                    case SMD_MODE::ALERT: {
+                        maint_initiated = process_ref_alert(cur_mc);
+                        break;
+                    }
+                    case SMD_MODE::ACT_NACK: {
+                        maint_initiated = process_maint_act_nack(cur_mc);
+                        break;
+                    }
+                    default:
+                        assert(false && "ERROR: Undefined SMD_MODE!");
                 }
-                default:
-                    assert(false && "ERROR: Undefined SMD_MODE!");
             }
 
             if (!maint_initiated)
                 return;
 
+            if (!maint_skipped)
+                maint_policy.notify_maint(cur_mc);
+
             // increment the maintenance address counter
             cur_mc.increment(maint_policy._num_SAs_per_bank, maint_policy._num_rows, maint_policy.row_maint_granularity);
 
@@ -621,8 +1194,17 @@ class MaintenanceMachine {
 
         std::vector<MaintenanceCounter> maint_counters;
 
+        virtual MaintRows get_maint_rows(const MaintenanceCounter& mc) const {
+            return MaintRows(mc.bank_id, mc.sa_counter, mc.row_counter, std::min(mc.row_counter + maint_policy.row_maint_granularity, maint_policy._num_rows));
+        }
+
     protected:
 
+        // the other maintenance mechanisms of the chip may perform their pending operations on the just locked SA in the same lock window
+        void coalesce_maint(const MaintenanceCounter& mc) {
+            maint_completion_clk += maint_policy.coalesce_maint(get_maint_rows(mc), maint_completion_clk - maint_policy.get_clk());
+        }
+
         bool process_ref_rsq (const MaintenanceCounter& mc) {
             if(maint_policy.is_on_cooldown(mc.bank_id)) {
                 // std::cout << "[MaintenanceMachine] clk: " <<  maint_policy.get_clk() << " On cooldown - bank: " << mc.bank_id << " SA: " << mc.sa_counter << std::endl;
@@ -633,6 +1215,11 @@ class MaintenanceMachine {
                 // std::cout << "[MaintenanceMachine] clk: " <<  maint_policy.get_clk() << " Open row in the target SA - bank: " << mc.bank_id << " SA: " << mc.sa_counter << std::endl;
                 return false;
             }
+
+            if(!maint_policy.can_lock_SA(mc.bank_id, mc.sa_counter)) {
+                // another machine (e.g., one that used to own this bank's counter before adaptive provisioning) is maintaining the bank
+                return false;
+            }
                
             // the subarray is not being currently accessed and it is not on cooldown. The MaintenanceMachine can lock it
             maint_policy.lockSA(mc.bank_id, mc.sa_counter);
@@ -640,6 +1227,7 @@ class MaintenanceMachine {
 
             // set the ref completion cycle
             maint_completion_clk = maint_policy.get_clk() + maint_policy.maint_latency*maint_policy.row_maint_granularity;
+            coalesce_maint(mc);
 
             // if(maint_policy.get_chip_id() == 0) {
             //     std::cout << "[MaintenanceMachine] clk: " << maint_policy.get_clk() << " Refreshing bank: " << mc.bank_id << " SA: " << mc.sa_counter;
@@ -650,12 +1238,15 @@ class MaintenanceMachine {
         }
 
         bool process_ref_alert(const MaintenanceCounter& mc) {
+            // similar to ACT_NACK, the chip locks only a precharged SA in a bank that has no other SA under maintenance
+            if(!retry_ref(mc))
+                return false;
+
             maint_policy.lockSA(mc.bank_id, mc.sa_counter);
             last_locked_SA = mc;
+            coalesce_maint(mc);
 
-            if(!retry_ref(mc))
-                SA_conflict = true;
-
+            // let the memory controller know that it should query the maintenance status of the rank
             set_alert_status();
             
             return true;
@@ -666,6 +1257,7 @@ class MaintenanceMachine {
             if (retry_ref(mc)){
                 maint_policy.lockSA(mc.bank_id, mc.sa_counter);
                 last_locked_SA = mc;
+                coalesce_maint(mc);
                 return true;
             }
 
@@ -679,7 +1271,7 @@ class MaintenanceMachine {
         }
 
         virtual bool retry_ref(const MaintenanceCounter& mc) {
-            if(!maint_policy.is_SA_active(mc.bank_id, mc.sa_counter) && !maint_policy.contains_locked_SA(mc.bank_id)) {
+            if(!maint_policy.is_SA_active(mc.bank_id, mc.sa_counter) && maint_policy.can_lock_SA(mc.bank_id, mc.sa_counter)) {
                 maint_completion_clk = maint_policy.get_clk() + maint_policy.maint_latency*maint_policy.row_maint_granularity;
 
                 // DRAMPower estimates DRAM energy for a single DRAM chip. The refresh power is calculated incorrectly (for all chips) if 
@@ -698,9 +1290,7 @@ class MaintenanceMachine {
         }
 
         uint32_t id;
-        uint32_t _num_counters;
         uint32_t ctr_index = 0;
-        bool SA_conflict = false; // used only in ref_alert mode
 
         MaintenancePolicy<T>& maint_policy;
         long maint_completion_clk = -1;
@@ -744,15 +1334,15 @@ class SMDFixedRateRefresh : public MaintenancePolicy<T> {
             // std::cout << "[SMDFixedRateRefresh] The current refresh latency: " << this->maint_latency << " cycles."  << std::endl;
             // std::cout << "[SMDFixedRateRefresh] The number of refresh machines: " << this->num_maint_machines << ""  << std::endl;
 
-            this->num_maint_machines = configs.get_uint("smd_num_ref_machines");
-            assert((this->_num_banks_in_chip % this->num_maint_machines) == 0 && "[SMDFixedRateRefresh] ERROR: num_maint_machines should divide the total number of banks with no remainder.");
+            this->set_initial_maint_machines(configs.get_uint("smd_num_ref_machines"));
+            assert((this->adaptive_maint_machines || (this->_num_banks_in_chip % this->num_maint_machines) == 0) && "[SMDFixedRateRefresh] ERROR: num_maint_machines should divide the total number of banks with no remainder.");
 
             // ref_tracker_timeout_period can be arbitrary
             // setting it smaller than the ref_interval is good so that a refresh machine does not need to wait for another pending ref before refreshing again
             // the downside is, the lower the ref_tracker_timeout_period, the more ref status updates needed by the memory controller
-            ref_tracker_timeout_period = std::floor(ref_interval*configs.get_float("smd_timeout_to_ref_interval_ratio"));
+            this->ctrl->smd_ctx.ref_tracker_timeout_period = std::floor(ref_interval*configs.get_float("smd_timeout_to_ref_interval_ratio"));
 
-            for(uint rm_id = 0; rm_id < this->num_maint_machines; rm_id++)
+            for(uint rm_id = 0; rm_id < this->num_machines_to_construct(); rm_id++)
                 ref_machines.emplace_back(rm_id, this->_num_banks_in_chip/this->num_maint_machines, *this);
 
             // create a MaintenanceCounter for each bank and distribute them evenly across the ref_machines
@@ -774,10 +1364,16 @@ class SMDFixedRateRefresh : public MaintenancePolicy<T> {
                 // time to refresh new rows
                 for (auto& rm : ref_machines)
                     rm.add_pending_maint();
+
+                this->adapt_maint_machines(ref_machines);
             }
         }
 
-    private:
+        bool absorb_pending_maint(const MaintRows& lock_rows, const uint32_t max_extension, uint32_t& extension, uint32_t& saved_cycles) {
+            return this->absorb_pending_maint_of(ref_machines, lock_rows, max_extension, extension, saved_cycles);
+        }
+
+    protected:
         uint32_t ref_interval; // the DRAM chip refreshes a different row from each bank at this interval
 
         std::vector<MaintenanceMachine<T>> ref_machines;
@@ -785,6 +1381,90 @@ class SMDFixedRateRefresh : public MaintenancePolicy<T> {
         uint32_t ref_interval_offset = 0;
 };
 
+// Skips the refresh of rows that are recently activated since an activation fully restores the charge of a row
+// Similar to Smart Refresh, the refresh counters sweep through the rows num_subwindows times per refresh period and each row has a small counter 
+// (the number of sweeps since the row was last restored). A row is refreshed only when the counter indicates that the row would not be restored within the refresh period otherwise
+template <typename T>
+class SMDAccessAwareRefresh : public SMDFixedRateRefresh<T> {
+
+    public:
+        SMDAccessAwareRefresh(const Config& configs, Controller<T>* ctrl, const uint32_t rank_id, 
+            const uint32_t chip_id, const uint32_t num_banks_in_chip, const uint32_t SAs_per_bank, const uint32_t num_rows) : 
+            SMDFixedRateRefresh<T>(configs, ctrl, rank_id, chip_id, num_banks_in_chip, SAs_per_bank, num_rows) {
+
+            this->_policy_name = "AccessAwareRefresh";
+
+            num_subwindows = configs.get_uint("smd_access_aware_refresh_subwindows");
+            assert(num_subwindows > 0 && num_subwindows <= std::numeric_limits<uint8_t>::max() && "[SMDAccessAwareRefresh] ERROR: smd_access_aware_refresh_subwindows should be between 1 and 255.");
+
+            // the counters sweep through all rows once every subwindow
+            this->ref_interval /= num_subwindows;
+            assert(this->ref_interval > this->maint_latency && "[SMDAccessAwareRefresh] ERROR: the latency of a refresh operation should not be longer than the interval for visiting a new row.");
+            this->ctrl->smd_ctx.ref_tracker_timeout_period = std::floor(this->ref_interval*configs.get_float("smd_timeout_to_ref_interval_ratio"));
+
+            // staggering the initial row counters across consecutive refresh operations so that each sweep refreshes 1/num_subwindows of the rows
+            uint32_t rows_per_bank = num_rows*SAs_per_bank;
+            sweeps_since_restore.resize(num_banks_in_chip, std::vector<uint8_t>(rows_per_bank));
+            for (uint32_t bank_id = 0; bank_id < num_banks_in_chip; bank_id++) {
+                for (uint32_t row_id = 0; row_id < rows_per_bank; row_id++) {
+                    uint32_t sa_id = row_id / num_rows;
+                    uint32_t maint_op_id = ((row_id % num_rows)/this->row_maint_granularity)*SAs_per_bank + sa_id; // the order in which the MaintenanceCounters visit the rows
+                    sweeps_since_restore[bank_id][row_id] = (num_subwindows - 1) - (maint_op_id % num_subwindows);
+                }
+            }
+
+            skipped_refreshes
+                .name("skipped_refreshes_" + to_string(this->channel->id) + "_" + to_string(chip_id) + "_" + to_string(rank_id))
+                .desc("The number of refresh operations skipped since all target rows were activated recently.")
+                .precision(0)
+            ;
+        }
+
+        void process_row_activation(const std::vector<int>& addr_vec) {
+            uint32_t bank_id = this->channel->spec->calc_global_bank_id(addr_vec);
+            uint32_t row_id = this->channel->spec->calc_row_id_in_bank(addr_vec);
+
+            sweeps_since_restore[bank_id][row_id] = 0;
+        }
+
+        bool skip_maint(const MaintenanceCounter& mc) {
+            uint32_t first_row, last_row;
+            get_maint_rows(mc, first_row, last_row);
+
+            // refresh if any row would otherwise stay unrestored for longer than the refresh period
+            auto& sweeps = sweeps_since_restore[mc.bank_id];
+            for (uint32_t row_id = first_row; row_id < last_row; row_id++)
+                if (sweeps[row_id] >= num_subwindows - 1)
+                    return false;
+
+            for (uint32_t row_id = first_row; row_id < last_row; row_id++)
+                sweeps[row_id]++;
+
+            skipped_refreshes++;
+            return true;
+        }
+
+        void notify_maint(const MaintenanceCounter& mc) {
+            uint32_t first_row, last_row;
+            get_maint_rows(mc, first_row, last_row);
+
+            auto& sweeps = sweeps_since_restore[mc.bank_id];
+            std::fill(sweeps.begin() + first_row, sweeps.begin() + last_row, 0);
+        }
+
+    protected:
+        ScalarStat skipped_refreshes;
+
+    private:
+        uint32_t num_subwindows;
+        std::vector<std::vector<uint8_t>> sweeps_since_restore; // per bank, per row
+
+        void get_maint_rows(const MaintenanceCounter& mc, uint32_t& first_row, uint32_t& last_row) const {
+            first_row = mc.sa_counter*this->_num_rows + mc.row_counter;
+            last_row = mc.sa_counter*this->_num_rows + std::min(mc.row_counter + this->row_maint_granularity, this->_num_rows);
+        }
+};
+
 template <typename T>
 class SMDNoRefresh : public MaintenancePolicy<T> {
 
@@ -813,13 +1493,16 @@ class SMDECCScrubbing : public MaintenancePolicy<T> {
 
             this->_policy_name = "ECCScrubbing";
 
+            // refreshing a row does not correct its errors
+            this->rows_covered_by_other_maint = false;
+
             if (configs.get_str("smd_scrubbing_lock_region") == "bank")
                 this->lock_entire_bank = true;
 
             scrub_interval = std::floor(configs.get_ulong("smd_ecc_scrubbing_period")/(this->_num_rows*this->_num_SAs_per_bank));
 
             this->row_maint_granularity = configs.get_uint("smd_scrubbing_granularity");
-            this->num_maint_machines = configs.get_uint("smd_num_scrubbing_machines");
+            this->set_initial_maint_machines(configs.get_uint("smd_num_scrubbing_machines"));
             this->maint_latency = configs.get_uint("smd_single_scrubbing_latency");
 
             assert(scrub_interval > this->maint_latency && "[SMDECCScrubbing] ERROR: the latency of a scrub operation should not be longer than the interval for scrubing a new row.");
@@ -832,9 +1515,9 @@ class SMDECCScrubbing : public MaintenancePolicy<T> {
             //     std::cout << "[SMDECCScrubbing] The number of scrub machines: " << this->num_maint_machines << ""  << std::endl;
             // }
 
-            assert((this->_num_banks_in_chip % this->num_maint_machines) == 0 && "[SMDECCScrubbing] ERROR: num_maint_machines should divide the total number of banks with no remainder.");
+            assert((this->adaptive_maint_machines || (this->_num_banks_in_chip % this->num_maint_machines) == 0) && "[SMDECCScrubbing] ERROR: num_maint_machines should divide the total number of banks with no remainder.");
 
-            for(uint rm_id = 0; rm_id < this->num_maint_machines; rm_id++)
+            for(uint rm_id = 0; rm_id < this->num_machines_to_construct(); rm_id++)
                 scrub_machines.emplace_back(rm_id, this->_num_banks_in_chip/this->num_maint_machines, *this);
 
             // create a MaintenanceCounter for each bank and distribute them evenly across the scrub_machines
@@ -854,9 +1537,20 @@ class SMDECCScrubbing : public MaintenancePolicy<T> {
                 //printf("SCRUBBER TICK\n");
                 for (auto& sm : scrub_machines)
                     sm.add_pending_maint();
+
+                this->adapt_maint_machines(scrub_machines);
             }
         }
 
+        bool absorb_pending_maint(const MaintRows& lock_rows, const uint32_t max_extension, uint32_t& extension, uint32_t& saved_cycles) {
+            return this->absorb_pending_maint_of(scrub_machines, lock_rows, max_extension, extension, saved_cycles);
+        }
+
+    protected:
+        void issue_dpower_maint(const uint32_t num_rows, const uint32_t bank_id) {
+            this->ctrl->issueDPowerRowScrubbing(num_rows, this->_rank_id, bank_id);
+        }
+
     private:
         uint64_t scrub_interval;
 
@@ -871,7 +1565,7 @@ class ECCScrubbingMachine : public MaintenanceMachine<T> {
 
     protected:
         bool retry_ref(const MaintenanceCounter& mc) {
-            if(!this->maint_policy.is_SA_active(mc.bank_id, mc.sa_counter) && !this->maint_policy.contains_locked_SA(mc.bank_id)) {
+            if(!this->maint_policy.is_SA_active(mc.bank_id, mc.sa_counter) && this->maint_policy.can_lock_SA(mc.bank_id, mc.sa_counter)) {
                 this->maint_completion_clk = this->maint_policy.get_clk() + this->maint_policy.maint_latency*this->maint_policy.row_maint_granularity;
 
                 // DRAMPower estimates DRAM energy for a single DRAM chip. The refresh power is calculated incorrectly (for all chips) if 
@@ -905,7 +1599,7 @@ class SMDVariableRefresh : public MaintenancePolicy<T> {
 
             // sample normal distribution to estimate rows retention times
             // std::random_device rd{};
-            uint32_t num_chips = (64/this->channel->spec->org_entry.dq);
+            uint32_t num_chips = (this->channel->spec->channel_width/this->channel->spec->org_entry.dq);
             std::mt19937 gen{rank_id*num_chips + chip_id}; // using fixed seed for repeatable simulations
             std::normal_distribution<> normal_dist{400, 70};
 
@@ -959,16 +1653,16 @@ class SMDVariableRefresh : public MaintenancePolicy<T> {
             // we multiply the ref_interval by row_maint_granularity since that many rows will be refreshed within a single refresh operation, i.e., when an SA is locked
             ref_interval *= this->row_maint_granularity;
 
-            ref_tracker_timeout_period = std::floor(ref_interval*configs.get_float("smd_timeout_to_ref_interval_ratio"));
+            this->ctrl->smd_ctx.ref_tracker_timeout_period = std::floor(ref_interval*configs.get_float("smd_timeout_to_ref_interval_ratio"));
 
-            this->num_maint_machines = configs.get_uint("smd_num_ref_machines");
-            assert((this->_num_banks_in_chip % this->num_maint_machines) == 0 && "[SMDFixedRateRefresh] ERROR: num_maint_machines should divide the total number of banks with no remainder.");
+            this->set_initial_maint_machines(configs.get_uint("smd_num_ref_machines"));
+            assert((this->adaptive_maint_machines || (this->_num_banks_in_chip % this->num_maint_machines) == 0) && "[SMDFixedRateRefresh] ERROR: num_maint_machines should divide the total number of banks with no remainder.");
 
             if(configs.get_bool("smd_worst_case_ref_distribution"))
                 ref_interval_offset = chip_id*(this->maint_latency*this->row_maint_granularity);
 
-            ref_machines.reserve(this->num_maint_machines);
-            for(uint rm_id = 0; rm_id < this->num_maint_machines; rm_id++)
+            ref_machines.reserve(this->num_machines_to_construct());
+            for(uint rm_id = 0; rm_id < this->num_machines_to_construct(); rm_id++)
                 ref_machines.emplace_back(rm_id, this->_num_banks_in_chip/this->num_maint_machines, *this);
 
             // create a MaintenanceCounter for each bank and distribute them evenly across the ref_machines
@@ -991,6 +1685,8 @@ class SMDVariableRefresh : public MaintenancePolicy<T> {
                 // time to refresh new rows
                 for (auto& rm : ref_machines)
                     rm.add_pending_maint();
+
+                this->adapt_maint_machines(ref_machines);
             }
         }
 
@@ -1011,8 +1707,8 @@ class SMDVariableRefresh : public MaintenancePolicy<T> {
         uint32_t ref_interval_offset = 0;
 
         uint32_t get_bloom_filter_address(const uint32_t bank_id, const uint32_t row_id) const {
-            // there can be at most 16 banks, so shifting row_id by 4 and adding bank_id
-            return (row_id << 4) + bank_id;
+            // the bank id takes the lowest _bank_id_bits bits
+            return (row_id << this->_bank_id_bits) + bank_id;
         }
 };
 
@@ -1075,7 +1771,7 @@ class VariableRefreshMachine : public MaintenanceMachine<T> {
         }
 
         bool retry_var_ref(const MaintenanceCounter& mc, const uint32_t rows_to_refresh) {
-            if(!this->variable_refresh_policy.is_SA_active(mc.bank_id, mc.sa_counter) && !this->variable_refresh_policy.contains_locked_SA(mc.bank_id)) {
+            if(!this->variable_refresh_policy.is_SA_active(mc.bank_id, mc.sa_counter) && this->variable_refresh_policy.can_lock_SA(mc.bank_id, mc.sa_counter)) {
                 this->maint_completion_clk = this->variable_refresh_policy.get_clk() + this->variable_refresh_policy.maint_latency*rows_to_refresh;
                 // DRAMPower estimates DRAM energy for a single DRAM chip. The refresh power is calculated incorrectly (for all chips) if 
                 // issueDPowerSMDREF() is called by every single chip. Instead, we call issueDPowerSMDREF() only from chip0 and estimating the energy of that chip.
@@ -1096,20 +1792,56 @@ template <typename T>
 class NeighborRowRefreshMachine : public MaintenanceMachine<T> {
 
 public:
-    NeighborRowRefreshMachine(MaintenancePolicy<T>& maint_policy) : MaintenanceMachine<T>(0, 1, maint_policy){}
+    NeighborRowRefreshMachine(MaintenancePolicy<T>& maint_policy, const uint32_t queue_size) : 
+        MaintenanceMachine<T>(0, 1, maint_policy), pending_neighbor_refs(queue_size) {}
 
 
-    void add_pending_maint(const RowAddr ra){
+    // returns false if the neighbor row refresh is dropped because the queue is full
+    bool add_pending_maint(const RowAddr ra){
         assert(this->maint_counters.size() == 1);
         assert(pending_neighbor_refs.size() == this->maint_counters[0].pending_maint);
 
-        if (std::find(pending_neighbor_refs.begin(), pending_neighbor_refs.end(), ra) != pending_neighbor_refs.end()) {
+        if (pending_neighbor_refs.contains(ra)) {
             // printf("[NeighborRowRefreshMachine] Neighbor row REF to bank: %u, sa: %u, row: %u is already issued.\n", ra.bank_gid, ra.sa_id, ra.row_id); // DEBUG
-            return; //this row is already in the queue of rows to refresh the neighbors of
+            return true; //this row is already in the queue of rows to refresh the neighbors of
         }
 
+        if (!pending_neighbor_refs.push(ra))
+            return false;
+
         MaintenanceMachine<T>::add_pending_maint();
-        pending_neighbor_refs.push_back(ra);
+        return true;
+    }
+
+    uint32_t get_queue_occupancy() const {
+        return pending_neighbor_refs.size();
+    }
+
+    // the victims of the aggressor row pointed by mc
+    MaintRows get_maint_rows(const MaintenanceCounter& mc) const {
+        uint32_t blast_radius = this->maint_policy.row_maint_granularity/2;
+        uint32_t first_row = mc.row_counter > blast_radius ? mc.row_counter - blast_radius : 0;
+        uint32_t last_row = std::min(mc.row_counter + blast_radius + 1, this->maint_policy._num_rows);
+
+        return MaintRows(mc.bank_id, mc.sa_counter, first_row, last_row, mc.row_counter);
+    }
+
+    // performs the oldest pending neighbor row refresh within the lock window of another maintenance operation
+    bool absorb_pending_maint(const MaintRows& lock_rows, const uint32_t max_extension, uint32_t& extension, uint32_t& saved_cycles) {
+        if (pending_neighbor_refs.empty())
+            return false;
+
+        MaintenanceCounter mc;
+        mc.set(pending_neighbor_refs.front());
+        if (mc.bank_id != lock_rows.bank_id || mc.sa_counter != lock_rows.sa_id)
+            return false;
+
+        if (!this->maint_policy.accept_coalesced_maint(lock_rows, get_maint_rows(mc), max_extension, extension, saved_cycles))
+            return false;
+
+        this->maint_counters[0].pending_maint--;
+        pending_neighbor_refs.pop();
+        return true;
     }
 
     virtual void tick() {
@@ -1129,7 +1861,7 @@ public:
         }
 
         // set the maintenance counter to the next SA in which to perform neighbor row refresh
-        cur_mc.set(pending_neighbor_refs[0]);
+        cur_mc.set(pending_neighbor_refs.front());
 
         bool maint_initiated = false;
         switch(this->maint_policy.smd_mode) {
@@ -1154,11 +1886,11 @@ public:
 
         // decrement the pending maintenance count
         cur_mc.pending_maint--;
-        pending_neighbor_refs.erase(pending_neighbor_refs.begin());
+        pending_neighbor_refs.pop();
     }
 
 private:
-    std::vector<RowAddr> pending_neighbor_refs;
+    HashedRowAddrQueue pending_neighbor_refs;
 
 };
 
@@ -1169,13 +1901,15 @@ class SMDRowHammerProtection : public MaintenancePolicy<T> {
     typedef enum {
         CBF,
         PARA,
-        GRAPHENE
+        GRAPHENE,
+        PRAC,
+        CMS
     } RHProtectionMode;
 
     public:
         SMDRowHammerProtection(const Config& configs, Controller<T>* ctrl, const uint32_t rank_id, 
             const uint32_t chip_id, const uint32_t num_banks_in_chip, const uint32_t SAs_per_bank, const uint32_t num_rows) : 
-            MaintenancePolicy<T>(configs, ctrl, rank_id, chip_id, num_banks_in_chip, SAs_per_bank, num_rows), rh_machine(*this),
+            MaintenancePolicy<T>(configs, ctrl, rank_id, chip_id, num_banks_in_chip, SAs_per_bank, num_rows), rh_machine(*this, configs.get_uint("smd_rh_protection_neighbor_ref_queue_size")),
             bf(configs.get_uint("smd_rh_protection_bloom_filter_size"), configs.get_uint("smd_rh_protection_bloom_filter_hashes"),
                                     configs.get_uint("smd_rh_protection_mac"), configs.get_str("smd_rh_protection_bloom_filter_type") == "space_efficient", 
                                     rank_id, chip_id) {
@@ -1214,6 +1948,42 @@ class SMDRowHammerProtection : public MaintenancePolicy<T> {
                 counter_tables = std::vector<GrapheneCounterTable>(this->channel->spec->get_num_all_banks(), GrapheneCounterTable(num_counters, act_threshold));
             }
 
+            if (configs.get_str("smd_rh_protection_mode") == "CMS") {
+                rh_mode = RHProtectionMode::CMS;
+
+                refw = configs.get_uint("smd_refresh_period");
+                cms_act_threshold = configs.get_uint("smd_rh_protection_mac")/2;
+
+                // the sketch counters saturate at the threshold since any larger value triggers a neighbor row refresh anyway
+                cms = std::unique_ptr<CountMinSketch>(new CountMinSketch(configs.get_uint("smd_rh_cms_size"), configs.get_uint("smd_rh_cms_hashes"), 
+                                                        cms_act_threshold, rank_id, chip_id));
+                rat = std::unique_ptr<RecentAggressorTable>(new RecentAggressorTable(configs.get_uint("smd_rh_cms_rat_size")));
+            }
+
+            if (configs.get_str("smd_rh_protection_mode") == "PRAC") {
+                rh_mode = RHProtectionMode::PRAC;
+
+                refw = configs.get_uint("smd_refresh_period");
+                prac_backoff_threshold = configs.get_uint("smd_rh_prac_backoff_threshold");
+                prac_num_rfm_windows = configs.get_uint("smd_rh_prac_num_rfm_windows");
+                assert(prac_backoff_threshold > 0 && prac_backoff_threshold <= std::numeric_limits<uint16_t>::max() && 
+                    "[SMDRowHammerProtection] ERROR: smd_rh_prac_backoff_threshold should fit in a 16-bit activation counter.");
+                assert(prac_num_rfm_windows > 0 && "[SMDRowHammerProtection] ERROR: smd_rh_prac_num_rfm_windows should be positive.");
+                // the chips observe row activations only in ACT_NACK mode
+                assert(this->smd_mode == SMD_MODE::ACT_NACK && "[SMDRowHammerProtection] ERROR: PRAC requires smd_mode = ACT_NACK.");
+
+                // the per-row counters of a bank are allocated on the first activation to the bank
+                prac_counters.resize(num_banks_in_chip);
+                prac_backoff_rows.resize(num_banks_in_chip);
+            }
+
+
+            rowpress = configs.get_bool("smd_rh_rowpress");
+            assert((!rowpress || rh_mode == RHProtectionMode::GRAPHENE) && "[SMDRowHammerProtection] ERROR: smd_rh_rowpress is supported only in the Graphene mode.");
+            nRAS = this->channel->spec->speed_entry.nRAS;
+            rowpress_increment_nticks = configs.get_uint("smd_rh_rowpress_increment_nticks");
+            if (rowpress_increment_nticks == 0)
+                rowpress_increment_nticks = nRAS; // keeping a row open for another tRAS is as disturbing as activating it once more
 
             this->pending_maint_limit = configs.get_uint("smd_rh_protection_neighbor_ref_queue_size");
 
@@ -1223,14 +1993,56 @@ class SMDRowHammerProtection : public MaintenancePolicy<T> {
 
             rh_machine.maint_counters.emplace_back(0);
 
-            uint32_t num_chips = (64/this->channel->spec->org_entry.dq);
+            uint32_t num_chips = (this->channel->spec->channel_width/this->channel->spec->org_entry.dq);
             gen = std::mt19937{rank_id*num_chips + chip_id}; // using fixed seed for repeatable simulations
             double neighbor_row_refresh_pct = (double)configs.get_float("smd_rh_neighbor_refresh_pct");
             disc_dist = std::discrete_distribution<uint64_t>({100 - neighbor_row_refresh_pct, neighbor_row_refresh_pct});
 
             issued_neighbor_refs
                 .name("issued_neighbor_refs_r" + to_string(rank_id) + "_c" + to_string(chip_id))
-                .desc("The number of neighbor refresh operations that has been issued by SMD.")
+                .desc("The number of neighbor refresh operations that has been issued by SMD (excluding the dropped ones).")
+                .precision(0)
+            ;
+
+            dropped_neighbor_refs
+                .name("dropped_neighbor_refs_r" + to_string(rank_id) + "_c" + to_string(chip_id))
+                .desc("The number of neighbor refresh operations dropped because the neighbor refresh queue was full.")
+                .precision(0)
+            ;
+
+            neighbor_ref_queue_occupancy_sum
+                .name("neighbor_ref_queue_occupancy_sum_r" + to_string(rank_id) + "_c" + to_string(chip_id))
+                .desc("The sum of the neighbor refresh queue occupancy over all cycles.")
+                .precision(0)
+            ;
+
+            max_neighbor_ref_queue_occupancy
+                .name("max_neighbor_ref_queue_occupancy_r" + to_string(rank_id) + "_c" + to_string(chip_id))
+                .desc("The maximum number of neighbor refresh operations waiting in the neighbor refresh queue.")
+                .precision(0)
+            ;
+
+            cms_overcount_neighbor_refs
+                .name("cms_overcount_neighbor_refs_r" + to_string(rank_id) + "_c" + to_string(chip_id))
+                .desc("The number of neighbor refresh operations the count-min sketch triggered for rows activated fewer times than the threshold.")
+                .precision(0)
+            ;
+
+            cms_rat_evictions
+                .name("cms_rat_evictions_r" + to_string(rank_id) + "_c" + to_string(chip_id))
+                .desc("The number of aggressor rows evicted from the recent aggressor table.")
+                .precision(0)
+            ;
+
+            rowpress_neighbor_refs
+                .name("rowpress_neighbor_refs_r" + to_string(rank_id) + "_c" + to_string(chip_id))
+                .desc("The number of neighbor refresh operations triggered by the open time of rows beyond tRAS (RowPress).")
+                .precision(0)
+            ;
+
+            prac_rfm_mitigations
+                .name("prac_rfm_mitigations_r" + to_string(rank_id) + "_c" + to_string(chip_id))
+                .desc("The number of aggressor rows mitigated during PRAC RFM windows.")
                 .precision(0)
             ;
         }
@@ -1247,7 +2059,28 @@ class SMDRowHammerProtection : public MaintenancePolicy<T> {
                     for(auto& ct : counter_tables)
                         ct.reset();
 
+            if (rh_mode == RHProtectionMode::CMS)
+                if ((this->clk % refw) == 0) {
+                    cms->clear();
+                    rat->reset();
+                    cms_shadow_counts.clear();
+                }
+
+            if (rh_mode == RHProtectionMode::PRAC) {
+                if ((this->clk % refw) == 0)
+                    reset_prac_counters();
+
+                // keep alerting until all rows that reached the back-off threshold are mitigated
+                if (num_prac_backoff_rows > 0 && this->clk >= prac_backoff_end)
+                    prac_abo_alert = true;
+            }
+
             rh_machine.tick();
+
+            uint32_t occupancy = rh_machine.get_queue_occupancy();
+            neighbor_ref_queue_occupancy_sum += occupancy;
+            if (occupancy > max_neighbor_ref_queue_occupancy.value())
+                max_neighbor_ref_queue_occupancy = occupancy;
         }
 
         void process_row_activation(const std::vector<int>& addr_vec) {
@@ -1257,8 +2090,7 @@ class SMDRowHammerProtection : public MaintenancePolicy<T> {
 
             if (rh_mode == RHProtectionMode::PARA) {
                 if(disc_dist(gen)){
-                    rh_machine.add_pending_maint(RowAddr(bank_id, addr_vec[uint32_t(T::Level::Subarray)], addr_vec[uint32_t(T::Level::Row)]));
-                    issued_neighbor_refs++;
+                    add_neighbor_ref(RowAddr(bank_id, addr_vec[uint32_t(T::Level::Subarray)], addr_vec[uint32_t(T::Level::Row)]));
 
                     #ifdef SMD_DEBUG
                         printf("%lu\t[%s]\t[Chip %d] Issuing neighbor row refresh for r: %d gbid: %d, grid: %d \n", this->clk, this->_policy_name.c_str(), this->_chip_id, this->_rank_id, bank_id, row_id);
@@ -1271,8 +2103,7 @@ class SMDRowHammerProtection : public MaintenancePolicy<T> {
                 if(bf.test(bf_addr)){
                     // perform neighbor row refresh with a low probability
                     if(disc_dist(gen)){
-                        rh_machine.add_pending_maint(RowAddr(bank_id, addr_vec[uint32_t(T::Level::Subarray)], addr_vec[uint32_t(T::Level::Row)]));
-                        issued_neighbor_refs++;
+                        add_neighbor_ref(RowAddr(bank_id, addr_vec[uint32_t(T::Level::Subarray)], addr_vec[uint32_t(T::Level::Row)]));
 
                         #ifdef SMD_DEBUG
                             printf("%lu\t[%s]\t[Chip %d] Issuing neighbor row refresh for r: %d gbid: %d, grid: %d \n", this->clk, this->_policy_name.c_str(), this->_chip_id, this->_rank_id, bank_id, row_id);
@@ -1283,21 +2114,144 @@ class SMDRowHammerProtection : public MaintenancePolicy<T> {
                 bool issue_neighbor_ref = counter_tables[bank_id].increment(row_id);
 
                 if (issue_neighbor_ref) {
-                    rh_machine.add_pending_maint(RowAddr(bank_id, addr_vec[uint32_t(T::Level::Subarray)], addr_vec[uint32_t(T::Level::Row)]));
-                    issued_neighbor_refs++;
+                    add_neighbor_ref(RowAddr(bank_id, addr_vec[uint32_t(T::Level::Subarray)], addr_vec[uint32_t(T::Level::Row)]));
 
                     #ifdef SMD_DEBUG
                         printf("%lu\t[%s]\t[Chip %d] Issuing neighbor row refresh for r: %d gbid: %d, grid: %d \n", this->clk, this->_policy_name.c_str(), this->_chip_id, this->_rank_id, bank_id, row_id);
                     #endif // SMD_DEBUG
                 }
+            } else if (rh_mode == RHProtectionMode::CMS) {
+                uint32_t row_key = get_bloom_filter_address(bank_id, row_id);
+
+                // exact activation count since the row's last neighbor row refresh. Used only to identify overcounting
+                uint32_t& exact_count = cms_shadow_counts[row_key];
+                exact_count++;
+
+                bool issue_neighbor_ref = false;
+                uint32_t* rat_count = rat->find(row_key);
+                if (rat_count != nullptr) {
+                    // a recent aggressor. The table counts its activations exactly
+                    (*rat_count)++;
+                    if (*rat_count >= cms_act_threshold) {
+                        *rat_count = 0;
+                        issue_neighbor_ref = true;
+                    }
+                } else {
+                    cms->insert(row_key);
+                    if (cms->estimate(row_key) >= cms_act_threshold) {
+                        // the sketch cannot be reset for a single row. Tracking the row in the recent aggressor table from now on
+                        if (rat->insert(row_key))
+                            cms_rat_evictions++;
+
+                        if (exact_count < cms_act_threshold)
+                            cms_overcount_neighbor_refs++;
+
+                        issue_neighbor_ref = true;
+                    }
+                }
+
+                if (issue_neighbor_ref) {
+                    exact_count = 0;
+                    add_neighbor_ref(RowAddr(bank_id, addr_vec[uint32_t(T::Level::Subarray)], addr_vec[uint32_t(T::Level::Row)]));
+
+                    #ifdef SMD_DEBUG
+                        printf("%lu\t[%s]\t[Chip %d] Issuing neighbor row refresh for r: %d gbid: %d, grid: %d \n", this->clk, this->_policy_name.c_str(), this->_chip_id, this->_rank_id, bank_id, row_id);
+                    #endif // SMD_DEBUG
+                }
+            } else if (rh_mode == RHProtectionMode::PRAC) {
+                std::vector<uint16_t>& counters = prac_counters[bank_id];
+                if (counters.empty())
+                    counters.resize(this->_num_SAs_per_bank*this->_num_rows, 0);
+
+                uint16_t& ctr = counters[row_id];
+                if (ctr < std::numeric_limits<uint16_t>::max())
+                    ctr++;
+
+                // the counter is reset when the row is mitigated, so a row reaches the threshold only once until then
+                if (ctr == prac_backoff_threshold) {
+                    prac_backoff_rows[bank_id].push_back(row_id);
+                    num_prac_backoff_rows++;
+                }
             }
             else {
                 assert(false && "ERROR: Undefined RHProtectionMode!");
             }
         }
 
+        // lets rh_machine perform a pending neighbor refresh within the lock window of another maintenance operation
+        bool absorb_pending_maint(const MaintRows& lock_rows, const uint32_t max_extension, uint32_t& extension, uint32_t& saved_cycles) {
+            return rh_machine.absorb_pending_maint(lock_rows, max_extension, extension, saved_cycles);
+        }
+
+        // RowPress: counts the time a row stayed open beyond tRAS as additional activations
+        void process_row_closure(const std::vector<int>& addr_vec, const long open_for_nclocks) {
+            if (!rowpress || open_for_nclocks <= nRAS)
+                return;
+
+            uint32_t weight = (open_for_nclocks - nRAS + rowpress_increment_nticks - 1)/rowpress_increment_nticks;
+
+            uint32_t bank_id = this->channel->spec->calc_global_bank_id(addr_vec);
+            uint32_t row_id = this->channel->spec->calc_row_id_in_bank(addr_vec);
+
+            if (counter_tables[bank_id].increment(row_id, weight)) {
+                if (add_neighbor_ref(RowAddr(bank_id, addr_vec[uint32_t(T::Level::Subarray)], addr_vec[uint32_t(T::Level::Row)])))
+                    rowpress_neighbor_refs++;
+            }
+        }
+
+        bool is_prac() const {
+            return rh_mode == RHProtectionMode::PRAC;
+        }
+
+        bool get_and_clear_abo_alert() {
+            bool cur_alert = prac_abo_alert;
+            prac_abo_alert = false;
+
+            return cur_alert;
+        }
+
+        // called by the memory controller after it receives a Back-Off alert from any chip in the rank. 
+        // The chip mitigates the most activated aggressor of every bank in each RFM window. Returns the back-off period.
+        // The memory controller does not activate the rank during the back-off, so the banks perform their mitigations
+        // in parallel within the windows instead of going through the neighbor refresh queue of rh_machine
+        uint32_t start_rfm_windows() {
+            uint32_t backoff_period = prac_num_rfm_windows*this->get_maint_window();
+            prac_backoff_end = this->clk + backoff_period;
+            prac_abo_alert = false;
+
+            for (uint32_t window = 0; window < prac_num_rfm_windows && num_prac_backoff_rows > 0; window++) {
+                for (uint32_t bank_id = 0; bank_id < prac_backoff_rows.size(); bank_id++) {
+                    std::vector<uint32_t>& rows = prac_backoff_rows[bank_id];
+                    if (rows.empty())
+                        continue;
+
+                    const std::vector<uint16_t>& counters = prac_counters[bank_id];
+                    auto max_row = std::max_element(rows.begin(), rows.end(), 
+                        [&counters](const uint32_t r1, const uint32_t r2) { return counters[r1] < counters[r2]; });
+
+                    uint32_t row_id = *max_row;
+                    issued_neighbor_refs++;
+                    prac_rfm_mitigations++;
+
+                    prac_counters[bank_id][row_id] = 0;
+                    *max_row = rows.back();
+                    rows.pop_back();
+                    num_prac_backoff_rows--;
+                }
+            }
+
+            return backoff_period;
+        }
+
     protected:
         ScalarStat issued_neighbor_refs;
+        ScalarStat dropped_neighbor_refs;
+        ScalarStat neighbor_ref_queue_occupancy_sum;
+        ScalarStat max_neighbor_ref_queue_occupancy;
+        ScalarStat rowpress_neighbor_refs;
+        ScalarStat cms_overcount_neighbor_refs;
+        ScalarStat cms_rat_evictions;
+        ScalarStat prac_rfm_mitigations;
 
     private:
         NeighborRowRefreshMachine<T> rh_machine;
@@ -1309,13 +2263,55 @@ class SMDRowHammerProtection : public MaintenancePolicy<T> {
         std::vector<GrapheneCounterTable> counter_tables;
         uint32_t refw = 0;
 
+        // RowPress
+        bool rowpress = false;
+        uint32_t rowpress_increment_nticks = 0; // every this many cycles a row stays open beyond tRAS count as one more activation
+        long nRAS = 0;
+
+        // count-min sketch
+        std::unique_ptr<CountMinSketch> cms;
+        std::unique_ptr<RecentAggressorTable> rat;
+        uint32_t cms_act_threshold = 0;
+        std::unordered_map<uint32_t, uint32_t> cms_shadow_counts; // exact per-row activation counts, not part of the modeled hardware
+
+        // PRAC
+        std::vector<std::vector<uint16_t>> prac_counters; // per bank activation counters, indexed by the row id in the bank. Empty until the bank is activated
+        std::vector<std::vector<uint32_t>> prac_backoff_rows; // per bank rows whose counters reached the back-off threshold
+        uint32_t num_prac_backoff_rows = 0;
+        uint32_t prac_backoff_threshold = 0;
+        uint32_t prac_num_rfm_windows = 0;
+        long prac_backoff_end = 0;
+        bool prac_abo_alert = false;
+
         // random number generation
         std::mt19937 gen;
         std::discrete_distribution<uint64_t> disc_dist;
 
+        void reset_prac_counters() {
+            // releasing the counters so that only the banks activated in the new refresh window allocate them again
+            for (auto& counters : prac_counters)
+                std::vector<uint16_t>().swap(counters);
+
+            for (auto& rows : prac_backoff_rows)
+                rows.clear();
+
+            num_prac_backoff_rows = 0;
+        }
+
+        // returns false if the neighbor refresh queue is full and the request is dropped
+        bool add_neighbor_ref(const RowAddr& ra) {
+            if (!rh_machine.add_pending_maint(ra)) {
+                dropped_neighbor_refs++;
+                return false;
+            }
+
+            issued_neighbor_refs++;
+            return true;
+        }
+
         uint32_t get_bloom_filter_address(const uint32_t bank_id, const uint32_t row_id) const {
-            // there can be at most 16 banks, so shifting row_id by 4 and adding bank_id
-            return (row_id << 4) + bank_id;
+            // the bank id takes the lowest _bank_id_bits bits
+            return (row_id << this->_bank_id_bits) + bank_id;
         }
 };
 
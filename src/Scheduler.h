@@ -296,6 +296,10 @@ public:
 
     RowTable(Controller<T>* ctrl) : ctrl(ctrl) {}
 
+    // whether the id of a closing command matches the id of a table entry. Negative ids address all children
+    // (e.g., DDR5 same-bank commands)
+    static bool addr_match(int id, int entry_id) { return id < 0 || id == entry_id; }
+
     void update(typename T::Command cmd, const vector<int>& addr_vec, long clk)
     {
         auto begin = addr_vec.begin();
@@ -323,7 +327,7 @@ public:
           int n_rm = 0;
           int scope = min(int(spec->scope[int(cmd)]), int(T::Level::Subarray)); // Hasan: modified to min of scope[cmd] and Bank as the scope of RDA/WRA is Column and Column is not appropriate for here
           for (auto it = table.begin(); it != table.end();) {
-            if (equal(begin, begin + scope + 1, it->first.begin())) {
+            if (equal(begin, begin + scope + 1, it->first.begin(), addr_match)) {
               n_rm++;
               it = table.erase(it);
             }
@@ -376,6 +380,29 @@ public:
 
         return ctrl->clk - itr->second.act_timestamp;
     }
+
+    // returns the full address and the open interval of every row that a closing command closes
+    vector<pair<vector<int>, long>> get_closing_rows(typename T::Command cmd, const vector<int>& addr_vec, long clk) const
+    {
+        vector<pair<vector<int>, long>> closing_rows;
+
+        T* spec = ctrl->channel->spec;
+        if (!spec->is_closing(cmd))
+            return closing_rows;
+
+        auto begin = addr_vec.begin();
+        int scope = min(int(spec->scope[int(cmd)]), int(T::Level::Subarray)); // same scope as in update()
+        for (auto& kv : table) {
+            if (equal(begin, begin + scope + 1, kv.first.begin(), addr_match)) {
+                vector<int> row_addr_vec(kv.first);
+                row_addr_vec.push_back(kv.second.row);
+                row_addr_vec.resize(int(T::Level::MAX), 0);
+                closing_rows.push_back({row_addr_vec, clk - kv.second.act_timestamp});
+            }
+        }
+
+        return closing_rows;
+    }
 };
 
 } /*namespace ramulator*/
@@ -7,20 +7,18 @@ namespace ramulator
     StridePrefetcher::StridePrefetcher(uint32_t num_stride_table_entries, StridePrefMode _mode, 
             int _single_stride_threshold, int _multi_stride_threshold, int _stride_start_dist,
             int _stride_degree, int _stride_dist, function<bool(Request)> _send,
-            function<void(Request&)> _callback, function<void(Request&)> _proc_callback) {
+            function<void(Request&)> _callback, function<void(Request&)> _proc_callback):
+            Prefetcher(_send, _callback, _proc_callback) {
         mode = _mode;
         single_stride_threshold = _single_stride_threshold;
         multi_stride_threshold = _multi_stride_threshold;
         stride_start_dist = _stride_start_dist;
         stride_degree = _stride_degree;
         stride_dist = _stride_dist;
-        send = _send;
-        callback = _callback;
-        proc_callback = _proc_callback;
 
         num_entries = num_stride_table_entries;
-        region_table = new StrideRegionTableEntry[num_entries];
-        index_table = new StrideIndexTableEntry[num_entries];
+        region_table = new StrideRegionTableEntry[num_entries]();
+        index_table = new StrideIndexTableEntry[num_entries]();
     }
 
     StridePrefetcher::~StridePrefetcher() {
@@ -31,7 +29,7 @@ namespace ramulator
     void StridePrefetcher::train(long line_addr, bool ul1_hit, long cur_clk) {
        
        int region_idx = -1;
-       long line_index = line_addr >> CACHE_LINE_SIZE_BITS;
+       long line_index = line_addr >> line_bits;
        long index_tag = STRIDE_REGION(line_addr);
 
        for (uint32_t ii = 0; ii < num_entries; ii++) {
@@ -146,7 +144,7 @@ namespace ramulator
                for (int ii = 0; (ii < stride_degree && entry->pref_sent < (uint64_t)stride_dist); ii++,
                                                     entry->pref_sent++) {
                    pref_index = entry->pref_last_index + entry->stride[0];
-                   if (!issue_pref_req(pref_index))
+                   if (!issue_prefetch(pref_index))
                        break; // q is full
                    entry->pref_last_index = pref_index;
                }
@@ -166,13 +164,13 @@ namespace ramulator
                                                                     ii++, entry->pref_sent++) {
                    if (entry->pref_count == entry->s_cnt[entry->pref_curr_state]) {
                        pref_index = entry->pref_last_index + entry->strans[entry->pref_curr_state];
-                       if (!issue_pref_req(pref_index))
+                       if (!issue_prefetch(pref_index))
                            break; // q is full
                        entry->pref_count = 0;
                        entry->pref_curr_state = (1 - entry->pref_curr_state);
                    } else {
                        pref_index = entry->pref_last_index + entry->stride[entry->pref_curr_state];
-                       if (!issue_pref_req(pref_index))
+                       if (!issue_prefetch(pref_index))
                            break; // q is full
                        entry->pref_count++;
                    }
@@ -202,7 +200,7 @@ namespace ramulator
         train(line_addr, false, cur_clk);
     }
 
-    void StridePrefetcher::hit(long line_addr, long cur_clk) {
+    void StridePrefetcher::hit(long line_addr, long cur_clk, bool prefetched) {
         train(line_addr, true, cur_clk);
     }
 
@@ -214,7 +212,7 @@ namespace ramulator
         index_table[idx].trained = false;
         index_table[idx].num_states = 1;
         index_table[idx].curr_state = 0;
-        index_table[idx].last_index = line_addr >> CACHE_LINE_SIZE_BITS;
+        index_table[idx].last_index = line_addr >> line_bits;
         index_table[idx].stride[0] = 0;
         index_table[idx].s_cnt[0] = 0;
         index_table[idx].stride[1] = 0;
@@ -229,12 +227,4 @@ namespace ramulator
         index_table[idx].pref_sent = 0;
     }
 
-    bool StridePrefetcher::issue_pref_req(long line_index) {
-        long line_addr = line_index << CACHE_LINE_SIZE_BITS;
-
-        Request req(line_addr, Request::Type::PREFETCH, callback, 0);
-        req.proc_callback = proc_callback;
-        return send(req);
-    }
-
 } // namespace ramulator
@@ -11,6 +11,7 @@
 #define STRIDE_REGION(x) ( x >> (PREF_STRIDE_REGION_BITS) )
 
 #include <functional>
+#include "Prefetcher.h"
 #include "Request.h"
 
 #ifdef ATB_HEADERS
@@ -19,7 +20,7 @@
 
 namespace ramulator
 {
-    class StridePrefetcher {
+    class StridePrefetcher : public Prefetcher {
         protected:
             struct StrideRegionTableEntry {
                 long tag;
@@ -52,16 +53,6 @@ namespace ramulator
             uint32_t num_entries;
             StrideRegionTableEntry* region_table;
             StrideIndexTableEntry* index_table;
-            function<bool(Request)> send;
-            function<void(Request&)> callback;
-            function<void(Request&)> proc_callback;
-
-        private:
-            const int CACHE_LINE_SIZE_BITS = 6; // TODO: cache line size is hardcoded in ramulator
-                                                // to 64 bytes. Change this when making 
-                                                // cache line size configurable
-
-            bool issue_pref_req(long line_index);
 
         public:
 
@@ -86,8 +77,8 @@ namespace ramulator
             ~StridePrefetcher();
 
             void train(long line_addr, bool ul1_hit, long cur_clk);
-            void miss(long line_addr, long cur_clk);
-            void hit(long line_addr, long cur_clk);
+            void miss(long line_addr, long cur_clk) override;
+            void hit(long line_addr, long cur_clk, bool prefetched) override;
 
             void create_new_entry(int idx, long line_addr, long region_tag, long cur_clk);
 